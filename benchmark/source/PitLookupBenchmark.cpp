@@ -0,0 +1,158 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// Compares PitData's partition name and identifier indexes with the linear scans they replaced.
+
+// C/C++ Standard Library
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// libpit
+#include "libpit.h"
+
+using namespace libpit;
+
+enum
+{
+	kDefaultLookupCount = 1000000
+};
+
+static const unsigned int entryCounts[] = { 16, 64, 256, 1024 };
+
+static void createPitData(unsigned int entryCount, PitData& pitData)
+{
+	std::vector<unsigned char> data(PitData::kHeaderDataSize + entryCount * PitEntry::kDataSize, 0);
+
+	// Header: file identifier then entry count, both little endian.
+	unsigned int header[2] = { PitData::kFileIdentifier, entryCount };
+
+	for (unsigned int i = 0; i < 8; i++)
+		data[i] = (header[i / 4] >> (8 * (i % 4))) & 0xFF;
+
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		unsigned char *entry = &data[PitData::kHeaderDataSize + i * PitEntry::kDataSize];
+
+		// Identifier
+		entry[8] = (i + 1) & 0xFF;
+		entry[9] = ((i + 1) >> 8) & 0xFF;
+
+		sprintf((char *)entry + 36, "PARTITION_%u", i);
+	}
+
+	pitData.Unpack(&data[0], data.size());
+}
+
+static const PitEntry *scanForName(const PitData& pitData, const char *partitionName)
+{
+	for (unsigned int i = 0; i < pitData.GetEntryCount(); i++)
+	{
+		const PitEntry *entry = pitData.GetEntry(i);
+
+		if (entry->IsFlashable() && strcmp(entry->GetPartitionName(), partitionName) == 0)
+			return (entry);
+	}
+
+	return (nullptr);
+}
+
+static const PitEntry *scanForIdentifier(const PitData& pitData, unsigned int partitionIdentifier)
+{
+	for (unsigned int i = 0; i < pitData.GetEntryCount(); i++)
+	{
+		const PitEntry *entry = pitData.GetEntry(i);
+
+		if (entry->IsFlashable() && entry->GetIdentifier() == partitionIdentifier)
+			return (entry);
+	}
+
+	return (nullptr);
+}
+
+template <typename Lookup>
+static double measure(unsigned int lookupCount, Lookup lookup)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	unsigned int foundCount = 0;
+
+	for (unsigned int i = 0; i < lookupCount; i++)
+	{
+		if (lookup(i))
+			foundCount++;
+	}
+
+	double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+
+	// Every lookup should succeed, checking also stops the loop being optimised away.
+	if (foundCount != lookupCount)
+		fprintf(stderr, "ERROR: %u of %u lookups failed!\n", lookupCount - foundCount, lookupCount);
+
+	return (nanoseconds / lookupCount);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int lookupCount = (argc > 1) ? (unsigned int)strtoul(argv[1], nullptr, 10) : (unsigned int)kDefaultLookupCount;
+
+	if (lookupCount == 0)
+	{
+		fprintf(stderr, "Usage: pit-lookup-benchmark [lookup count]\n");
+		return (1);
+	}
+
+	printf("%8s %14s %14s %14s %14s\n", "Entries", "Name index", "Name scan", "ID index", "ID scan");
+
+	for (unsigned int i = 0; i < sizeof(entryCounts) / sizeof(entryCounts[0]); i++)
+	{
+		unsigned int entryCount = entryCounts[i];
+
+		PitData pitData;
+		createPitData(entryCount, pitData);
+
+		// Look up every entry in turn, so scans cost half the entry count on average.
+		std::vector<std::vector<char> > partitionNames(entryCount, std::vector<char>(PitEntry::kPartitionNameMaxLength));
+
+		for (unsigned int j = 0; j < entryCount; j++)
+			sprintf(&partitionNames[j][0], "PARTITION_%u", j);
+
+		double nameIndexTime = measure(lookupCount, [&](unsigned int j) {
+			return (pitData.FindEntry(&partitionNames[j % entryCount][0]) != nullptr);
+		});
+
+		double nameScanTime = measure(lookupCount, [&](unsigned int j) {
+			return (scanForName(pitData, &partitionNames[j % entryCount][0]) != nullptr);
+		});
+
+		double identifierIndexTime = measure(lookupCount, [&](unsigned int j) {
+			return (pitData.FindEntry(j % entryCount + 1) != nullptr);
+		});
+
+		double identifierScanTime = measure(lookupCount, [&](unsigned int j) {
+			return (scanForIdentifier(pitData, j % entryCount + 1) != nullptr);
+		});
+
+		printf("%8u %11.1f ns %11.1f ns %11.1f ns %11.1f ns\n", entryCount, nameIndexTime, nameScanTime, identifierIndexTime,
+			identifierScanTime);
+	}
+
+	return (0);
+}
@@ -0,0 +1,135 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// Measures how quickly PIT files are parsed by PitData::Unpack(), with and without bounds checking, and read through PitView.
+
+// C/C++ Standard Library
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// libpit
+#include "libpit.h"
+
+using namespace libpit;
+
+enum
+{
+	kDefaultPitCount = 100000,
+	kEntryCount = 64 // Typical of recent devices.
+};
+
+static std::vector<unsigned char> createPitFile(unsigned int entryCount)
+{
+	PitData pitData;
+	std::vector<unsigned char> data(PitData::kHeaderDataSize + entryCount * PitEntry::kDataSize, 0);
+
+	// Header: file identifier then entry count, both little endian.
+	unsigned int header[2] = { PitData::kFileIdentifier, entryCount };
+
+	for (unsigned int i = 0; i < 8; i++)
+		data[i] = (header[i / 4] >> (8 * (i % 4))) & 0xFF;
+
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		unsigned char *entry = &data[PitData::kHeaderDataSize + i * PitEntry::kDataSize];
+
+		// Identifier
+		entry[8] = (i + 1) & 0xFF;
+		entry[9] = ((i + 1) >> 8) & 0xFF;
+
+		sprintf((char *)entry + 36, "PARTITION_%u", i);
+		sprintf((char *)entry + 36 + PitEntry::kPartitionNameMaxLength, "partition_%u.img", i);
+	}
+
+	pitData.Unpack(&data[0], data.size());
+
+	std::vector<unsigned char> pitFile(pitData.GetPaddedSize(), 0);
+	pitData.Pack(&pitFile[0]);
+
+	return (pitFile);
+}
+
+template <typename Parse>
+static void measure(const char *name, const std::vector<unsigned char>& pitFile, unsigned int pitCount, Parse parse)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	unsigned int entryCount = 0;
+
+	for (unsigned int i = 0; i < pitCount; i++)
+		entryCount += parse(&pitFile[0], pitFile.size());
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	// Checking the result also stops the loop being optimised away.
+	if (entryCount != pitCount * kEntryCount)
+		fprintf(stderr, "ERROR: %s parsed %u entries, expected %u!\n", name, entryCount, pitCount * kEntryCount);
+
+	printf("%-24s %12.0f %12.1f\n", name, pitCount / seconds, pitCount * (double)pitFile.size() / seconds / 1048576.0);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int pitCount = (argc > 1) ? (unsigned int)strtoul(argv[1], nullptr, 10) : (unsigned int)kDefaultPitCount;
+
+	if (pitCount == 0)
+	{
+		fprintf(stderr, "Usage: pit-unpack-benchmark [PIT count]\n");
+		return (1);
+	}
+
+	std::vector<unsigned char> pitFile = createPitFile(kEntryCount);
+
+	printf("%u PITs of %u entries (%u bytes)\n\n", pitCount, (unsigned int)kEntryCount, (unsigned int)pitFile.size());
+	printf("%-24s %12s %12s\n", "Parser", "PITs/s", "MiB/s");
+
+	// A PitData is reused, as the inventory action does, so only the first unpack allocates.
+	PitData pitData;
+
+	measure("PitData::Unpack(data)", pitFile, pitCount, [&](const unsigned char *data, unsigned int) {
+		return (pitData.Unpack(data) ? pitData.GetEntryCount() : 0);
+	});
+
+	measure("PitData::Unpack(data, n)", pitFile, pitCount, [&](const unsigned char *data, unsigned int size) {
+		return (pitData.Unpack(data, size) ? pitData.GetEntryCount() : 0);
+	});
+
+	// Views decode nothing up front, so read each entry's identifier to be comparable.
+	measure("PitView", pitFile, pitCount, [&](const unsigned char *data, unsigned int size) {
+		PitView pitView;
+		unsigned int flashableCount = 0;
+
+		if (pitView.Open(data, size))
+		{
+			for (unsigned int i = 0; i < pitView.GetEntryCount(); i++)
+			{
+				PitEntryView entry = pitView.GetEntry(i);
+
+				if (entry.IsFlashable() && entry.GetIdentifier() != 0)
+					flashableCount++;
+			}
+		}
+
+		return (flashableCount);
+	});
+
+	return (0);
+}
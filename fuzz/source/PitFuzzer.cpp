@@ -0,0 +1,112 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// Feeds arbitrary data to the PIT parsers, then exercises everything that reads an unpacked PIT.
+
+// C/C++ Standard Library
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// libpit
+#include "libpit.h"
+
+using namespace libpit;
+
+// Both lookups must find the same entry (the first flashable one with the key), or neither.
+static void checkSameEntry(const PitData& pitData, const PitView& pitView, const PitEntry *entry, bool found,
+	const PitEntryView& entryView)
+{
+	if (found != (entry != nullptr))
+		__builtin_trap();
+
+	if (found && entryView.GetPartitionName() != pitView.GetEntry((unsigned int)(entry - pitData.GetEntry(0))).GetPartitionName())
+		__builtin_trap();
+}
+
+static void checkLookup(const PitData& pitData, const PitView& pitView, const char *partitionName)
+{
+	PitEntryView entryView;
+	bool found = pitView.FindEntry(partitionName, entryView);
+
+	checkSameEntry(pitData, pitView, pitData.FindEntry(partitionName), found, entryView);
+}
+
+static void checkLookup(const PitData& pitData, const PitView& pitView, unsigned int partitionIdentifier)
+{
+	PitEntryView entryView;
+	bool found = pitView.FindEntry(partitionIdentifier, entryView);
+
+	checkSameEntry(pitData, pitView, pitData.FindEntry(partitionIdentifier), found, entryView);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	// PITs are nowhere near 4 GiB, and sizes are unsigned int throughout.
+	if (size > 0xFFFFFFFF)
+		return (0);
+
+	PitView pitView;
+	bool opened = pitView.Open(data, size);
+
+	PitData pitData;
+	bool unpacked = pitData.Unpack(data, size);
+
+	// Both parsers validate the same way.
+	if (opened != unpacked)
+		__builtin_trap();
+
+	if (!unpacked)
+		return (0);
+
+	for (unsigned int i = 0; i < pitData.GetEntryCount(); i++)
+	{
+		const PitEntry *entry = pitData.GetEntry(i);
+
+		checkLookup(pitData, pitView, entry->GetPartitionName());
+		checkLookup(pitData, pitView, entry->GetIdentifier());
+
+		// The packed name, which needn't be terminated, and a name longer than any that can be stored.
+		const char *packedName = pitView.GetEntry(i).GetPartitionName();
+		std::string name(packedName, strnlen(packedName, PitEntry::kPartitionNameMaxLength));
+
+		checkLookup(pitData, pitView, name.c_str());
+		checkLookup(pitData, pitView, (name + "x").c_str());
+	}
+
+	// Repacking and unpacking again must round trip.
+	std::vector<unsigned char> packedData(pitData.GetPaddedSize());
+	pitData.Pack(packedData.data());
+
+	PitData repackedPitData;
+
+	if (!repackedPitData.Unpack(packedData.data(), packedData.size()) || !repackedPitData.Matches(&pitData))
+		__builtin_trap();
+
+	PitDiff pitDiff;
+	pitDiff.Compare(&pitData, &repackedPitData);
+
+	if (!pitDiff.IsEmpty())
+		__builtin_trap();
+
+	return (0);
+}
@@ -0,0 +1,71 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// Feeds arbitrary data to each inbound packet, as BridgeManager::ReceivePacket() would had it been received.
+
+// C/C++ Standard Library
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Heimdall
+#include "DumpResponse.h"
+#include "PitFileResponse.h"
+#include "ReceiveFilePartPacket.h"
+#include "SendFilePartResponse.h"
+#include "SessionSetupResponse.h"
+
+using namespace Heimdall;
+
+static void receive(InboundPacket& packet, const uint8_t *data, size_t size)
+{
+	// Transfers are never longer than the buffer they're received into.
+	size_t receivedSize = (size < packet.GetSize()) ? size : packet.GetSize();
+
+	if (receivedSize != packet.GetSize() && !packet.IsSizeVariable())
+		return;
+
+	if (receivedSize > 0)
+		memcpy(packet.GetData(), data, receivedSize);
+
+	packet.SetReceivedSize(receivedSize);
+
+	packet.Unpack();
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	DumpResponse dumpResponse;
+	receive(dumpResponse, data, size);
+
+	PitFileResponse pitFileResponse;
+	receive(pitFileResponse, data, size);
+
+	ReceiveFilePartPacket receiveFilePartPacket;
+	receive(receiveFilePartPacket, data, size);
+
+	SendFilePartResponse sendFilePartResponse;
+	receive(sendFilePartResponse, data, size);
+
+	SessionSetupResponse sessionSetupResponse;
+	receive(sessionSetupResponse, data, size);
+
+	return (0);
+}
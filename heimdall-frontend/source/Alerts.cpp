@@ -19,27 +19,49 @@
  THE SOFTWARE.*/
 
 // Qt
+#include <QCoreApplication>
 #include <QMessageBox>
+#include <QThread>
 
 // Heimdall Frontend
 #include "Alerts.h"
 
 using namespace HeimdallFrontend;
 
-void Alerts::DisplayError(const QString& errorMessage)
+static AlertDispatcher *createAlertDispatcher(void)
+{
+	AlertDispatcher *alertDispatcher = new AlertDispatcher();
+	alertDispatcher->moveToThread(QCoreApplication::instance()->thread());
+
+	return (alertDispatcher);
+}
+
+void AlertDispatcher::Display(int icon, const QString& message)
 {
 	QMessageBox messageBox;
 	messageBox.setModal(true);
-	messageBox.setText(errorMessage);
-	messageBox.setIcon(QMessageBox::Critical);
+	messageBox.setText(message);
+	messageBox.setIcon(static_cast<QMessageBox::Icon>(icon));
 	messageBox.exec();
 }
 
+void Alerts::Display(int icon, const QString& message)
+{
+	// The dispatcher may be first used by a worker thread, so it's explicitly moved to the GUI thread.
+	static AlertDispatcher *alertDispatcher = createAlertDispatcher();
+
+	if (QThread::currentThread() == alertDispatcher->thread())
+		alertDispatcher->Display(icon, message);
+	else
+		QMetaObject::invokeMethod(alertDispatcher, "Display", Qt::BlockingQueuedConnection, Q_ARG(int, icon), Q_ARG(QString, message));
+}
+
+void Alerts::DisplayError(const QString& errorMessage)
+{
+	Display(QMessageBox::Critical, errorMessage);
+}
+
 void Alerts::DisplayWarning(const QString& warningMessage)
 {
-	QMessageBox messageBox;
-	messageBox.setModal(true);
-	messageBox.setText(warningMessage);
-	messageBox.setIcon(QMessageBox::Warning);
-	messageBox.exec();
+	Display(QMessageBox::Warning, warningMessage);
 }
@@ -22,14 +22,31 @@
 #define ALERTS_H
 
 // Qt
+#include <QObject>
 #include <QString>
 
 namespace HeimdallFrontend
 {
+	// Lives on the GUI thread, alerts raised by worker threads are displayed through it.
+	class AlertDispatcher : public QObject
+	{
+		Q_OBJECT
+
+		public slots:
+
+			void Display(int icon, const QString& message);
+	};
+
 	class Alerts
 	{
+		private:
+
+			static void Display(int icon, const QString& message);
+
 		public:
 
+			// May be called from any thread. Worker threads are blocked until the alert is dismissed, so the GUI thread must
+			// process events whilst waiting for them.
 			static void DisplayError(const QString& errorMessage);
 			static void DisplayWarning(const QString& warningMessage);
 	};
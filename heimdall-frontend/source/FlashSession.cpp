@@ -0,0 +1,147 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <stdio.h>
+#include <vector>
+
+// Heimdall
+#include "BridgeManager.h"
+#include "FlashAction.h"
+#include "Interface.h"
+
+// Heimdall Frontend
+#include "FlashSession.h"
+
+using namespace std;
+using namespace Heimdall;
+using namespace HeimdallFrontend;
+
+static void closeFiles(vector<FlashAction::PartitionFile>& partitionFiles)
+{
+	for (vector<FlashAction::PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
+		FileClose(it->file);
+
+	partitionFiles.clear();
+}
+
+void FlashSession::HandleOutput(const char *text, bool error, void *userData)
+{
+	// Errors and warnings are already prefixed, so they're displayed alongside regular output.
+	emit static_cast<FlashSession *>(userData)->Output(QString::fromUtf8(text));
+}
+
+void FlashSession::Phase(const char *phase, const char *partitionName)
+{
+	emit PhaseChanged(QString::fromUtf8(phase), QString::fromUtf8(partitionName ? partitionName : ""));
+}
+
+void FlashSession::BeginTransfer(unsigned int totalBytes)
+{
+	previousPercent = 0;
+	emit PercentChanged(0);
+}
+
+void FlashSession::Transfer(unsigned int bytesTransferred, unsigned int totalBytes)
+{
+	int percent = (totalBytes > 0) ? (int)(100.0 * ((double)bytesTransferred / (double)totalBytes)) : 100;
+
+	// Signals are queued for the GUI thread, so only changes are reported.
+	if (percent != previousPercent)
+	{
+		previousPercent = percent;
+		emit PercentChanged(percent);
+	}
+}
+
+void FlashSession::Retry(unsigned int attempt)
+{
+}
+
+void FlashSession::EndTransfer(void)
+{
+}
+
+void FlashSession::Error(const char *message)
+{
+	emit ErrorOccurred(QString::fromUtf8(message));
+}
+
+bool FlashSession::Flash(const QList<FileInfo>& fileInfos, const libpit::PitData *pitData, bool repartition, bool reboot, bool resume,
+	bool verbose)
+{
+	// Package files are flashed directly from where they were extracted.
+	vector<FlashAction::PartitionFile> partitionFiles;
+
+	for (int i = 0; i < fileInfos.length(); i++)
+	{
+		FILE *file = FileOpen(fileInfos[i].GetFilename().toLocal8Bit().constData(), "rb");
+
+		if (!file)
+		{
+			Interface::PrintError("Failed to open file \"%s\"\n", fileInfos[i].GetFilename().toUtf8().constData());
+			closeFiles(partitionFiles);
+
+			return (false);
+		}
+
+		partitionFiles.push_back(FlashAction::PartitionFile(QString::number(fileInfos[i].GetPartitionId()).toStdString(), file));
+	}
+
+	Interface::PrintReleaseInfo();
+
+	BridgeManager bridgeManager(verbose);
+
+	if (bridgeManager.Initialise(resume) != BridgeManager::kInitialiseSucceeded || !bridgeManager.BeginSession())
+	{
+		closeFiles(partitionFiles);
+		return (false);
+	}
+
+	bool success = FlashAction::Flash(&bridgeManager, partitionFiles, pitData, repartition, false, nullptr, nullptr);
+
+	if (!bridgeManager.EndSession(reboot))
+		success = false;
+
+	closeFiles(partitionFiles);
+
+	return (success);
+}
+
+FlashSession::FlashSession()
+{
+	previousPercent = 0;
+}
+
+bool FlashSession::Run(const QList<FileInfo>& fileInfos, const libpit::PitData& pitData, bool repartition, bool reboot, bool resume,
+	bool verbose)
+{
+	Interface::SetOutputFunction(&FlashSession::HandleOutput, this);
+	Progress::SetFormat(Progress::kFormatNone);
+	Progress::SetListener(this);
+
+	bool success = Flash(fileInfos, &pitData, repartition, reboot, resume, verbose);
+
+	Progress::SetListener(nullptr);
+	Progress::SetFormat(Progress::kFormatText);
+	Interface::SetOutputFunction(nullptr, nullptr);
+
+	return (success);
+}
@@ -0,0 +1,81 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef FLASHSESSION_H
+#define FLASHSESSION_H
+
+// Qt
+#include <QList>
+#include <QObject>
+#include <QString>
+
+// libpit
+#include "libpit.h"
+
+// Heimdall
+#include "Progress.h"
+
+// Heimdall Frontend
+#include "FirmwareInfo.h"
+
+namespace HeimdallFrontend
+{
+	// Flashes firmware in-process using libheimdall. Run() is intended to be called on a worker thread, everything it reports is
+	// delivered through queued signals. Heimdall's output and progress are routed per thread, so sessions on different threads
+	// don't interfere.
+	class FlashSession : public QObject, private Heimdall::Progress::Listener
+	{
+		Q_OBJECT
+
+		private:
+
+			int previousPercent;
+
+			static void HandleOutput(const char *text, bool error, void *userData);
+
+			// Heimdall::Progress::Listener
+			void Phase(const char *phase, const char *partitionName);
+			void BeginTransfer(unsigned int totalBytes);
+			void Transfer(unsigned int bytesTransferred, unsigned int totalBytes);
+			void Retry(unsigned int attempt);
+			void EndTransfer(void);
+			void Error(const char *message);
+
+			bool Flash(const QList<FileInfo>& fileInfos, const libpit::PitData *pitData, bool repartition, bool reboot, bool resume,
+				bool verbose);
+
+		public:
+
+			FlashSession();
+
+			// pitData is the already unpacked PIT, it's uploaded when repartitioning and otherwise verified against the device's PIT.
+			bool Run(const QList<FileInfo>& fileInfos, const libpit::PitData& pitData, bool repartition, bool reboot, bool resume,
+				bool verbose);
+
+		signals:
+
+			void Output(const QString& text);
+			void PhaseChanged(const QString& phase, const QString& partitionName);
+			void PercentChanged(int percent);
+			void ErrorOccurred(const QString& message);
+	};
+}
+
+#endif
@@ -42,6 +42,10 @@ void PackageData::Clear(void)
 		delete files[i];
 
 	files.clear();
+	deferredFiles.clear();
+
+	packagePath.clear();
+	packageIndex.Clear();
 }
 
 bool PackageData::ReadFirmwareInfo(QFile *file)
@@ -60,6 +64,17 @@ bool PackageData::ReadFirmwareInfo(QFile *file)
 	return (success);
 }
 
+void PackageData::Swap(PackageData& packageData)
+{
+	qSwap(firmwareInfo, packageData.firmwareInfo);
+
+	files.swap(packageData.files);
+	deferredFiles.swap(packageData.deferredFiles);
+
+	packagePath.swap(packageData.packagePath);
+	qSwap(packageIndex, packageData.packageIndex);
+}
+
 bool PackageData::IsCleared(void) const
 {
 	return (firmwareInfo.IsCleared() && files.isEmpty());
@@ -26,6 +26,7 @@
 
 // Heimdall Frontend
 #include "FirmwareInfo.h"
+#include "PackageIndex.h"
 
 namespace HeimdallFrontend
 {
@@ -36,6 +37,11 @@ namespace HeimdallFrontend
 			FirmwareInfo firmwareInfo;
 			QList<QTemporaryFile *> files;
 
+			// Files of an indexed package that haven't been decompressed yet.
+			QString packagePath;
+			PackageIndex packageIndex;
+			QList<QTemporaryFile *> deferredFiles;
+
 		public:
 
 			PackageData();
@@ -44,6 +50,9 @@ namespace HeimdallFrontend
 			void Clear(void);
 			bool ReadFirmwareInfo(QFile *file);
 
+			// Exchanges the contents (including ownership of files) of the two packages.
+			void Swap(PackageData& packageData);
+
 			bool IsCleared(void) const;
 
 			const FirmwareInfo& GetFirmwareInfo(void) const
@@ -66,10 +75,36 @@ namespace HeimdallFrontend
 				return (files);
 			}
 
+			const QString& GetPackagePath(void) const
+			{
+				return (packagePath);
+			}
+
+			const PackageIndex& GetPackageIndex(void) const
+			{
+				return (packageIndex);
+			}
+
+			void SetPackageIndex(const QString& packagePath, const PackageIndex& packageIndex)
+			{
+				this->packagePath = packagePath;
+				this->packageIndex = packageIndex;
+			}
+
+			// A subset of files.
+			QList<QTemporaryFile *>& GetDeferredFiles(void)
+			{
+				return (deferredFiles);
+			}
+
 			// Simply clears the files list, it does delete/close any files.
 			void RemoveAllFiles(void)
 			{
 				files.clear();
+				deferredFiles.clear();
+
+				packagePath.clear();
+				packageIndex.Clear();
 			}
 	};
 }
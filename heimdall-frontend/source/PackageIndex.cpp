@@ -0,0 +1,392 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <string.h>
+
+// zlib
+#include "zlib.h"
+
+// Heimdall Frontend
+#include "PackageIndex.h"
+
+using namespace HeimdallFrontend;
+
+enum
+{
+	kExtractBufferLength = 262144
+};
+
+static const char *indexMagic = "HIDX";
+
+static void packInteger(QByteArray& data, quint64 value, int length)
+{
+	for (int i = 0; i < length; i++)
+		data.append(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+static quint64 unpackInteger(const char *data, int length)
+{
+	quint64 value = 0;
+
+	for (int i = 0; i < length; i++)
+		value |= static_cast<quint64>(static_cast<unsigned char>(data[i])) << (8 * i);
+
+	return (value);
+}
+
+// Footer member: gzip header with FEXTRA, XLEN, "HX" subfield holding the magic and index offset, an empty final deflate
+// block, then the CRC and size (both 0) of the empty member.
+static QByteArray packFooter(quint64 indexOffset)
+{
+	const char header[12] = { '\x1F', '\x8B', 8, 4, 0, 0, 0, 0, 0, '\xFF', 16, 0 };
+
+	QByteArray footer(header, sizeof(header));
+	footer.append("HX", 2);
+	packInteger(footer, 12, 2);
+	footer.append(indexMagic, 4);
+	packInteger(footer, indexOffset, 8);
+	footer.append("\x03\x00", 2);
+	packInteger(footer, 0, 8);
+
+	return (footer);
+}
+
+void PackageIndex::Clear(void)
+{
+	accessPoints.clear();
+	members.clear();
+}
+
+void PackageIndex::AddMember(const QString& name, quint64 offset, quint64 size, const QByteArray& digest)
+{
+	PackageIndexMember member;
+	member.name = name;
+	member.offset = offset;
+	member.size = size;
+	member.digest = digest;
+
+	members.append(member);
+}
+
+QByteArray PackageIndex::Pack(void) const
+{
+	QByteArray data(indexMagic, 4);
+	packInteger(data, kVersion, 4);
+	packInteger(data, accessPoints.length(), 4);
+	packInteger(data, members.length(), 4);
+
+	for (int i = 0; i < accessPoints.length(); i++)
+	{
+		packInteger(data, accessPoints[i].compressedOffset, 8);
+		packInteger(data, accessPoints[i].uncompressedOffset, 8);
+	}
+
+	for (int i = 0; i < members.length(); i++)
+	{
+		QByteArray utfName = members[i].name.toUtf8();
+
+		packInteger(data, members[i].offset, 8);
+		packInteger(data, members[i].size, 8);
+		packInteger(data, utfName.length(), 2);
+		data.append(utfName);
+
+		packInteger(data, members[i].digest.length(), 1);
+		data.append(members[i].digest);
+	}
+
+	return (data);
+}
+
+bool PackageIndex::Unpack(const QByteArray& data)
+{
+	Clear();
+
+	if (data.size() < 16 || memcmp(data.constData(), indexMagic, 4) != 0)
+		return (false);
+
+	// Version 1 indexes are identical, except that members have no digest.
+	quint64 version = unpackInteger(data.constData() + 4, 4);
+
+	if (version < 1 || version > kVersion)
+		return (false);
+
+	quint64 accessPointCount = unpackInteger(data.constData() + 8, 4);
+	quint64 memberCount = unpackInteger(data.constData() + 12, 4);
+
+	const char *position = data.constData() + 16;
+	const char *end = data.constData() + data.size();
+
+	if (accessPointCount == 0 || accessPointCount > static_cast<quint64>(end - position) / 16)
+		return (false);
+
+	for (quint64 i = 0; i < accessPointCount; i++)
+	{
+		GzipAccessPoint accessPoint;
+		accessPoint.compressedOffset = unpackInteger(position, 8);
+		accessPoint.uncompressedOffset = unpackInteger(position + 8, 8);
+		position += 16;
+
+		// Access points must be in order, as extraction relies on it.
+		if (!accessPoints.isEmpty() && (accessPoint.compressedOffset <= accessPoints.last().compressedOffset
+			|| accessPoint.uncompressedOffset <= accessPoints.last().uncompressedOffset))
+		{
+			Clear();
+			return (false);
+		}
+
+		accessPoints.append(accessPoint);
+	}
+
+	for (quint64 i = 0; i < memberCount; i++)
+	{
+		if (end - position < 18)
+		{
+			Clear();
+			return (false);
+		}
+
+		quint64 offset = unpackInteger(position, 8);
+		quint64 size = unpackInteger(position + 8, 8);
+		int nameLength = unpackInteger(position + 16, 2);
+		position += 18;
+
+		if (end - position < nameLength)
+		{
+			Clear();
+			return (false);
+		}
+
+		QString name = QString::fromUtf8(position, nameLength);
+		position += nameLength;
+
+		QByteArray digest;
+
+		if (version >= 2)
+		{
+			if (end - position < 1 || end - position - 1 < static_cast<unsigned char>(*position))
+			{
+				Clear();
+				return (false);
+			}
+
+			int digestLength = static_cast<unsigned char>(*position);
+			digest = QByteArray(position + 1, digestLength);
+			position += 1 + digestLength;
+		}
+
+		AddMember(name, offset, size, digest);
+	}
+
+	return (true);
+}
+
+bool PackageIndex::Write(FILE *file, quint64 indexOffset) const
+{
+	QByteArray data = Pack();
+	QByteArray compressedData;
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(z_stream));
+
+	// 16 + MAX_WBITS produces a gzip member, rather than a zlib stream.
+	if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return (false);
+
+	compressedData.resize(deflateBound(&stream, data.size()) + 32);
+
+	stream.next_in = reinterpret_cast<Bytef *>(data.data());
+	stream.avail_in = data.size();
+	stream.next_out = reinterpret_cast<Bytef *>(compressedData.data());
+	stream.avail_out = compressedData.size();
+
+	int result = deflate(&stream, Z_FINISH);
+	compressedData.resize(stream.total_out);
+
+	deflateEnd(&stream);
+
+	if (result != Z_STREAM_END)
+		return (false);
+
+	compressedData.append(packFooter(indexOffset));
+
+	return (fwrite(compressedData.constData(), 1, compressedData.size(), file) == static_cast<size_t>(compressedData.size()));
+}
+
+int PackageIndex::Read(const QString& packagePath)
+{
+	Clear();
+
+	QFile packageFile(packagePath);
+
+	if (!packageFile.open(QFile::ReadOnly))
+		return (kReadFailed);
+
+	qint64 packageSize = packageFile.size();
+
+	if (packageSize < kFooterLength || !packageFile.seek(packageSize - kFooterLength))
+		return (kReadNoIndex);
+
+	QByteArray footer = packageFile.read(kFooterLength);
+
+	if (footer.size() != kFooterLength)
+		return (kReadFailed);
+
+	quint64 indexOffset = unpackInteger(footer.constData() + 20, 8);
+
+	// Packages without an index are still perfectly valid, they're just slower to load.
+	if (footer != packFooter(indexOffset))
+		return (kReadNoIndex);
+
+	quint64 indexEnd = packageSize - kFooterLength;
+
+	if (indexOffset >= indexEnd || indexEnd - indexOffset > kMaxIndexLength || !packageFile.seek(indexOffset))
+		return (kReadFailed);
+
+	QByteArray compressedData = packageFile.read(indexEnd - indexOffset);
+
+	if (static_cast<quint64>(compressedData.size()) != indexEnd - indexOffset)
+		return (kReadFailed);
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(z_stream));
+
+	if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+		return (kReadFailed);
+
+	stream.next_in = reinterpret_cast<Bytef *>(compressedData.data());
+	stream.avail_in = compressedData.size();
+
+	QByteArray data;
+	char buffer[16384];
+	int result;
+
+	do
+	{
+		stream.next_out = reinterpret_cast<Bytef *>(buffer);
+		stream.avail_out = sizeof(buffer);
+
+		result = inflate(&stream, Z_NO_FLUSH);
+
+		if (result != Z_OK && result != Z_STREAM_END)
+			break;
+
+		data.append(buffer, sizeof(buffer) - stream.avail_out);
+	} while (result != Z_STREAM_END && data.size() <= kMaxIndexLength);
+
+	inflateEnd(&stream);
+
+	if (result != Z_STREAM_END || !Unpack(data))
+		return (kReadFailed);
+
+	return (kReadSucceeded);
+}
+
+bool PackageIndex::ExtractMember(const QString& packagePath, const PackageIndexMember& member, QFile *outputFile) const
+{
+	if (accessPoints.isEmpty())
+		return (false);
+
+	// Begin decompressing from the last access point at or before the member's data.
+	int accessPointIndex = 0;
+
+	while (accessPointIndex + 1 < accessPoints.length() && accessPoints[accessPointIndex + 1].uncompressedOffset <= member.offset)
+		accessPointIndex++;
+
+	const GzipAccessPoint& accessPoint = accessPoints[accessPointIndex];
+
+	if (accessPoint.uncompressedOffset > member.offset)
+		return (false);
+
+	QFile packageFile(packagePath);
+
+	if (!packageFile.open(QFile::ReadOnly) || !packageFile.seek(accessPoint.compressedOffset))
+		return (false);
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(z_stream));
+
+	// Each block was compressed independently, so raw inflation can begin at its start without a dictionary.
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+		return (false);
+
+	QByteArray inputBuffer(kExtractBufferLength, 0);
+	QByteArray outputBuffer(kExtractBufferLength, 0);
+
+	quint64 bytesToSkip = member.offset - accessPoint.uncompressedOffset;
+	quint64 bytesRemaining = member.size;
+	bool success = true;
+
+	while (bytesRemaining > 0)
+	{
+		if (stream.avail_in == 0)
+		{
+			qint64 bytesRead = packageFile.read(inputBuffer.data(), inputBuffer.size());
+
+			if (bytesRead <= 0)
+			{
+				success = false;
+				break;
+			}
+
+			stream.next_in = reinterpret_cast<Bytef *>(inputBuffer.data());
+			stream.avail_in = bytesRead;
+		}
+
+		stream.next_out = reinterpret_cast<Bytef *>(outputBuffer.data());
+		stream.avail_out = outputBuffer.size();
+
+		int result = inflate(&stream, Z_NO_FLUSH);
+
+		if (result != Z_OK && result != Z_STREAM_END)
+		{
+			success = false;
+			break;
+		}
+
+		quint64 outputLength = outputBuffer.size() - stream.avail_out;
+		quint64 outputOffset = (bytesToSkip < outputLength) ? bytesToSkip : outputLength;
+
+		bytesToSkip -= outputOffset;
+
+		quint64 dataLength = outputLength - outputOffset;
+
+		if (dataLength > bytesRemaining)
+			dataLength = bytesRemaining;
+
+		if (dataLength > 0 && outputFile->write(outputBuffer.constData() + outputOffset, dataLength) != static_cast<qint64>(dataLength))
+		{
+			success = false;
+			break;
+		}
+
+		bytesRemaining -= dataLength;
+
+		if (result == Z_STREAM_END && bytesRemaining > 0)
+		{
+			success = false;
+			break;
+		}
+	}
+
+	inflateEnd(&stream);
+
+	return (success);
+}
@@ -0,0 +1,105 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef PACKAGEINDEX_H
+#define PACKAGEINDEX_H
+
+// C/C++ Standard Library
+#include <stdio.h>
+
+// Qt
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+
+// Heimdall Frontend
+#include "ParallelGzipWriter.h"
+
+namespace HeimdallFrontend
+{
+	struct PackageIndexMember
+	{
+		QString name;
+		quint64 offset; // Of the member's data in the TAR archive.
+		quint64 size;
+
+		QByteArray digest; // SHA-256 of the member's data, empty if the index predates digests.
+	};
+
+	// Locates each file within a package, so that files can be decompressed individually. The index is stored in a gzip
+	// member following the package's TAR archive, and is found via an empty gzip member at the very end of the package
+	// whose extra field holds the index's offset. Decompressors simply see some trailing data after the TAR archive.
+	class PackageIndex
+	{
+		public:
+
+			enum
+			{
+				kVersion = 2,
+				kFooterLength = 38,
+				kMaxIndexLength = 67108864
+			};
+
+			enum
+			{
+				kReadSucceeded = 0,
+				kReadFailed,
+				kReadNoIndex
+			};
+
+		private:
+
+			QList<GzipAccessPoint> accessPoints;
+			QList<PackageIndexMember> members;
+
+			QByteArray Pack(void) const;
+			bool Unpack(const QByteArray& data);
+
+		public:
+
+			void Clear(void);
+
+			bool IsEmpty(void) const
+			{
+				return (members.isEmpty());
+			}
+
+			void SetAccessPoints(const QList<GzipAccessPoint>& accessPoints)
+			{
+				this->accessPoints = accessPoints;
+			}
+
+			void AddMember(const QString& name, quint64 offset, quint64 size, const QByteArray& digest = QByteArray());
+
+			const QList<PackageIndexMember>& GetMembers(void) const
+			{
+				return (members);
+			}
+
+			// Appends the index to a package, at indexOffset i.e. the end of the package's gzip member.
+			bool Write(FILE *file, quint64 indexOffset) const;
+			int Read(const QString& packagePath);
+
+			bool ExtractMember(const QString& packagePath, const PackageIndexMember& member, QFile *outputFile) const;
+	};
+}
+
+#endif
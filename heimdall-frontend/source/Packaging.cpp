@@ -24,64 +24,169 @@
 
 // C/C++ Standard Library
 #include <stdio.h>
+#include <string>
 
 // zlib
 #include "zlib.h"
 
 // Qt
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QDir>
-#include <QProgressDialog>
+#include <QStandardPaths>
+
+// Heimdall
+#include "ImageCache.h"
 
 // Heimdall Frontend
 #include "Alerts.h"
 #include "Packaging.h"
+#include "PackagingProgress.h"
+#include "ParallelGzipWriter.h"
 
 using namespace HeimdallFrontend;
 
 const qint64 Packaging::kMaxFileSize = 8589934592ll;
 const char *Packaging::ustarMagic = "ustar";
 
-bool Packaging::ExtractTar(QTemporaryFile& tarFile, PackageData *packageData)
+// Reads exactly length bytes of the decompressed TAR archive. Anything less means the package is truncated or corrupt.
+static bool readTarData(gzFile packageFile, char *buffer, unsigned int length)
 {
-	TarHeader tarHeader;
+	unsigned int totalBytesRead = 0;
 
-	if (!tarFile.open())
+	while (totalBytesRead < length)
 	{
-		Alerts::DisplayError(QString("Error opening temporary TAR archive:\n%1").arg(tarFile.fileName()));
-		return (false);
+		int bytesRead = gzread(packageFile, buffer + totalBytesRead, length - totalBytesRead);
+
+		if (bytesRead <= 0)
+			return (false);
+
+		totalBytesRead += bytesRead;
 	}
 
-	bool previousEmpty = false;
+	return (true);
+}
 
-	QProgressDialog progressDialog("Extracting files...", "Cancel", 0, tarFile.size());
-	progressDialog.setWindowModality(Qt::ApplicationModal);
-	progressDialog.setWindowTitle("Heimdall Frontend");
+// Once a task is canceled, its window may be closing and waiting for it to finish, so its errors are no longer raised.
+static void displayError(const PackagingProgress *progress, const QString& errorMessage)
+{
+	if (!progress->WasCanceled())
+		Alerts::DisplayError(errorMessage);
+}
 
-	while (!tarFile.atEnd())
-	{
-		qint64 dataRead = tarFile.read(tarHeader.buffer, TarHeader::kBlockLength);
+// Files decompressed from indexed packages are cached by digest, so that each firmware build is only decompressed once. Returns
+// nullptr if the cache directory can't be created.
+static const Heimdall::ImageCache *getImageCache(void)
+{
+	static const QString directory = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("images");
+	static const Heimdall::ImageCache imageCache(QDir::toNativeSeparators(directory).toLocal8Bit().constData());
+	static const bool available = QDir().mkpath(directory);
 
-		if (dataRead != TarHeader::kBlockLength)
-		{
-			progressDialog.close();
-			Alerts::DisplayError("Package's TAR archive is malformed.");
+	return (available ? &imageCache : nullptr);
+}
 
-			tarFile.close();
+static bool copyFile(QFile *sourceFile, QFile *destinationFile)
+{
+	QByteArray buffer(262144, 0);
+	qint64 bytesRead;
 
+	while ((bytesRead = sourceFile->read(buffer.data(), buffer.size())) > 0)
+	{
+		if (destinationFile->write(buffer.constData(), bytesRead) != bytesRead)
 			return (false);
-		}
+	}
+
+	return (bytesRead == 0);
+}
+
+// Whether the SHA-256 of the whole of file is digest. Leaves file positioned at its end.
+static bool matchesDigest(QFile *file, const QByteArray& digest)
+{
+	QCryptographicHash hash(QCryptographicHash::Sha256);
+
+	if (!file->seek(0) || !hash.addData(file))
+		return (false);
 
-		progressDialog.setValue(tarFile.pos());
+	return (hash.result() == digest);
+}
+
+// Copies the member from the image cache if it's been decompressed before, otherwise decompresses it and adds it to the cache.
+static bool extractCachedMember(const PackageData *packageData, const PackageIndexMember& member, QFile *outputFile)
+{
+	const PackageIndex& packageIndex = packageData->GetPackageIndex();
+	const Heimdall::ImageCache *imageCache = member.digest.isEmpty() ? nullptr : getImageCache();
+
+	if (!imageCache)
+		return (packageIndex.ExtractMember(packageData->GetPackagePath(), member, outputFile));
+
+	std::string key = member.digest.toHex().constData();
+	std::string cachedFilename = imageCache->Find(key);
+
+	if (!cachedFilename.empty())
+	{
+		QFile cachedFile(QString::fromLocal8Bit(cachedFilename.c_str()));
 
-		if (progressDialog.wasCanceled())
+		if (cachedFile.open(QFile::ReadOnly) && copyFile(&cachedFile, outputFile)
+			&& static_cast<quint64>(outputFile->size()) == member.size && matchesDigest(outputFile, member.digest))
 		{
-			tarFile.close();
-			progressDialog.close();
+			return (true);
+		}
+
+		// The cached file is unusable, decompress the member instead.
+		outputFile->resize(0);
+		outputFile->seek(0);
+	}
+
+	if (!packageIndex.ExtractMember(packageData->GetPackagePath(), member, outputFile) || !outputFile->flush())
+		return (false);
 
+	// The cache is keyed by content, so a truncated or corrupt extraction must never be stored under the member's digest.
+	if (!matchesDigest(outputFile, member.digest))
+		return (false);
+
+	// Failing to cache the file doesn't prevent it being flashed.
+	FILE *file = fopen(QDir::current().absoluteFilePath(outputFile->fileName()).toLocal8Bit().constData(), "rb");
+
+	if (file)
+	{
+		imageCache->Store(key, file);
+		fclose(file);
+	}
+
+	return (true);
+}
+
+bool Packaging::ExtractTar(gzFile packageFile, quint64 compressedFileSize, PackageData *packageData, PackagingProgress *progress)
+{
+	TarHeader tarHeader;
+
+	bool previousEmpty = false;
+
+	// Progress is measured in KiB of the compressed package, so it fits in an int.
+	progress->SetLabelText("Extracting package...");
+	progress->SetMaximum(compressedFileSize >> 10);
+
+	char buffer[kExtractBufferLength];
+
+	for (;;)
+	{
+		int headerBytesRead = gzread(packageFile, tarHeader.buffer, TarHeader::kBlockLength);
+
+		// Archives may simply end at a block boundary, rather than with two empty blocks.
+		if (headerBytesRead == 0 && gzeof(packageFile))
+			break;
+
+		if (headerBytesRead < 0 || !readTarData(packageFile, tarHeader.buffer + headerBytesRead, TarHeader::kBlockLength - headerBytesRead))
+		{
+			displayError(progress, "Package's TAR archive is malformed.");
 			return (false);
 		}
 
+		progress->SetValue(gzoffset(packageFile) >> 10);
+
+		if (progress->WasCanceled())
+			return (false);
+
 		//bool ustarFormat = strcmp(tarHeader.fields.magic, ustarMagic) == 0;
 		bool empty = true;
 
@@ -130,11 +235,7 @@ bool Packaging::ExtractTar(QTemporaryFile& tarFile, PackageData *packageData)
 
 			if (!parsed)
 			{
-				progressDialog.close();
-				Alerts::DisplayError("Tar header contained an invalid file size.");
-
-				tarFile.close();
-
+				displayError(progress, "Tar header contained an invalid file size.");
 				return (false);
 			}
 
@@ -148,52 +249,48 @@ bool Packaging::ExtractTar(QTemporaryFile& tarFile, PackageData *packageData)
 
 				if (!outputFile->open())
 				{
-					progressDialog.close();
-					Alerts::DisplayError(QString("Failed to open output file: \n%1").arg(outputFile->fileName()));
-
-					tarFile.close();
-
+					displayError(progress, QString("Failed to open output file: \n%1").arg(outputFile->fileName()));
 					return (false);
 				}
 
 				qulonglong dataRemaining = fileSize;
-				char readBuffer[TarHeader::kBlockReadCount * TarHeader::kBlockLength];
 
-				// Copy the file contents from tarFile to outputFile
+				// Decompress the file contents straight into outputFile
 				while (dataRemaining > 0)
 				{
-					qint64 fileDataToRead = (dataRemaining < TarHeader::kBlockReadCount * TarHeader::kBlockLength)
-						? dataRemaining : TarHeader::kBlockReadCount * TarHeader::kBlockLength;
+					qint64 fileDataToRead = (dataRemaining < kExtractBufferLength) ? dataRemaining : kExtractBufferLength;
 
-					qint64 dataRead = tarFile.read(readBuffer, fileDataToRead + (TarHeader::kBlockLength - fileDataToRead % TarHeader::kBlockLength) % TarHeader::kBlockLength);
+					// kExtractBufferLength is a multiple of the block length, so only the last read is padded.
+					qint64 paddedDataToRead = fileDataToRead + (TarHeader::kBlockLength - fileDataToRead % TarHeader::kBlockLength) % TarHeader::kBlockLength;
 
-					if (dataRead < fileDataToRead || dataRead % TarHeader::kBlockLength != 0)
+					if (!readTarData(packageFile, buffer, paddedDataToRead))
 					{
-						progressDialog.close();
-						Alerts::DisplayError("Unexpected read error whilst extracting package files.");
+						displayError(progress, "Unexpected read error whilst extracting package files.");
 
-						tarFile.close();
 						outputFile->close();
-
-						remove(outputFile->fileName().toStdString().c_str());
+						outputFile->remove();
 
 						return (false);
 					}
 
-					outputFile->write(readBuffer, fileDataToRead);
+					if (outputFile->write(buffer, fileDataToRead) != fileDataToRead)
+					{
+						displayError(progress, QString("Failed to write output file: \n%1").arg(outputFile->fileName()));
+
+						outputFile->close();
+						outputFile->remove();
+
+						return (false);
+					}
 
 					dataRemaining -= fileDataToRead;
 
-					progressDialog.setValue(tarFile.pos());
+					progress->SetValue(gzoffset(packageFile) >> 10);
 
-					if (progressDialog.wasCanceled())
+					if (progress->WasCanceled())
 					{
-						tarFile.close();
 						outputFile->close();
-
-						remove(outputFile->fileName().toStdString().c_str());
-
-						progressDialog.close();
+						outputFile->remove();
 
 						return (false);
 					}
@@ -203,11 +300,7 @@ bool Packaging::ExtractTar(QTemporaryFile& tarFile, PackageData *packageData)
 			}
 			else
 			{
-				progressDialog.close();
-				Alerts::DisplayError("Heimdall packages shouldn't contain links or directories.");
-
-				tarFile.close();
-
+				displayError(progress, "Heimdall packages shouldn't contain links or directories.");
 				return (false);
 			}
 		}
@@ -215,13 +308,11 @@ bool Packaging::ExtractTar(QTemporaryFile& tarFile, PackageData *packageData)
 		previousEmpty = empty;
 	}
 
-	progressDialog.close();
-	tarFile.close();
-
 	return (true);
 }
 
-bool Packaging::WriteTarEntry(const QString& filePath, QTemporaryFile *tarFile, const QString& entryFilename)
+bool Packaging::WriteTarEntry(const QString& filePath, ParallelGzipWriter *packageWriter, PackageIndex *packageIndex,
+	const QString& entryFilename, PackagingProgress *progress)
 {
 	TarHeader tarHeader;
 	memset(tarHeader.buffer, 0, TarHeader::kBlockLength);
@@ -230,13 +321,13 @@ bool Packaging::WriteTarEntry(const QString& filePath, QTemporaryFile *tarFile,
 
 	if (!file.open(QFile::ReadOnly))
 	{
-		Alerts::DisplayError(QString("Failed to open file: \n%1").arg(file.fileName()));
+		displayError(progress, QString("Failed to open file: \n%1").arg(file.fileName()));
 		return (false);
 	}
 
 	if (file.size() > Packaging::kMaxFileSize)
 	{
-		Alerts::DisplayError(QString("File is too large to be packaged:\n%1").arg(file.fileName()));
+		displayError(progress, QString("File is too large to be packaged:\n%1").arg(file.fileName()));
 		return (false);
 	}
 
@@ -247,7 +338,7 @@ bool Packaging::WriteTarEntry(const QString& filePath, QTemporaryFile *tarFile,
 
 	if (utfFilename.length() > 100)
 	{
-		Alerts::DisplayError(QString("File name is too long:\n%1").arg(qtFileInfo.fileName()));
+		displayError(progress, QString("File name is too long:\n%1").arg(qtFileInfo.fileName()));
 		return (false);
 	}
 
@@ -316,54 +407,71 @@ bool Packaging::WriteTarEntry(const QString& filePath, QTemporaryFile *tarFile,
 	sprintf(tarHeader.fields.checksum, "%07o", checksum);
 
 	// Write the header to the TAR file.
-	tarFile->write(tarHeader.buffer, TarHeader::kBlockLength);
+	if (!packageWriter->Write(tarHeader.buffer, TarHeader::kBlockLength))
+	{
+		displayError(progress, "Error compressing package.");
+		return (false);
+	}
 
-	char buffer[TarHeader::kBlockWriteCount * TarHeader::kBlockLength];
+	// The member is indexed once it's written, along with its digest.
+	quint64 memberOffset = packageWriter->GetUncompressedSize();
+	QCryptographicHash hash(QCryptographicHash::Sha256);
+
+	char buffer[kCompressBufferLength];
 	qint64 offset = 0;
 
 	while (offset < file.size())
 	{
-		qint64 dataRead = file.read(buffer, TarHeader::kBlockWriteCount * TarHeader::kBlockLength);
+		qint64 dataRead = file.read(buffer, kCompressBufferLength);
 
-		if (tarFile->write(buffer, dataRead) != dataRead)
+		if (dataRead <= 0)
 		{
-			Alerts::DisplayError("Failed to write data to the temporary TAR file.");
+			displayError(progress, QString("Failed to read file: \n%1").arg(file.fileName()));
 			return (false);
 		}
 
+		hash.addData(buffer, dataRead);
+
+		// kCompressBufferLength is a multiple of the block length, so only the last read is padded.
 		if (dataRead % TarHeader::kBlockLength != 0)
 		{
 			int remainingBlockLength = TarHeader::kBlockLength - dataRead % TarHeader::kBlockLength;
-			memset(buffer, 0, remainingBlockLength);
+			memset(buffer + dataRead, 0, remainingBlockLength);
 
-			if (tarFile->write(buffer, remainingBlockLength) != remainingBlockLength)
-			{
-				Alerts::DisplayError("Failed to write data to the temporary TAR file.");
-				return (false);
-			}
+			offset += dataRead;
+			dataRead += remainingBlockLength;
+		}
+		else
+		{
+			offset += dataRead;
 		}
 
-		offset += dataRead;
+		if (!packageWriter->Write(buffer, dataRead))
+		{
+			displayError(progress, "Error compressing package.");
+			return (false);
+		}
+
+		progress->SetValue(packageWriter->GetUncompressedSize() >> 10);
+
+		if (progress->WasCanceled())
+			return (false);
 	}
 
+	packageIndex->AddMember(entryFilename, memberOffset, file.size(), hash.result());
+
 	return (true);
 }
 
-bool Packaging::CreateTar(const FirmwareInfo& firmwareInfo, QTemporaryFile *tarFile)
+bool Packaging::CreateTar(const FirmwareInfo& firmwareInfo, ParallelGzipWriter *packageWriter, PackageIndex *packageIndex, PackagingProgress *progress)
 {
 	const QList<FileInfo>& fileInfos = firmwareInfo.GetFileInfos();
 
-	QProgressDialog progressDialog("Packaging files...", "Cancel", 0, fileInfos.length() + 2);
-	progressDialog.setWindowModality(Qt::ApplicationModal);
-	progressDialog.setWindowTitle("Heimdall Frontend");
-
 	QTemporaryFile firmwareXmlFile("XXXXXX-firmware.xml");
 
 	if (!firmwareXmlFile.open())
 	{
-		progressDialog.close();
-		Alerts::DisplayError(QString("Failed to create temporary file: \n%1").arg(firmwareXmlFile.fileName()));
-
+		displayError(progress, QString("Failed to create temporary file: \n%1").arg(firmwareXmlFile.fileName()));
 		return (false);
 	}
 
@@ -371,13 +479,14 @@ bool Packaging::CreateTar(const FirmwareInfo& firmwareInfo, QTemporaryFile *tarF
 	firmwareInfo.WriteXml(xml);
 	firmwareXmlFile.close();
 
-	if (!tarFile->open())
-	{
-		progressDialog.close();
-		Alerts::DisplayError(QString("Failed to open file: \n%1").arg(tarFile->fileName()));
+	// Progress is measured in KiB of the TAR archive, so it fits in an int.
+	qint64 totalSize = QFileInfo(firmwareInfo.GetPitFilename()).size() + QFileInfo(firmwareXmlFile.fileName()).size();
 
-		return (false);
-	}
+	for (int i = 0; i < fileInfos.length(); i++)
+		totalSize += QFileInfo(fileInfos[i].GetFilename()).size();
+
+	progress->SetLabelText("Building package...");
+	progress->SetMaximum(totalSize >> 10);
 
 	for (int i = 0; i < fileInfos.length(); i++)
 	{
@@ -394,38 +503,18 @@ bool Packaging::CreateTar(const FirmwareInfo& firmwareInfo, QTemporaryFile *tarF
 		}
 
 		if (skip)
-		{
-			progressDialog.setValue(i);
 			continue;
-		}
 
 		QString filename = ClashlessFilename(fileInfos, i);
 
 		if (filename == "firmware.xml")
 		{
-			Alerts::DisplayError("You cannot name your partition files \"firmware.xml\".\nIt is a reserved name.");
+			displayError(progress, "You cannot name your partition files \"firmware.xml\".\nIt is a reserved name.");
 			return (false);
 		}
 
-		if (!WriteTarEntry(fileInfos[i].GetFilename(), tarFile, filename))
+		if (!WriteTarEntry(fileInfos[i].GetFilename(), packageWriter, packageIndex, filename, progress))
 		{
-			tarFile->resize(0);
-			tarFile->close();
-
-			progressDialog.close();
-
-			return (false);
-		}
-
-		progressDialog.setValue(i);
-
-		if (progressDialog.wasCanceled())
-		{
-			tarFile->resize(0);
-			tarFile->close();
-
-			progressDialog.close();
-
 			return (false);
 		}
 	}
@@ -439,60 +528,119 @@ bool Packaging::CreateTar(const FirmwareInfo& firmwareInfo, QTemporaryFile *tarF
 
 	if (pitFilename == "firmware.xml")
 	{
-		Alerts::DisplayError("You cannot name your PIT file \"firmware.xml\".\nIt is a reserved name.");
+		displayError(progress, "You cannot name your PIT file \"firmware.xml\".\nIt is a reserved name.");
 		return (false);
 	}
 
-	if (!WriteTarEntry(firmwareInfo.GetPitFilename(), tarFile, pitFilename))
+	if (!WriteTarEntry(firmwareInfo.GetPitFilename(), packageWriter, packageIndex, pitFilename, progress)
+		|| !WriteTarEntry(firmwareXmlFile.fileName(), packageWriter, packageIndex, "firmware.xml", progress))
 	{
-		tarFile->resize(0);
-		tarFile->close();
+		return (false);
+	}
 
+	// Write two empty blocks to signify the end of the archive.
+	char emptyEntry[TarHeader::kBlockLength];
+	memset(emptyEntry, 0, TarHeader::kBlockLength);
+
+	if (!packageWriter->Write(emptyEntry, TarHeader::kBlockLength) || !packageWriter->Write(emptyEntry, TarHeader::kBlockLength))
+	{
+		displayError(progress, "Error compressing package.");
 		return (false);
 	}
 
-	progressDialog.setValue(progressDialog.value() + 1);
+	return (true);
+}
+
+bool Packaging::ExtractIndexedPackage(const QString& packagePath, const PackageIndex& packageIndex, PackageData *packageData,
+	PackagingProgress *progress)
+{
+	const QList<PackageIndexMember>& members = packageIndex.GetMembers();
+
+	packageData->SetPackageIndex(packagePath, packageIndex);
+
+	// Every file is created up front, so its final path is known, but only firmware.xml and the PIT are decompressed now.
+	int firmwareXmlIndex = -1;
 
-	if (progressDialog.wasCanceled())
+	for (int i = 0; i < members.length(); i++)
 	{
-		tarFile->resize(0);
-		tarFile->close();
+		QTemporaryFile *outputFile = new QTemporaryFile("XXXXXX-" + members[i].name);
+		packageData->GetFiles().append(outputFile);
 
-		progressDialog.close();
+		if (!outputFile->open())
+		{
+			displayError(progress, QString("Failed to open output file: \n%1").arg(outputFile->fileName()));
+			packageData->Clear();
+
+			return (false);
+		}
+
+		outputFile->close();
+
+		if (members[i].name == "firmware.xml")
+			firmwareXmlIndex = i;
+		else
+			packageData->GetDeferredFiles().append(outputFile);
+	}
+
+	if (firmwareXmlIndex < 0)
+	{
+		displayError(progress, "firmware.xml is missing from the package.");
+		packageData->Clear();
 
 		return (false);
 	}
 
-	if (!WriteTarEntry(firmwareXmlFile.fileName(), tarFile, "firmware.xml"))
+	QTemporaryFile *firmwareXmlFile = packageData->GetFiles()[firmwareXmlIndex];
+
+	if (!firmwareXmlFile->open() || !packageIndex.ExtractMember(packagePath, members[firmwareXmlIndex], firmwareXmlFile))
 	{
-		tarFile->resize(0);
-		tarFile->close();
+		displayError(progress, "Error decompressing firmware.xml.");
+		packageData->Clear();
 
 		return (false);
 	}
 
-	progressDialog.setValue(progressDialog.value() + 1);
-	progressDialog.close();
+	firmwareXmlFile->close();
 
-	// Write two empty blocks to signify the end of the archive.
-	char emptyEntry[TarHeader::kBlockLength];
-	memset(emptyEntry, 0, TarHeader::kBlockLength);
+	if (!packageData->ReadFirmwareInfo(firmwareXmlFile))
+	{
+		packageData->Clear();
+		return (false);
+	}
 
-	tarFile->write(emptyEntry, TarHeader::kBlockLength);
-	tarFile->write(emptyEntry, TarHeader::kBlockLength);
+	// The PIT is needed as soon as the package is loaded.
+	QList<FileInfo> pitFileInfos;
+	pitFileInfos.append(FileInfo(0, packageData->GetFirmwareInfo().GetPitFilename()));
 
-	tarFile->close();
+	if (!ExtractDeferredFiles(packageData, pitFileInfos, progress))
+	{
+		packageData->Clear();
+		return (false);
+	}
 
 	return (true);
 }
 
-bool Packaging::ExtractPackage(const QString& packagePath, PackageData *packageData)
+bool Packaging::ExtractPackage(const QString& packagePath, PackageData *packageData, PackagingProgress *progress)
 {
+	PackageIndex packageIndex;
+	int indexResult = packageIndex.Read(packagePath);
+
+	if (indexResult == PackageIndex::kReadSucceeded)
+	{
+		return (ExtractIndexedPackage(packagePath, packageIndex, packageData, progress));
+	}
+	else if (indexResult == PackageIndex::kReadFailed)
+	{
+		displayError(progress, QString("Failed to read package index:\n%1").arg(packagePath));
+		return (false);
+	}
+
 	FILE *compressedPackageFile = fopen(packagePath.toStdString().c_str(), "rb");
 
 	if (!compressedPackageFile)
 	{
-		Alerts::DisplayError(QString("Failed to open package:\n%1").arg(packagePath));
+		displayError(progress, QString("Failed to open package:\n%1").arg(packagePath));
 		return (false);
 	}
 
@@ -502,58 +650,22 @@ bool Packaging::ExtractPackage(const QString& packagePath, PackageData *packageD
 
 	gzFile packageFile = gzdopen(fileno(compressedPackageFile), "rb");
 
-	QTemporaryFile outputTar("XXXXXX.tar");
-
-	if (!outputTar.open())
+	if (!packageFile)
 	{
-		Alerts::DisplayError("Failed to open temporary TAR archive.");
-		gzclose(packageFile);
+		displayError(progress, QString("Failed to open package:\n%1").arg(packagePath));
+		fclose(compressedPackageFile);
 
 		return (false);
 	}
 
-	char buffer[kExtractBufferLength];
-	int bytesRead;
-	quint64 totalBytesRead = 0;
-
-	QProgressDialog progressDialog("Decompressing package...", "Cancel", 0, compressedFileSize);
-	progressDialog.setWindowModality(Qt::ApplicationModal);
-	progressDialog.setWindowTitle("Heimdall Frontend");
-
-	do
-	{
-		bytesRead = gzread(packageFile, buffer, kExtractBufferLength);
-
-		if (bytesRead == -1)
-		{
-			progressDialog.close();
-			Alerts::DisplayError("Error decompressing archive.");
-
-			gzclose(packageFile);
-
-			return (false);
-		}
-
-		outputTar.write(buffer, bytesRead);
-
-		totalBytesRead += bytesRead;
-		progressDialog.setValue(totalBytesRead);
+	gzbuffer(packageFile, kExtractBufferLength);
 
-		if (progressDialog.wasCanceled())
-		{
-			gzclose(packageFile);
-			progressDialog.close();
-
-			return (false);
-		}
-	} while (bytesRead > 0);
+	// The TAR archive is parsed as it's decompressed, so each file is only written once.
+	bool extracted = ExtractTar(packageFile, compressedFileSize, packageData, progress);
 
-	progressDialog.close();
-
-	outputTar.close();
 	gzclose(packageFile); // Closes packageFile and compressedPackageFile
 
-	if (!ExtractTar(outputTar, packageData))
+	if (!extracted)
 		return (false);
 
 	// Find and read firmware.xml
@@ -573,23 +685,25 @@ bool Packaging::ExtractPackage(const QString& packagePath, PackageData *packageD
 		}
 	}
 
-	Alerts::DisplayError("firmware.xml is missing from the package.");
+	displayError(progress, "firmware.xml is missing from the package.");
 	return (false);
 }
 
-bool Packaging::BuildPackage(const QString& packagePath, const FirmwareInfo& firmwareInfo)
+bool Packaging::BuildPackage(const QString& packagePath, const FirmwareInfo& firmwareInfo, PackagingProgress *progress)
 {
 	FILE *compressedPackageFile = fopen(packagePath.toStdString().c_str(), "wb");
 
 	if (!compressedPackageFile)
 	{
-		Alerts::DisplayError(QString("Failed to create package:\n%1").arg(packagePath));
+		displayError(progress, QString("Failed to create package:\n%1").arg(packagePath));
 		return (false);
 	}
 
-	QTemporaryFile tar("XXXXXX.tar");
+	// The TAR archive is compressed as it's generated, so no intermediate TAR file is written.
+	ParallelGzipWriter packageWriter(compressedPackageFile);
+	PackageIndex packageIndex;
 
-	if (!CreateTar(firmwareInfo, &tar))
+	if (!packageWriter.Begin() || !CreateTar(firmwareInfo, &packageWriter, &packageIndex, progress))
 	{
 		fclose(compressedPackageFile);
 		remove(packagePath.toStdString().c_str());
@@ -597,69 +711,88 @@ bool Packaging::BuildPackage(const QString& packagePath, const FirmwareInfo& fir
 		return (false);
 	}
 
-	if (!tar.open())
+	bool compressed = packageWriter.Finish();
+
+	if (compressed)
 	{
-		Alerts::DisplayError(QString("Failed to open temporary file: \n%1").arg(tar.fileName()));
+		packageIndex.SetAccessPoints(packageWriter.GetAccessPoints());
+		compressed = packageIndex.Write(compressedPackageFile, packageWriter.GetCompressedSize());
+	}
 
-		fclose(compressedPackageFile);
+	if (fclose(compressedPackageFile) != 0)
+		compressed = false;
+
+	if (!compressed)
+	{
+		displayError(progress, "Error compressing package.");
 		remove(packagePath.toStdString().c_str());
 
 		return (false);
 	}
-	
-	gzFile packageFile = gzdopen(fileno(compressedPackageFile), "wb");
 
-	char buffer[kCompressBufferLength];
-	qint64 totalBytesRead = 0;
-	int bytesRead;
+	return (true);
+}
 
-	QProgressDialog progressDialog("Compressing package...", "Cancel", 0, tar.size());
-	progressDialog.setWindowModality(Qt::ApplicationModal);
-	progressDialog.setWindowTitle("Heimdall Frontend");
+bool Packaging::ExtractDeferredFiles(PackageData *packageData, const QList<FileInfo>& fileInfos, PackagingProgress *progress)
+{
+	QList<QTemporaryFile *>& deferredFiles = packageData->GetDeferredFiles();
+	const QList<PackageIndexMember>& members = packageData->GetPackageIndex().GetMembers();
 
-	do
-	{
-		bytesRead = tar.read(buffer, kCompressBufferLength);
+	progress->SetLabelText("Decompressing files...");
+	progress->SetMaximum(deferredFiles.length());
 
-		if (bytesRead == -1)
-		{
-			progressDialog.close();
-			Alerts::DisplayError("Error reading temporary TAR file.");
+	for (int i = 0; i < deferredFiles.length();)
+	{
+		QTemporaryFile *file = deferredFiles[i];
+		QString filePath = QDir::current().absoluteFilePath(file->fileName());
 
-			gzclose(packageFile);
-			remove(packagePath.toStdString().c_str());
+		// Files can be referred to by either their temporary file name or their name within the package.
+		bool required = false;
 
-			return (false);
+		for (int j = 0; j < fileInfos.length(); j++)
+		{
+			if (fileInfos[j].GetFilename() == filePath || ("XXXXXX-" + fileInfos[j].GetFilename()) == file->fileTemplate())
+			{
+				required = true;
+				break;
+			}
 		}
 
-		if (gzwrite(packageFile, buffer, bytesRead) != bytesRead)
+		if (!required)
 		{
-			progressDialog.close();
-			Alerts::DisplayError("Error compressing package.");
+			i++;
+			continue;
+		}
 
-			gzclose(packageFile);
-			remove(packagePath.toStdString().c_str());
+		const PackageIndexMember *member = nullptr;
 
-			return (false);
+		for (int j = 0; j < members.length(); j++)
+		{
+			if (("XXXXXX-" + members[j].name) == file->fileTemplate())
+			{
+				member = &members[j];
+				break;
+			}
 		}
 
-		totalBytesRead += bytesRead;
-		progressDialog.setValue(totalBytesRead);
-
-		if (progressDialog.wasCanceled())
+		if (!member || !file->open() || !extractCachedMember(packageData, *member, file))
 		{
-			gzclose(packageFile);
-			remove(packagePath.toStdString().c_str());
+			displayError(progress, QString("Error decompressing %1 from the package.").arg(file->fileTemplate().mid(7)));
 
-			progressDialog.close();
+			file->resize(0);
+			file->close();
 
 			return (false);
 		}
-	} while (bytesRead > 0);
 
-	progressDialog.close();
+		file->close();
+		deferredFiles.removeAt(i);
 
-	gzclose(packageFile); // Closes packageFile and compressedPackageFile
+		progress->SetValue(progress->GetValue() + 1);
+
+		if (progress->WasCanceled())
+			return (false);
+	}
 
 	return (true);
 }
@@ -21,6 +21,9 @@
 #ifndef PACKAGING_H
 #define PACKAGING_H
 
+// zlib
+#include "zlib.h"
+
 // Qt
 #include <QList>
 #include <QString>
@@ -28,9 +31,13 @@
 
 // Heimdall Frontend
 #include "PackageData.h"
+#include "PackageIndex.h"
 
 namespace HeimdallFrontend
 {
+	class PackagingProgress;
+	class ParallelGzipWriter;
+
 	union TarHeader
 	{		
 		enum
@@ -101,17 +108,25 @@ namespace HeimdallFrontend
 			};
 			
 			// TODO: Add support for sparse files to both methods?
-			static bool ExtractTar(QTemporaryFile& tarFile, PackageData *packageData);
+			static bool ExtractTar(gzFile packageFile, quint64 compressedFileSize, PackageData *packageData, PackagingProgress *progress);
+			static bool ExtractIndexedPackage(const QString& packagePath, const PackageIndex& packageIndex, PackageData *packageData,
+				PackagingProgress *progress);
 
-			static bool WriteTarEntry(const QString& filePath, QTemporaryFile *tarFile, const QString& entryFilename);
-			static bool CreateTar(const FirmwareInfo& firmwareInfo, QTemporaryFile *tarFile); // Uses original TAR format.
+			static bool WriteTarEntry(const QString& filePath, ParallelGzipWriter *packageWriter, PackageIndex *packageIndex,
+				const QString& entryFilename, PackagingProgress *progress);
+			static bool CreateTar(const FirmwareInfo& firmwareInfo, ParallelGzipWriter *packageWriter, PackageIndex *packageIndex,
+				PackagingProgress *progress); // Uses original TAR format.
 
 		public:
 
 			static const char *ustarMagic;
 
-			static bool ExtractPackage(const QString& packagePath, PackageData *packageData);
-			static bool BuildPackage(const QString& packagePath, const FirmwareInfo& firmwareInfo);
+			// These may be run on a worker thread, progress is reported (and cancellation checked) through progress.
+			static bool ExtractPackage(const QString& packagePath, PackageData *packageData, PackagingProgress *progress);
+			static bool BuildPackage(const QString& packagePath, const FirmwareInfo& firmwareInfo, PackagingProgress *progress);
+
+			// Indexed packages are loaded without decompressing partition files, this decompresses those in fileInfos.
+			static bool ExtractDeferredFiles(PackageData *packageData, const QList<FileInfo>& fileInfos, PackagingProgress *progress);
 
 			static QString ClashlessFilename(const QList<FileInfo>& fileInfos, int fileInfoIndex);
 			static QString ClashlessFilename(const QList<FileInfo>& fileInfos, const QString& filename);
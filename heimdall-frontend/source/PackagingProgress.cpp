@@ -0,0 +1,69 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// Heimdall Frontend
+#include "PackagingProgress.h"
+
+using namespace HeimdallFrontend;
+
+PackagingProgress::PackagingProgress() :
+	canceled(0),
+	value(0)
+{
+}
+
+void PackagingProgress::Reset(void)
+{
+	canceled.storeRelease(0);
+	value = 0;
+}
+
+void PackagingProgress::SetLabelText(const QString& labelText)
+{
+	emit LabelTextChanged(labelText);
+}
+
+void PackagingProgress::SetMaximum(int maximum)
+{
+	value = 0;
+
+	emit MaximumChanged(maximum);
+	emit ValueChanged(0);
+}
+
+void PackagingProgress::SetValue(int value)
+{
+	// Each signal is queued for the GUI thread, so only changes are reported.
+	if (value == this->value)
+		return;
+
+	this->value = value;
+	emit ValueChanged(value);
+}
+
+bool PackagingProgress::WasCanceled(void) const
+{
+	return (canceled.loadAcquire() != 0);
+}
+
+void PackagingProgress::Cancel(void)
+{
+	canceled.storeRelease(1);
+}
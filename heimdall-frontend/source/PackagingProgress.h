@@ -0,0 +1,70 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef PACKAGINGPROGRESS_H
+#define PACKAGINGPROGRESS_H
+
+// Qt
+#include <QAtomicInt>
+#include <QObject>
+#include <QString>
+
+namespace HeimdallFrontend
+{
+	// Packaging runs on a worker thread. Progress is reported through queued signals and the GUI thread may cancel at any time.
+	class PackagingProgress : public QObject
+	{
+		Q_OBJECT
+
+		private:
+
+			QAtomicInt canceled;
+			int value;
+
+		public:
+
+			PackagingProgress();
+
+			void Reset(void);
+
+			void SetLabelText(const QString& labelText);
+			void SetMaximum(int maximum);
+			void SetValue(int value);
+
+			int GetValue(void) const
+			{
+				return (value);
+			}
+
+			bool WasCanceled(void) const;
+
+		public slots:
+
+			void Cancel(void);
+
+		signals:
+
+			void LabelTextChanged(const QString& labelText);
+			void MaximumChanged(int maximum);
+			void ValueChanged(int value);
+	};
+}
+
+#endif
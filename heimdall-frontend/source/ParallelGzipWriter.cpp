@@ -0,0 +1,201 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <string.h>
+
+// Qt
+#include <QThread>
+#include <QtConcurrentRun>
+
+// Heimdall Frontend
+#include "ParallelGzipWriter.h"
+
+using namespace HeimdallFrontend;
+
+static CompressedBlock compressBlock(QByteArray input, int level, bool last)
+{
+	CompressedBlock compressedBlock;
+	compressedBlock.crc = crc32(0, reinterpret_cast<const Bytef *>(input.constData()), input.size());
+	compressedBlock.length = input.size();
+	compressedBlock.success = false;
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(z_stream));
+
+	// Raw deflate, the gzip header and trailer are written by ParallelGzipWriter.
+	if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return (compressedBlock);
+
+	// deflateBound() doesn't account for the empty stored block written by a sync flush.
+	compressedBlock.data.resize(deflateBound(&stream, input.size()) + 16);
+
+	stream.next_in = reinterpret_cast<Bytef *>(input.data());
+	stream.avail_in = input.size();
+	stream.next_out = reinterpret_cast<Bytef *>(compressedBlock.data.data());
+	stream.avail_out = compressedBlock.data.size();
+
+	// Non-final blocks are sync flushed so that the next block begins on a byte boundary.
+	int result = deflate(&stream, (last) ? Z_FINISH : Z_SYNC_FLUSH);
+
+	if ((last && result == Z_STREAM_END) || (!last && result == Z_OK && stream.avail_in == 0 && stream.avail_out > 0))
+	{
+		compressedBlock.data.resize(stream.total_out);
+		compressedBlock.success = true;
+	}
+
+	deflateEnd(&stream);
+
+	return (compressedBlock);
+}
+
+ParallelGzipWriter::ParallelGzipWriter(FILE *file, int level)
+{
+	this->file = file;
+	this->level = level;
+
+	// Enough blocks in flight to keep every core busy whilst the oldest is written.
+	maxPendingBlocks = 2 * QThread::idealThreadCount();
+
+	if (maxPendingBlocks < 2)
+		maxPendingBlocks = 2;
+
+	crc = crc32(0, Z_NULL, 0);
+	uncompressedSize = 0;
+	compressedSize = 0;
+	writtenUncompressedSize = 0;
+
+	failed = false;
+}
+
+ParallelGzipWriter::~ParallelGzipWriter()
+{
+	while (!pendingBlocks.isEmpty())
+		pendingBlocks.dequeue().waitForFinished();
+}
+
+bool ParallelGzipWriter::QueueBlock(bool last)
+{
+	while (pendingBlocks.length() >= maxPendingBlocks)
+	{
+		if (!WriteCompressedBlock())
+			return (false);
+	}
+
+	pendingBlocks.enqueue(QtConcurrent::run(compressBlock, block, level, last));
+	block.clear();
+
+	return (true);
+}
+
+bool ParallelGzipWriter::WriteCompressedBlock(void)
+{
+	CompressedBlock compressedBlock = pendingBlocks.dequeue().result();
+
+	if (!compressedBlock.success || fwrite(compressedBlock.data.constData(), 1, compressedBlock.data.size(), file) != (size_t)compressedBlock.data.size())
+	{
+		failed = true;
+		return (false);
+	}
+
+	if (compressedBlock.length > 0)
+	{
+		GzipAccessPoint accessPoint;
+		accessPoint.compressedOffset = compressedSize;
+		accessPoint.uncompressedOffset = writtenUncompressedSize;
+
+		accessPoints.append(accessPoint);
+	}
+
+	// Blocks are written in order, so the CRC of the whole stream can be built up from each block's CRC.
+	crc = crc32_combine(crc, compressedBlock.crc, compressedBlock.length);
+	compressedSize += compressedBlock.data.size();
+	writtenUncompressedSize += compressedBlock.length;
+
+	return (true);
+}
+
+bool ParallelGzipWriter::Begin(void)
+{
+	// ID1, ID2, CM (deflate), FLG, MTIME (4 bytes, unknown), XFL, OS (unknown)
+	const unsigned char header[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF };
+
+	if (fwrite(header, 1, sizeof(header), file) != sizeof(header))
+	{
+		failed = true;
+		return (false);
+	}
+
+	compressedSize += sizeof(header);
+	return (true);
+}
+
+bool ParallelGzipWriter::Write(const char *data, qint64 length)
+{
+	if (failed)
+		return (false);
+
+	while (length > 0)
+	{
+		qint64 blockRemaining = kBlockLength - block.size();
+		qint64 dataToAppend = (length < blockRemaining) ? length : blockRemaining;
+
+		block.append(data, dataToAppend);
+
+		data += dataToAppend;
+		length -= dataToAppend;
+		uncompressedSize += dataToAppend;
+
+		if (block.size() == kBlockLength && !QueueBlock(false))
+			return (false);
+	}
+
+	return (true);
+}
+
+bool ParallelGzipWriter::Finish(void)
+{
+	// The last block may be empty, it still terminates the deflate stream.
+	if (failed || !QueueBlock(true))
+		return (false);
+
+	while (!pendingBlocks.isEmpty())
+	{
+		if (!WriteCompressedBlock())
+			return (false);
+	}
+
+	unsigned char trailer[8];
+
+	for (int i = 0; i < 4; i++)
+	{
+		trailer[i] = (crc >> (8 * i)) & 0xFF;
+		trailer[4 + i] = (uncompressedSize >> (8 * i)) & 0xFF; // ISIZE is the size modulo 2^32.
+	}
+
+	if (fwrite(trailer, 1, sizeof(trailer), file) != sizeof(trailer))
+	{
+		failed = true;
+		return (false);
+	}
+
+	compressedSize += sizeof(trailer);
+	return (true);
+}
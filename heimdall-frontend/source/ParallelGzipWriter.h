@@ -0,0 +1,113 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef PARALLELGZIPWRITER_H
+#define PARALLELGZIPWRITER_H
+
+// C/C++ Standard Library
+#include <stdio.h>
+
+// zlib
+#include "zlib.h"
+
+// Qt
+#include <QByteArray>
+#include <QFuture>
+#include <QList>
+#include <QQueue>
+
+namespace HeimdallFrontend
+{
+	// A point from which decompression can begin, without any preceding data.
+	struct GzipAccessPoint
+	{
+		quint64 compressedOffset;
+		quint64 uncompressedOffset;
+	};
+
+	struct CompressedBlock
+	{
+		QByteArray data;
+		uLong crc;
+		uLong length;
+		bool success;
+	};
+
+	// Writes a single gzip member, deflating fixed size blocks on the global thread pool. Each block is compressed
+	// independently and ends on a byte boundary, so decompression can also begin at any block.
+	class ParallelGzipWriter
+	{
+		public:
+
+			enum
+			{
+				kBlockLength = 262144
+			};
+
+		private:
+
+			FILE *file;
+			int level;
+
+			QByteArray block;
+			QQueue< QFuture<CompressedBlock> > pendingBlocks;
+			int maxPendingBlocks;
+
+			uLong crc;
+			quint64 uncompressedSize;
+			quint64 compressedSize;
+			quint64 writtenUncompressedSize;
+
+			QList<GzipAccessPoint> accessPoints;
+
+			bool failed;
+
+			bool QueueBlock(bool last);
+			bool WriteCompressedBlock(void);
+
+		public:
+
+			ParallelGzipWriter(FILE *file, int level = Z_DEFAULT_COMPRESSION);
+			~ParallelGzipWriter();
+
+			bool Begin(void);
+			bool Write(const char *data, qint64 length);
+			bool Finish(void); // Writes the last block and the gzip trailer, the file remains open.
+
+			quint64 GetUncompressedSize(void) const
+			{
+				return (uncompressedSize);
+			}
+
+			// The offset in the file of the start of the next block.
+			quint64 GetCompressedSize(void) const
+			{
+				return (compressedSize);
+			}
+
+			// The start of every block written so far.
+			const QList<GzipAccessPoint>& GetAccessPoints(void) const
+			{
+				return (accessPoints);
+			}
+	};
+}
+
+#endif
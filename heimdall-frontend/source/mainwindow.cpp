@@ -22,10 +22,13 @@
 #include <QCoreApplication>
 #include <QDesktopServices>
 #include <QDir>
+#include <QEventLoop>
 #include <QFileDialog>
 #include <QProcess>
+#include <QProgressDialog>
 #include <QRegExp>
 #include <QUrl>
+#include <QtConcurrentRun>
 
 // Heimdall Frontend
 #include "Alerts.h"
@@ -36,6 +39,16 @@
 
 using namespace HeimdallFrontend;
 
+// Files from an indexed package must be decompressed before they can be packaged again.
+static bool buildPackage(PackageData *packageData, const QString& packagePath, PackagingProgress *progress)
+{
+	QList<FileInfo> packagedFileInfos = packageData->GetFirmwareInfo().GetFileInfos();
+	packagedFileInfos.append(FileInfo(0, packageData->GetFirmwareInfo().GetPitFilename()));
+
+	return (Packaging::ExtractDeferredFiles(packageData, packagedFileInfos, progress)
+		&& Packaging::BuildPackage(packagePath, packageData->GetFirmwareInfo(), progress));
+}
+
 void MainWindow::StartHeimdall(const QStringList& arguments)
 {
 	UpdateInterfaceAvailability();
@@ -127,10 +140,10 @@ bool MainWindow::ReadPit(QFile *file)
 
 	unsigned char *buffer = new unsigned char[file->size()];
 
-	file->read(reinterpret_cast<char *>(buffer), file->size());
+	qint64 bytesRead = file->read(reinterpret_cast<char *>(buffer), file->size());
 	file->close();
 
-	bool success = currentPitData.Unpack(buffer);
+	bool success = bytesRead > 0 && currentPitData.Unpack(buffer, bytesRead);
 	delete[] buffer;
 
 	if (!success)
@@ -195,6 +208,46 @@ void MainWindow::UpdatePackageUserInterface(void)
 	UpdateLoadPackageInterfaceAvailability();
 }
 
+QProgressDialog *MainWindow::CreatePackagingProgressDialog(PackagingProgress *progress, Qt::WindowModality windowModality)
+{
+	progress->Reset();
+
+	QProgressDialog *progressDialog = new QProgressDialog(this);
+	progressDialog->setWindowModality(windowModality);
+	progressDialog->setWindowTitle("Heimdall Frontend");
+
+	QObject::connect(progress, SIGNAL(LabelTextChanged(const QString&)), progressDialog, SLOT(setLabelText(const QString&)));
+	QObject::connect(progress, SIGNAL(MaximumChanged(int)), progressDialog, SLOT(setMaximum(int)));
+	QObject::connect(progress, SIGNAL(ValueChanged(int)), progressDialog, SLOT(setValue(int)));
+
+	// The dialog remains open until the task has actually stopped.
+	QObject::disconnect(progressDialog, SIGNAL(canceled()), progressDialog, SLOT(cancel()));
+	QObject::connect(progressDialog, SIGNAL(canceled()), progress, SLOT(Cancel()));
+
+	return (progressDialog);
+}
+
+bool MainWindow::WaitForPackagingTask(const QFuture<bool>& future, QProgressDialog *progressDialog)
+{
+	// Events are still processed whilst waiting, so the window is redrawn and Heimdall's output is handled.
+	QFutureWatcher<bool> futureWatcher;
+	QEventLoop eventLoop;
+
+	QObject::connect(&futureWatcher, SIGNAL(finished()), &eventLoop, SLOT(quit()));
+	futureWatcher.setFuture(future);
+
+	if (!futureWatcher.isFinished())
+	{
+		// Shown immediately, as it's modality that prevents the package being modified whilst the task runs.
+		progressDialog->show();
+		eventLoop.exec();
+	}
+
+	delete progressDialog;
+
+	return (future.result());
+}
+
 bool MainWindow::IsArchive(QString path)
 {
 	// Not a real check but hopefully it gets the message across, don't directly flash archives!
@@ -224,6 +277,8 @@ QString MainWindow::PromptFileCreation(const QString& caption, const QString& fi
 
 void MainWindow::UpdateLoadPackageInterfaceAvailability(void)
 {
+	browseFirmwarePackageButton->setEnabled(!packageLoadProgressDialog);
+
 	if (loadedPackageData.IsCleared())
 	{
 		developerHomepageButton->setEnabled(false);
@@ -392,6 +447,8 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 
 	heimdallState = HeimdallState::Stopped;
 
+	packageLoadProgressDialog = nullptr;
+
 	lastDirectory = QDir::toNativeSeparators(QApplication::applicationDirPath());
 
 	populatingPartitionNames = false;
@@ -412,6 +469,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 
 	// Load Package Tab
 	QObject::connect(browseFirmwarePackageButton, SIGNAL(clicked()), this, SLOT(SelectFirmwarePackage()));
+	QObject::connect(&packageLoadWatcher, SIGNAL(finished()), this, SLOT(PackageLoadFinished()));
 	QObject::connect(developerHomepageButton, SIGNAL(clicked()), this, SLOT(OpenDeveloperHomepage()));
 	QObject::connect(developerDonateButton, SIGNAL(clicked()), this, SLOT(OpenDeveloperDonationWebpage()));
 	QObject::connect(loadFirmwareButton, SIGNAL(clicked()), this, SLOT(LoadFirmwarePackage()));
@@ -473,10 +531,33 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 	QObject::connect(&heimdallProcess, SIGNAL(readyRead()), this, SLOT(HandleHeimdallStdout()));
 	QObject::connect(&heimdallProcess, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(HandleHeimdallReturned(int, QProcess::ExitStatus)));
 	QObject::connect(&heimdallProcess, SIGNAL(error(QProcess::ProcessError)), this, SLOT(HandleHeimdallError(QProcess::ProcessError)));
+
+	// Flash Session
+	QObject::connect(&flashSession, SIGNAL(Output(const QString&)), this, SLOT(HandleFlashOutput(const QString&)));
+	QObject::connect(&flashSession, SIGNAL(PhaseChanged(const QString&, const QString&)), this, SLOT(HandleFlashPhase(const QString&, const QString&)));
+	QObject::connect(&flashSession, SIGNAL(PercentChanged(int)), flashProgressBar, SLOT(setValue(int)));
+	QObject::connect(&flashSession, SIGNAL(ErrorOccurred(const QString&)), this, SLOT(HandleFlashError(const QString&)));
+	QObject::connect(&flashWatcher, SIGNAL(finished()), this, SLOT(HandleFlashFinished()));
 }
 
 MainWindow::~MainWindow()
 {
+	if (packageLoadWatcher.isRunning())
+	{
+		// The extraction may be blocked displaying an alert through the GUI thread, so events are processed whilst waiting.
+		QObject::disconnect(&packageLoadWatcher, SIGNAL(finished()), this, SLOT(PackageLoadFinished()));
+
+		QEventLoop eventLoop;
+		QObject::connect(&packageLoadWatcher, SIGNAL(finished()), &eventLoop, SLOT(quit()));
+
+		packageLoadProgress.Cancel();
+
+		if (packageLoadWatcher.isRunning())
+			eventLoop.exec();
+	}
+
+	// Interrupting a flash could leave the device unbootable.
+	flashWatcher.waitForFinished();
 }
 
 void MainWindow::OpenDonationWebpage(void)
@@ -510,13 +591,26 @@ void MainWindow::SelectFirmwarePackage(void)
 
 	if (firmwarePackageLineEdit->text() != "")
 	{
-		if (Packaging::ExtractPackage(firmwarePackageLineEdit->text(), &loadedPackageData))
-			UpdatePackageUserInterface();
-		else
-			loadedPackageData.Clear();
+		// The package is extracted in the background, so other tabs remain usable (e.g. whilst flashing the previous package).
+		packageLoadProgressDialog = CreatePackagingProgressDialog(&packageLoadProgress, Qt::NonModal);
+		packageLoadWatcher.setFuture(QtConcurrent::run(&Packaging::ExtractPackage, firmwarePackageLineEdit->text(), &extractingPackageData, &packageLoadProgress));
+
+		UpdateLoadPackageInterfaceAvailability();
 	}
 }
 
+void MainWindow::PackageLoadFinished(void)
+{
+	delete packageLoadProgressDialog;
+	packageLoadProgressDialog = nullptr;
+
+	if (packageLoadWatcher.result())
+		loadedPackageData.Swap(extractingPackageData);
+
+	extractingPackageData.Clear();
+	UpdatePackageUserInterface();
+}
+
 void MainWindow::OpenDeveloperHomepage(void)
 {
 	if(!QDesktopServices::openUrl(QUrl(loadedPackageData.GetFirmwareInfo().GetUrl(), QUrl::TolerantMode)))
@@ -535,6 +629,8 @@ void MainWindow::LoadFirmwarePackage(void)
 	currentPitData.Clear();
 	
 	workingPackageData.GetFiles().append(loadedPackageData.GetFiles());
+	workingPackageData.GetDeferredFiles().append(loadedPackageData.GetDeferredFiles());
+	workingPackageData.SetPackageIndex(loadedPackageData.GetPackagePath(), loadedPackageData.GetPackageIndex());
 	loadedPackageData.RemoveAllFiles();
 
 	const QList<FileInfo> packageFileInfos = loadedPackageData.GetFirmwareInfo().GetFileInfos();
@@ -902,47 +998,40 @@ void MainWindow::SetResume(int enabled)
 
 void MainWindow::StartFlash(void)
 {
+	// Partition files of indexed packages are only decompressed once they're needed.
+	if (!workingPackageData.GetDeferredFiles().isEmpty())
+	{
+		QProgressDialog *progressDialog = CreatePackagingProgressDialog(&workingPackageProgress, Qt::ApplicationModal);
+
+		if (!WaitForPackagingTask(QtConcurrent::run(&Packaging::ExtractDeferredFiles, &workingPackageData,
+			workingPackageData.GetFirmwareInfo().GetFileInfos(), &workingPackageProgress), progressDialog))
+		{
+			return;
+		}
+	}
+
 	outputPlainTextEdit->clear();
 
 	heimdallState = HeimdallState::Flashing;
 	heimdallFailed = false;
 
 	const FirmwareInfo& firmwareInfo = workingPackageData.GetFirmwareInfo();
-	const QList<FileInfo>& fileInfos = firmwareInfo.GetFileInfos();
-	
-	QStringList arguments;
-	arguments.append("flash");
-
-	if (firmwareInfo.GetRepartition())
-		arguments.append("--repartition");
 
-	arguments.append("--pit");
-	arguments.append(firmwareInfo.GetPitFilename());
+	QList<FileInfo> fileInfos = firmwareInfo.GetFileInfos();
+	PitData pitData = currentPitData; // Already unpacked from the selected PIT file.
+	bool repartition = firmwareInfo.GetRepartition();
+	bool reboot = !firmwareInfo.GetNoReboot();
+	bool resumeSession = resume;
+	bool verbose = verboseOutput;
 
-	for (int i = 0; i < fileInfos.length(); i++)
-	{
-		QString flag;
-		flag.sprintf("--%u", fileInfos[i].GetPartitionId());
-
-		arguments.append(flag);
-		arguments.append(fileInfos[i].GetFilename());
-	}
-
-	if (firmwareInfo.GetNoReboot())
-	{
-		arguments.append("--no-reboot");
+	if (!reboot)
 		heimdallState |= HeimdallState::NoReboot;
-	}
-
-	if (resume)
-		arguments.append("--resume");
-
-	if (verboseOutput)
-		arguments.append("--verbose");
 
-	arguments.append("--stdout-errors");
+	UpdateInterfaceAvailability();
 
-	StartHeimdall(arguments);
+	flashWatcher.setFuture(QtConcurrent::run([=]() {
+		return (flashSession.Run(fileInfos, pitData, repartition, reboot, resumeSession, verbose));
+	}));
 }
 
 void MainWindow::FirmwareNameChanged(const QString& text)
@@ -1075,7 +1164,8 @@ void MainWindow::BuildPackage(void)
 				packagePath.append(".tar.gz");
 		}
 
-		Packaging::BuildPackage(packagePath, workingPackageData.GetFirmwareInfo());
+		QProgressDialog *progressDialog = CreatePackagingProgressDialog(&workingPackageProgress, Qt::ApplicationModal);
+		WaitForPackagingTask(QtConcurrent::run(buildPackage, &workingPackageData, packagePath, &workingPackageProgress), progressDialog);
 	}
 }
 
@@ -1351,3 +1441,36 @@ void MainWindow::HandleHeimdallError(QProcess::ProcessError error)
 		UpdateInterfaceAvailability();
 	}
 }
+
+void MainWindow::HandleFlashOutput(const QString& text)
+{
+	outputPlainTextEdit->insertPlainText(text);
+	outputPlainTextEdit->ensureCursorVisible();
+}
+
+void MainWindow::HandleFlashPhase(const QString& phase, const QString& partitionName)
+{
+	if (phase == "flash")
+		flashLabel->setText("Uploading " + partitionName);
+	else if (phase == "upload-pit")
+		flashLabel->setText("Uploading PIT");
+}
+
+void MainWindow::HandleFlashError(const QString& message)
+{
+	flashLabel->setText(message);
+}
+
+void MainWindow::HandleFlashFinished(void)
+{
+	if (flashWatcher.result())
+	{
+		SetResume(!!(heimdallState & HeimdallState::NoReboot));
+		flashLabel->setText("Flash completed successfully!");
+	}
+
+	heimdallState = HeimdallState::Stopped;
+	flashProgressBar->setValue(0);
+	flashProgressBar->setEnabled(false);
+	UpdateInterfaceAvailability();
+}
@@ -22,6 +22,7 @@
 #define MAINWINDOW_H
 
 // Qt
+#include <QFutureWatcher>
 #include <QList>
 #include <QMainWindow>
 #include <QProcess>
@@ -33,7 +34,11 @@
 // Heimdall Frontend
 #include "aboutform.h"
 #include "ui_mainwindow.h"
+#include "FlashSession.h"
 #include "PackageData.h"
+#include "PackagingProgress.h"
+
+class QProgressDialog;
 
 using namespace libpit;
 
@@ -94,10 +99,21 @@ namespace HeimdallFrontend
 			HeimdallState heimdallState;
 			QProcess heimdallProcess;
 
+			// Flashing is performed in-process by libheimdall, on a worker thread.
+			FlashSession flashSession;
+			QFutureWatcher<bool> flashWatcher;
+
 			PackageData loadedPackageData;
+
+			// Packages are extracted by a worker thread, loadedPackageData is only replaced once extraction has succeeded.
+			PackageData extractingPackageData;
+			PackagingProgress packageLoadProgress;
+			QProgressDialog *packageLoadProgressDialog;
+			QFutureWatcher<bool> packageLoadWatcher;
 			
 			PitData currentPitData;
 			PackageData workingPackageData;
+			PackagingProgress workingPackageProgress;
 
 			bool populatingPartitionNames;
 			QList<unsigned int> unusedPartitionIds;
@@ -113,6 +129,9 @@ namespace HeimdallFrontend
 
 			void UpdatePackageUserInterface(void);
 
+			QProgressDialog *CreatePackagingProgressDialog(PackagingProgress *progress, Qt::WindowModality windowModality);
+			bool WaitForPackagingTask(const QFuture<bool>& future, QProgressDialog *progressDialog);
+
 			bool IsArchive(QString path);
 
 			QString PromptFileSelection(const QString& caption = QString("Select File"), const QString& filter = QString());
@@ -141,6 +160,7 @@ namespace HeimdallFrontend
 
 			// Load Package Tab
 			void SelectFirmwarePackage(void);
+			void PackageLoadFinished(void);
 			void OpenDeveloperHomepage(void);
 			void OpenDeveloperDonationWebpage(void);
 			void LoadFirmwarePackage(void);
@@ -200,6 +220,12 @@ namespace HeimdallFrontend
 			void HandleHeimdallStdout(void);
 			void HandleHeimdallReturned(int exitCode, QProcess::ExitStatus exitStatus);
 			void HandleHeimdallError(QProcess::ProcessError error);
+
+			// Flash Session
+			void HandleFlashOutput(const QString& text);
+			void HandleFlashPhase(const QString& phase, const QString& partitionName);
+			void HandleFlashError(const QString& message);
+			void HandleFlashFinished(void);
 	};
 }
 
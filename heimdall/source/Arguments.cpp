@@ -72,6 +72,25 @@ UnsignedIntegerArgument *UnsignedIntegerArgument::ParseArgument(const std::strin
 
 
 
+static Argument *parseArgument(ArgumentType type, const string& name, int argc, char **argv, int& argi)
+{
+	switch (type)
+	{
+		case kArgumentTypeFlag:
+			return (FlagArgument::ParseArgument(name, argc, argv, argi));
+
+		case kArgumentTypeString:
+			return (StringArgument::ParseArgument(name, argc, argv, argi));
+
+		case kArgumentTypeUnsignedInteger:
+			return (UnsignedIntegerArgument::ParseArgument(name, argc, argv, argi));
+
+		default:
+			Interface::Print("Unknown argument type: %s\n\n", argv[argi]);
+			return (nullptr);
+	}
+}
+
 Arguments::Arguments(const map<string, ArgumentType>& argumentTypes, const map<string, string>& shortArgumentAliases,
 	const map<string, string>& argumentAliases) :
 		argumentTypes(argumentTypes),
@@ -93,10 +112,24 @@ bool Arguments::ParseArguments(int argc, char **argv, int argi)
 		string argumentName = argv[argi];
 		string nonwildcardArgumentName;
 
+		bool hasInlineValue = false;
+		string inlineValue;
+
 		if (argumentName.find_first_of("--") == 0)
 		{
 			// Regular argument
 			argumentName = argumentName.substr(2);
+
+			// A value may also be attached to the argument itself e.g. --progress=json
+			string::size_type separatorIndex = argumentName.find('=');
+
+			if (separatorIndex != string::npos)
+			{
+				inlineValue = argumentName.substr(separatorIndex + 1);
+				argumentName.erase(separatorIndex);
+				hasInlineValue = true;
+			}
+
 			nonwildcardArgumentName = argumentName;
 		}
 		else if (argumentName.find_first_of("-") == 0)
@@ -167,23 +200,21 @@ bool Arguments::ParseArguments(int argc, char **argv, int argi)
 		
 		if (argumentTypeIt != argumentTypes.end())
 		{
-			switch (argumentTypeIt->second)
+			if (!hasInlineValue)
 			{
-				case kArgumentTypeFlag:
-					argument = FlagArgument::ParseArgument(argumentName, argc, argv, argi);
-					break;
-
-				case kArgumentTypeString:
-					argument = StringArgument::ParseArgument(argumentName, argc, argv, argi);
-					break;
-
-				case kArgumentTypeUnsignedInteger:
-					argument = UnsignedIntegerArgument::ParseArgument(argumentName, argc, argv, argi);
-					break;
+				argument = parseArgument(argumentTypeIt->second, argumentName, argc, argv, argi);
+			}
+			else if (argumentTypeIt->second == kArgumentTypeFlag)
+			{
+				Interface::Print("Argument doesn't accept a value: %s\n\n", argv[argi]);
+			}
+			else
+			{
+				// Parse the attached value as though it were the next argument.
+				char *inlineArgv[2] = { argv[argi], &inlineValue[0] };
+				int inlineArgi = 0;
 
-				default:
-					Interface::Print("Unknown argument type: %s\n\n", argv[argi]);
-					break;
+				argument = parseArgument(argumentTypeIt->second, argumentName, 2, inlineArgv, inlineArgi);
 			}
 		}
 		else
@@ -0,0 +1,308 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <fstream>
+
+// Heimdall
+#include "Arguments.h"
+#include "BatchAction.h"
+#include "BatchSession.h"
+#include "BridgeManager.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "PitCache.h"
+#include "Progress.h"
+#include "TransferProfiles.h"
+
+using namespace std;
+using namespace Heimdall;
+
+const char *BatchAction::usage = "Action: batch\n\
+Arguments: --script <filename> [--verbose] [--no-reboot] [--resume]\n\
+    [--stdout-errors] [--usb-log-level <none/error/warning/debug>]\n\
+    [--pit-cache <directory>] [--progress <text/json>]\n\
+    [--progress-interval <milliseconds>] [--transfer-profiles <filename>]\n\
+Description: Performs each action listed in a script file, one per line, within\n\
+    a single session. The device's PIT is downloaded at most once and shared\n\
+    between actions, until it's replaced by repartitioning.\n\
+    Supported actions, with the arguments they accept:\n\
+      download-pit --output <filename>\n\
+      print-pit\n\
+      flash [--<partition name> <filename> ...]\n\
+        [--<partition identifier> <filename> ...] [--pit <filename>]\n\
+        [--repartition] [--tflash]\n\
+      reboot\n\
+Note: Blank lines and lines beginning with # are ignored. Arguments containing\n\
+      spaces may be enclosed in double quotes.\n\
+Note: reboot may only be the last action. Otherwise, the device is rebooted\n\
+      once the script is completed, unless --no-reboot is specified.\n\
+Note: The whole script is checked before the session begins. If an action\n\
+      fails, the remaining actions are skipped and the session is ended.\n\
+Note: --progress json reports progress as JSON lines on stdout, at most once\n\
+      per --progress-interval milliseconds (default 250). All other output is\n\
+      written to stderr.\n\
+Note: --transfer-profiles applies the file transfer parameters measured by the\n\
+      tune action, if the file contains a profile for the device.\n";
+
+struct BatchCommand
+{
+	unsigned int lineNumber;
+	string action;
+	Arguments *arguments;
+
+	BatchCommand(unsigned int lineNumber, const string& action, Arguments *arguments)
+	{
+		this->lineNumber = lineNumber;
+		this->action = action;
+		this->arguments = arguments;
+	}
+};
+
+static void deleteCommands(vector<BatchCommand>& commands)
+{
+	for (vector<BatchCommand>::iterator it = commands.begin(); it != commands.end(); it++)
+		delete it->arguments;
+
+	commands.clear();
+}
+
+static bool loadScript(const char *filename, vector<BatchCommand>& commands)
+{
+	ifstream scriptFile(filename);
+
+	if (!scriptFile)
+	{
+		Interface::PrintError("Failed to open script file \"%s\"\n", filename);
+		return (false);
+	}
+
+	string line;
+	unsigned int lineNumber = 0;
+	vector<string> words;
+
+	while (getline(scriptFile, line))
+	{
+		lineNumber++;
+
+		// Tolerate scripts saved with Windows line endings.
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+
+		if (!BatchSession::SplitCommand(line, words))
+		{
+			Interface::PrintError("Invalid command on line %u of script.\n", lineNumber);
+			return (false);
+		}
+
+		if (words.empty() || words[0][0] == '#')
+			continue;
+
+		if (!commands.empty() && commands.back().action == "reboot")
+		{
+			Interface::PrintError("Line %u of script follows reboot, which must be the last action.\n", lineNumber);
+			return (false);
+		}
+
+		Arguments *arguments = BatchSession::ParseCommand(words);
+
+		if (!arguments)
+		{
+			Interface::PrintError("Invalid command on line %u of script.\n", lineNumber);
+			return (false);
+		}
+
+		commands.push_back(BatchCommand(lineNumber, words[0], arguments));
+	}
+
+	return (true);
+}
+
+int BatchAction::Execute(int argc, char **argv)
+{
+	// Handle arguments
+
+	map<string, ArgumentType> argumentTypes;
+	argumentTypes["script"] = kArgumentTypeString;
+	argumentTypes["no-reboot"] = kArgumentTypeFlag;
+	argumentTypes["resume"] = kArgumentTypeFlag;
+	argumentTypes["verbose"] = kArgumentTypeFlag;
+	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+	argumentTypes["usb-log-level"] = kArgumentTypeString;
+	argumentTypes["pit-cache"] = kArgumentTypeString;
+	argumentTypes["transfer-profiles"] = kArgumentTypeString;
+
+	Progress::AddArgumentTypes(argumentTypes);
+
+	Arguments arguments(argumentTypes);
+
+	if (!arguments.ParseArguments(argc, argv, 2))
+	{
+		Interface::Print(BatchAction::usage);
+		return (0);
+	}
+
+	const StringArgument *scriptArgument = static_cast<const StringArgument *>(arguments.GetArgument("script"));
+
+	if (!scriptArgument)
+	{
+		Interface::Print("Script file was not specified.\n\n");
+		Interface::Print(BatchAction::usage);
+		return (0);
+	}
+
+	bool reboot = arguments.GetArgument("no-reboot") == nullptr;
+	bool resume = arguments.GetArgument("resume") != nullptr;
+	bool verbose = arguments.GetArgument("verbose") != nullptr;
+
+	if (arguments.GetArgument("stdout-errors") != nullptr)
+		Interface::SetStdoutErrors(true);
+
+	if (!Progress::ApplyArguments(arguments))
+	{
+		Interface::Print(BatchAction::usage);
+		return (0);
+	}
+
+	const StringArgument *usbLogLevelArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-log-level"));
+
+	BridgeManager::UsbLogLevel usbLogLevel = BridgeManager::UsbLogLevel::Default;
+
+	if (usbLogLevelArgument)
+	{
+		const string& usbLogLevelString = usbLogLevelArgument->GetValue();
+
+		if (usbLogLevelString.compare("none") == 0 || usbLogLevelString.compare("NONE") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::None;
+		}
+		else if (usbLogLevelString.compare("error") == 0 || usbLogLevelString.compare("ERROR") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Error;
+		}
+		else if (usbLogLevelString.compare("warning") == 0 || usbLogLevelString.compare("WARNING") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Warning;
+		}
+		else if (usbLogLevelString.compare("info") == 0 || usbLogLevelString.compare("INFO") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Info;
+		}
+		else if (usbLogLevelString.compare("debug") == 0 || usbLogLevelString.compare("DEBUG") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Debug;
+		}
+		else
+		{
+			Interface::Print("Unknown USB log level: %s\n\n", usbLogLevelString.c_str());
+			Interface::Print(BatchAction::usage);
+			return (0);
+		}
+	}
+
+	// Load script
+
+	vector<BatchCommand> commands;
+
+	if (!loadScript(scriptArgument->GetValue().c_str(), commands))
+	{
+		deleteCommands(commands);
+		return (1);
+	}
+
+	if (commands.empty())
+	{
+		Interface::PrintError("Script file \"%s\" contains no actions.\n", scriptArgument->GetValue().c_str());
+		return (1);
+	}
+
+	if (commands.back().action == "reboot")
+		reboot = true;
+
+	const StringArgument *pitCacheArgument = static_cast<const StringArgument *>(arguments.GetArgument("pit-cache"));
+	PitCache *pitCache = nullptr;
+
+	if (pitCacheArgument)
+	{
+		pitCache = new PitCache(pitCacheArgument->GetValue());
+
+		if (!pitCache->Initialise())
+		{
+			Interface::PrintError("Failed to create PIT cache directory \"%s\"\n", pitCacheArgument->GetValue().c_str());
+			delete pitCache;
+			deleteCommands(commands);
+			return (1);
+		}
+	}
+
+	const StringArgument *transferProfilesArgument = static_cast<const StringArgument *>(arguments.GetArgument("transfer-profiles"));
+	TransferProfiles transferProfiles((transferProfilesArgument) ? transferProfilesArgument->GetValue() : "");
+
+	if (transferProfilesArgument && !transferProfiles.Load())
+	{
+		delete pitCache;
+		deleteCommands(commands);
+		return (1);
+	}
+
+	Interface::PrintReleaseInfo();
+	Sleep(1000);
+
+	// Perform actions
+
+	BridgeManager *bridgeManager = new BridgeManager(verbose);
+	bridgeManager->SetUsbLogLevel(usbLogLevel);
+	bridgeManager->SetTransferProfiles((transferProfilesArgument) ? &transferProfiles : nullptr);
+
+	if (bridgeManager->Initialise(resume) != BridgeManager::kInitialiseSucceeded || !bridgeManager->BeginSession())
+	{
+		delete bridgeManager;
+		delete pitCache;
+		deleteCommands(commands);
+
+		return (1);
+	}
+
+	BatchSession *batchSession = new BatchSession(bridgeManager, pitCache);
+	bool success = true;
+
+	for (vector<BatchCommand>::const_iterator it = commands.begin(); it != commands.end() && it->action != "reboot"; it++)
+	{
+		Interface::Print("Performing %s (line %u)...\n\n", it->action.c_str(), it->lineNumber);
+
+		if (!batchSession->ExecuteCommand(it->action, *it->arguments))
+		{
+			Interface::PrintError("%s (line %u) failed, skipping remaining actions.\n", it->action.c_str(), it->lineNumber);
+			success = false;
+			break;
+		}
+	}
+
+	delete batchSession;
+
+	if (!bridgeManager->EndSession(reboot))
+		success = false;
+
+	delete bridgeManager;
+	delete pitCache;
+	deleteCommands(commands);
+
+	return (success ? 0 : 1);
+}
@@ -0,0 +1,243 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <ctype.h>
+#include <stdio.h>
+
+// Heimdall
+#include "BatchSession.h"
+#include "BridgeManager.h"
+#include "FlashAction.h"
+#include "Heimdall.h"
+#include "Interface.h"
+
+using namespace std;
+using namespace libpit;
+using namespace Heimdall;
+
+BatchSession::BatchSession(BridgeManager *bridgeManager, const PitCache *pitCache)
+{
+	this->bridgeManager = bridgeManager;
+	this->pitCache = pitCache;
+
+	pitBuffer = nullptr;
+	pitBufferSize = 0;
+	pitData = nullptr;
+}
+
+BatchSession::~BatchSession()
+{
+	DiscardPit();
+}
+
+bool BatchSession::RetrievePit(void)
+{
+	if (pitData)
+		return (true);
+
+	int fileSize = bridgeManager->DownloadPitFile(&pitBuffer, pitCache);
+
+	if (fileSize <= 0)
+	{
+		pitBuffer = nullptr;
+		return (false);
+	}
+
+	pitBufferSize = fileSize;
+	pitData = new PitData();
+
+	if (!pitData->Unpack(pitBuffer, pitBufferSize))
+	{
+		Interface::PrintError("Failed to unpack device's PIT file!\n");
+		DiscardPit();
+		return (false);
+	}
+
+	return (true);
+}
+
+void BatchSession::DiscardPit(void)
+{
+	delete [] pitBuffer;
+	pitBuffer = nullptr;
+	pitBufferSize = 0;
+
+	delete pitData;
+	pitData = nullptr;
+}
+
+bool BatchSession::DownloadPit(const Arguments& arguments)
+{
+	if (!RetrievePit())
+		return (false);
+
+	const StringArgument *outputArgument = static_cast<const StringArgument *>(arguments.GetArgument("output"));
+	const char *outputFilename = outputArgument->GetValue().c_str();
+
+	FILE *outputPitFile = FileOpen(outputFilename, "wb");
+
+	if (!outputPitFile)
+	{
+		Interface::PrintError("Failed to open output file \"%s\"\n", outputFilename);
+		return (false);
+	}
+
+	bool success = fwrite(pitBuffer, 1, pitBufferSize, outputPitFile) == pitBufferSize;
+
+	if (FileClose(outputPitFile) != 0)
+		success = false;
+
+	if (!success)
+		Interface::PrintError("Failed to write PIT data to output file.\n");
+
+	return (success);
+}
+
+bool BatchSession::PrintPit(void)
+{
+	if (!RetrievePit())
+		return (false);
+
+	Interface::PrintPit(pitData);
+	return (true);
+}
+
+bool BatchSession::Flash(const Arguments& arguments)
+{
+	if (arguments.GetArgument("repartition") != nullptr)
+	{
+		// The device's PIT is being replaced, the next action to require it will download it again.
+		DiscardPit();
+		return (FlashAction::Flash(bridgeManager, arguments, nullptr, pitCache));
+	}
+
+	if (!RetrievePit())
+		return (false);
+
+	return (FlashAction::Flash(bridgeManager, arguments, pitData, pitCache));
+}
+
+bool BatchSession::SplitCommand(const string& command, vector<string>& words)
+{
+	words.clear();
+
+	string::size_type i = 0;
+
+	while (i < command.size())
+	{
+		if (isspace((unsigned char)command[i]))
+		{
+			i++;
+			continue;
+		}
+
+		string word;
+
+		if (command[i] == '"')
+		{
+			string::size_type end = command.find('"', i + 1);
+
+			if (end == string::npos)
+			{
+				Interface::PrintError("Unterminated quote in: %s\n", command.c_str());
+				return (false);
+			}
+
+			word = command.substr(i + 1, end - i - 1);
+			i = end + 1;
+		}
+		else
+		{
+			string::size_type end = i;
+
+			while (end < command.size() && !isspace((unsigned char)command[end]))
+				end++;
+
+			word = command.substr(i, end - i);
+			i = end;
+		}
+
+		words.push_back(word);
+	}
+
+	return (true);
+}
+
+Arguments *BatchSession::ParseCommand(const vector<string>& words)
+{
+	if (words.empty())
+		return (nullptr);
+
+	const string& action = words[0];
+
+	map<string, ArgumentType> argumentTypes;
+	map<string, string> shortArgumentAliases;
+	map<string, string> argumentAliases;
+
+	if (action == "download-pit")
+	{
+		argumentTypes["output"] = kArgumentTypeString;
+	}
+	else if (action == "flash")
+	{
+		FlashAction::AddArgumentTypes(argumentTypes, shortArgumentAliases, argumentAliases);
+	}
+	else if (action != "print-pit" && action != "reboot")
+	{
+		Interface::PrintError("Unsupported action: %s\n", action.c_str());
+		return (nullptr);
+	}
+
+	vector<char *> argv;
+
+	for (vector<string>::const_iterator it = words.begin(); it != words.end(); it++)
+		argv.push_back(const_cast<char *>(it->c_str()));
+
+	Arguments *arguments = new Arguments(argumentTypes, shortArgumentAliases, argumentAliases);
+
+	if (!arguments->ParseArguments(argv.size(), argv.data(), 1))
+	{
+		Interface::PrintError("Invalid arguments for action: %s\n", action.c_str());
+		delete arguments;
+		return (nullptr);
+	}
+
+	if (action == "download-pit" && !arguments->GetArgument("output"))
+	{
+		Interface::PrintError("Output file was not specified for action: download-pit\n");
+		delete arguments;
+		return (nullptr);
+	}
+
+	return (arguments);
+}
+
+bool BatchSession::ExecuteCommand(const string& action, const Arguments& arguments)
+{
+	if (action == "download-pit")
+		return (DownloadPit(arguments));
+	else if (action == "print-pit")
+		return (PrintPit());
+	else if (action == "flash")
+		return (Flash(arguments));
+	else
+		return (false);
+}
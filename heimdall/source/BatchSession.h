@@ -0,0 +1,75 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef BATCHSESSION_H
+#define BATCHSESSION_H
+
+// C/C++ Standard Library
+#include <string>
+#include <vector>
+
+// libpit
+#include "libpit.h"
+
+// Heimdall
+#include "Arguments.h"
+
+namespace Heimdall
+{
+	class BridgeManager;
+	class PitCache;
+
+	// Performs actions within a single session that has already begun. The device's PIT is downloaded at most once and
+	// shared between actions, until it's replaced by repartitioning.
+	class BatchSession
+	{
+		private:
+
+			BridgeManager *bridgeManager;
+			const PitCache *pitCache;
+
+			unsigned char *pitBuffer;
+			unsigned int pitBufferSize;
+			libpit::PitData *pitData;
+
+			bool RetrievePit(void);
+			void DiscardPit(void);
+
+			bool DownloadPit(const Arguments& arguments);
+			bool PrintPit(void);
+			bool Flash(const Arguments& arguments);
+
+		public:
+
+			BatchSession(BridgeManager *bridgeManager, const PitCache *pitCache);
+			~BatchSession();
+
+			// Splits a command into words, separated by white space. Words containing white space may be enclosed in double quotes.
+			static bool SplitCommand(const std::string& command, std::vector<std::string>& words);
+
+			// Returns nullptr if words isn't a supported action with valid arguments. The first word is the action.
+			static Arguments *ParseCommand(const std::vector<std::string>& words);
+
+			// Performs every action except reboot, which ends the session and is left to the caller.
+			bool ExecuteCommand(const std::string& action, const Arguments& arguments);
+	};
+}
+
+#endif
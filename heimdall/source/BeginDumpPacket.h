@@ -38,6 +38,9 @@ namespace Heimdall
 
 		private:
 
+			typedef NextPacketField<FileTransferPacket::RequestField> ChipTypeField;
+			typedef NextPacketField<ChipTypeField> ChipIdField;
+
 			unsigned int chipType;
 			unsigned int chipId;
 
@@ -63,8 +66,8 @@ namespace Heimdall
 			{
 				FileTransferPacket::Pack();
 
-				PackInteger(FileTransferPacket::kDataSize, chipType);
-				PackInteger(FileTransferPacket::kDataSize + 4, chipId);
+				PackField<ChipTypeField>(chipType);
+				PackField<ChipIdField>(chipId);
 			}
 	};
 }
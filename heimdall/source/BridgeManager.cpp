@@ -43,14 +43,18 @@
 #include "InboundPacket.h"
 #include "Interface.h"
 #include "OutboundPacket.h"
+#include "PitCache.h"
 #include "PitFilePacket.h"
 #include "PitFileResponse.h"
+#include "Progress.h"
 #include "ReceiveFilePartPacket.h"
 #include "ResponsePacket.h"
 #include "SendFilePartPacket.h"
 #include "SendFilePartResponse.h"
 #include "SessionSetupPacket.h"
 #include "SessionSetupResponse.h"
+#include "TransferProfiles.h"
+#include "TransferScheduler.h"
 
 // Future versions of libusb will use usb_interface instead of interface.
 #ifndef usb_interface
@@ -75,6 +79,13 @@ enum
 	kFileTransferSequenceTimeoutDefault = 30000 // 30 seconds
 };
 
+enum
+{
+	kFileTransferSequenceMaxLengthSession = 30,
+	kFileTransferPacketSizeSession = 1048576, // 1 MiB
+	kFileTransferSequenceTimeoutSession = 120000 // 2 minutes!
+};
+
 int BridgeManager::FindDeviceInterface(void)
 {
 	Interface::Print("Detecting device...\n");
@@ -84,21 +95,21 @@ int BridgeManager::FindDeviceInterface(void)
 
 	for (int deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++)
 	{
+		if (deviceBusNumber >= 0 && (libusb_get_bus_number(devices[deviceIndex]) != deviceBusNumber
+			|| libusb_get_device_address(devices[deviceIndex]) != deviceAddress))
+		{
+			continue;
+		}
+
 		libusb_device_descriptor descriptor;
 		libusb_get_device_descriptor(devices[deviceIndex], &descriptor);
 
-		for (int i = 0; i < BridgeManager::kSupportedDeviceCount; i++)
+		if (IsSupportedDevice(descriptor.idVendor, descriptor.idProduct))
 		{
-			if (descriptor.idVendor == supportedDevices[i].vendorId && descriptor.idProduct == supportedDevices[i].productId)
-			{
-				heimdallDevice = devices[deviceIndex];
-				libusb_ref_device(heimdallDevice);
-				break;
-			}
-		}
-
-		if (heimdallDevice)
+			heimdallDevice = devices[deviceIndex];
+			libusb_ref_device(heimdallDevice);
 			break;
+		}
 	}
 
 	libusb_free_device_list(devices, deviceCount);
@@ -109,6 +120,18 @@ int BridgeManager::FindDeviceInterface(void)
 		return (BridgeManager::kInitialiseDeviceNotDetected);
 	}
 
+	busNumber = libusb_get_bus_number(heimdallDevice);
+
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000102)
+
+	unsigned char devicePortNumbers[7];
+	int portNumberCount = libusb_get_port_numbers(heimdallDevice, devicePortNumbers, sizeof(devicePortNumbers));
+
+	if (portNumberCount > 0)
+		portNumbers.assign(devicePortNumbers, devicePortNumbers + portNumberCount);
+
+#endif
+
 	int result = libusb_open(heimdallDevice, &deviceHandle);
 	if (result != LIBUSB_SUCCESS)
 	{
@@ -124,10 +147,21 @@ int BridgeManager::FindDeviceInterface(void)
 		return (BridgeManager::kInitialiseFailed);
 	}
 
-	if (verbose)
+	vendorId = deviceDescriptor.idVendor;
+	productId = deviceDescriptor.idProduct;
+	deviceRelease = deviceDescriptor.bcdDevice;
+
+	unsigned char stringBuffer[128];
+
+	// The serial number identifies the device, e.g. for caching its PIT.
+	if (deviceDescriptor.iSerialNumber != 0 && libusb_get_string_descriptor_ascii(deviceHandle, deviceDescriptor.iSerialNumber,
+		stringBuffer, 128) >= 0)
 	{
-		unsigned char stringBuffer[128];
+		serialNumber = reinterpret_cast<const char *>(stringBuffer);
+	}
 
+	if (verbose)
+	{
 		if (libusb_get_string_descriptor_ascii(deviceHandle, deviceDescriptor.iManufacturer,
 			stringBuffer, 128) >= 0)
 		{
@@ -140,11 +174,8 @@ int BridgeManager::FindDeviceInterface(void)
 			Interface::Print("           Product: \"%s\"\n", stringBuffer);
 		}
 
-		if (libusb_get_string_descriptor_ascii(deviceHandle, deviceDescriptor.iSerialNumber,
-			stringBuffer, 128) >= 0)
-		{
-			Interface::Print("         Serial No: \"%s\"\n", stringBuffer);
-		}
+		if (!serialNumber.empty())
+			Interface::Print("         Serial No: \"%s\"\n", serialNumber.c_str());
 
 		Interface::Print("\n            length: %d\n", deviceDescriptor.bLength);
 		Interface::Print("      device class: %d\n", deviceDescriptor.bDeviceClass);
@@ -366,7 +397,38 @@ BridgeManager::BridgeManager(bool verbose)
 	fileTransferPacketSize = kFileTransferPacketSizeDefault;
 	fileTransferSequenceTimeout = kFileTransferSequenceTimeoutDefault;
 
+	deviceBusNumber = -1;
+	deviceAddress = -1;
+
+	busNumber = -1;
+
+	vendorId = 0;
+	productId = 0;
+	deviceRelease = 0;
+
+	filePartSizeSupported = false;
+	transferProfiles = nullptr;
+
+	transferScheduler = nullptr;
+	expectedBytesPerSecond = TransferScheduler::kDefaultDeviceBytesPerSecond;
+
 	usbLogLevel = UsbLogLevel::Default;
+
+	abortable = false;
+	aborted = false;
+
+	diagnostics.lastSendResult = LIBUSB_SUCCESS;
+	diagnostics.lastReceiveResult = LIBUSB_SUCCESS;
+	diagnostics.sequenceIndex = -1;
+	diagnostics.filePartIndex = -1;
+	diagnostics.waitingForBandwidth = false;
+	diagnostics.lastResponseTime = std::chrono::steady_clock::now();
+	diagnostics.receiveDeadline = diagnostics.lastResponseTime;
+
+	usbStatistics.transferCount = 0;
+	usbStatistics.retryCount = 0;
+	usbStatistics.filePartRetryCount = 0;
+	usbStatistics.timeoutCount = 0;
 }
 
 BridgeManager::~BridgeManager()
@@ -384,6 +446,77 @@ BridgeManager::~BridgeManager()
 		libusb_exit(libusbContext);
 }
 
+bool BridgeManager::IsSupportedDevice(int vendorId, int productId)
+{
+	for (int i = 0; i < BridgeManager::kSupportedDeviceCount; i++)
+	{
+		if (vendorId == supportedDevices[i].vendorId && productId == supportedDevices[i].productId)
+			return (true);
+	}
+
+	return (false);
+}
+
+bool BridgeManager::EnumerateDevices(std::vector<DeviceLocation>& devices)
+{
+	devices.clear();
+
+	libusb_context *context;
+
+	if (libusb_init(&context) != LIBUSB_SUCCESS)
+		return (false);
+
+	libusb_device **deviceList;
+	ssize_t deviceCount = libusb_get_device_list(context, &deviceList);
+
+	if (deviceCount < 0)
+	{
+		libusb_exit(context);
+		return (false);
+	}
+
+	for (ssize_t deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++)
+	{
+		libusb_device_descriptor descriptor;
+
+		if (libusb_get_device_descriptor(deviceList[deviceIndex], &descriptor) != LIBUSB_SUCCESS
+			|| !IsSupportedDevice(descriptor.idVendor, descriptor.idProduct))
+		{
+			continue;
+		}
+
+		DeviceLocation device;
+		device.vendorId = descriptor.idVendor;
+		device.productId = descriptor.idProduct;
+		device.busNumber = libusb_get_bus_number(deviceList[deviceIndex]);
+		device.deviceAddress = libusb_get_device_address(deviceList[deviceIndex]);
+
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000102)
+
+		// USB 3.0 limits a device's depth to seven tiers.
+		unsigned char portNumbers[7];
+		int portNumberCount = libusb_get_port_numbers(deviceList[deviceIndex], portNumbers, sizeof(portNumbers));
+
+		if (portNumberCount > 0)
+			device.portNumbers.assign(portNumbers, portNumbers + portNumberCount);
+
+#endif
+
+		devices.push_back(device);
+	}
+
+	libusb_free_device_list(deviceList, 1);
+	libusb_exit(context);
+
+	return (true);
+}
+
+void BridgeManager::SetDeviceLocation(int busNumber, int deviceAddress)
+{
+	deviceBusNumber = busNumber;
+	this->deviceAddress = deviceAddress;
+}
+
 bool BridgeManager::DetectDevice(void)
 {
 	// Initialise libusb
@@ -428,15 +561,12 @@ bool BridgeManager::DetectDevice(void)
 		libusb_device_descriptor descriptor;
 		libusb_get_device_descriptor(devices[deviceIndex], &descriptor);
 
-		for (int i = 0; i < BridgeManager::kSupportedDeviceCount; i++)
+		if (IsSupportedDevice(descriptor.idVendor, descriptor.idProduct))
 		{
-			if (descriptor.idVendor == supportedDevices[i].vendorId && descriptor.idProduct == supportedDevices[i].productId)
-			{
-				libusb_free_device_list(devices, deviceCount);
+			libusb_free_device_list(devices, deviceCount);
 
-				Interface::Print("Device detected\n");
-				return (true);
-			}
+			Interface::Print("Device detected\n");
+			return (true);
 		}
 	}
 
@@ -506,6 +636,7 @@ int BridgeManager::Initialise(bool resume)
 
 bool BridgeManager::BeginSession(void)
 {
+	Progress::Phase("begin-session");
 	Interface::Print("Beginning session...\n");
 
 	BeginSessionPacket beginSessionPacket;
@@ -525,43 +656,71 @@ bool BridgeManager::BeginSession(void)
 	Interface::Print("\nSome devices may take up to 2 minutes to respond.\nPlease be patient!\n\n");
 	Sleep(3000); // Give the user time to read the message.
 
-	if (deviceDefaultPacketSize != 0) // 0 means changing the packet size is not supported.
+	filePartSizeSupported = deviceDefaultPacketSize != 0; // 0 means changing the packet size is not supported.
+
+	if (filePartSizeSupported)
 	{
-		fileTransferSequenceTimeout = 120000; // 2 minutes!
-		fileTransferPacketSize = 1048576; // 1 MiB
-		fileTransferSequenceMaxLength = 30; // Therefore, fileTransferPacketSize * fileTransferSequenceMaxLength == 30 MiB per sequence.
+		fileTransferSequenceTimeout = kFileTransferSequenceTimeoutSession;
+		fileTransferPacketSize = kFileTransferPacketSizeSession;
+		fileTransferSequenceMaxLength = kFileTransferSequenceMaxLengthSession; // Therefore, 30 MiB per sequence.
+	}
 
-		FilePartSizePacket filePartSizePacket(fileTransferPacketSize);
+	const TransferProfile *transferProfile = (transferProfiles) ? transferProfiles->Find(GetTransferProfileKey()) : nullptr;
 
-		if (!SendPacket(&filePartSizePacket))
-		{
-			Interface::PrintError("Failed to send file part size packet!\n");
-			return (false);
-		}
+	if (transferProfile)
+	{
+		// Without support for changing the file part size, only the sequence length of the profile can be applied.
+		if (filePartSizeSupported)
+			fileTransferPacketSize = transferProfile->filePartSize;
 
-		SessionSetupResponse filePartSizeResponse;
+		fileTransferSequenceMaxLength = transferProfile->sequenceMaxLength;
 
-		if (!ReceivePacket(&filePartSizeResponse))
-			return (false);
+		if (transferProfile->bytesPerSecond > 0)
+			expectedBytesPerSecond = transferProfile->bytesPerSecond;
 
-		if (filePartSizeResponse.GetResult() != 0)
-		{
-			Interface::PrintError("Unexpected file part size response!\nExpected: 0\nReceived: %d\n", filePartSizeResponse.GetResult());
-			return (false);
-		}
+		Interface::Print("Using transfer profile %s: %u byte file parts, %u parts per sequence\n", GetTransferProfileKey().c_str(),
+			fileTransferPacketSize, fileTransferSequenceMaxLength);
 	}
 
+	if (filePartSizeSupported && !SendFilePartSize(fileTransferPacketSize))
+		return (false);
+
 	Interface::Print("Session begun.\n\n");
 	return (true);
 }
 
+bool BridgeManager::SendFilePartSize(unsigned int filePartSize)
+{
+	FilePartSizePacket filePartSizePacket(filePartSize);
+
+	if (!SendPacket(&filePartSizePacket))
+	{
+		Interface::PrintError("Failed to send file part size packet!\n");
+		return (false);
+	}
+
+	SessionSetupResponse filePartSizeResponse;
+
+	if (!ReceivePacket(&filePartSizeResponse))
+		return (false);
+
+	if (filePartSizeResponse.GetResult() != 0)
+	{
+		Interface::PrintError("Unexpected file part size response!\nExpected: 0\nReceived: %d\n", filePartSizeResponse.GetResult());
+		return (false);
+	}
+
+	fileTransferPacketSize = filePartSize;
+	return (true);
+}
+
 bool BridgeManager::EndSession(bool reboot) const
 {
+	Progress::Phase("end-session");
 	Interface::Print("Ending session...\n");
 
-	EndSessionPacket *endSessionPacket = new EndSessionPacket(EndSessionPacket::kRequestEndSession);
-	bool success = SendPacket(endSessionPacket);
-	delete endSessionPacket;
+	EndSessionPacket endSessionPacket(EndSessionPacket::kRequestEndSession);
+	bool success = SendPacket(&endSessionPacket);
 
 	if (!success)
 	{
@@ -570,9 +729,8 @@ bool BridgeManager::EndSession(bool reboot) const
 		return (false);
 	}
 
-	ResponsePacket *endSessionResponse = new ResponsePacket(ResponsePacket::kResponseTypeEndSession);
-	success = ReceivePacket(endSessionResponse);
-	delete endSessionResponse;
+	ResponsePacket endSessionResponse(ResponsePacket::kResponseTypeEndSession);
+	success = ReceivePacket(&endSessionResponse);
 
 	if (!success)
 	{
@@ -584,10 +742,10 @@ bool BridgeManager::EndSession(bool reboot) const
 	if (reboot)
 	{
 		Interface::Print("Rebooting device...\n");
+		Progress::Phase("reboot");
 
-		EndSessionPacket *rebootDevicePacket = new EndSessionPacket(EndSessionPacket::kRequestRebootDevice);
-		bool success = SendPacket(rebootDevicePacket);
-		delete rebootDevicePacket;
+		EndSessionPacket rebootDevicePacket(EndSessionPacket::kRequestRebootDevice);
+		bool success = SendPacket(&rebootDevicePacket);
 
 		if (!success)
 		{
@@ -596,9 +754,8 @@ bool BridgeManager::EndSession(bool reboot) const
 			return (false);
 		}
 
-		ResponsePacket *rebootDeviceResponse = new ResponsePacket(ResponsePacket::kResponseTypeEndSession);
-		success = ReceivePacket(rebootDeviceResponse);
-		delete rebootDeviceResponse;
+		ResponsePacket rebootDeviceResponse(ResponsePacket::kResponseTypeEndSession);
+		success = ReceivePacket(&rebootDeviceResponse);
 
 		if (!success)
 		{
@@ -611,10 +768,95 @@ bool BridgeManager::EndSession(bool reboot) const
 	return (true);
 }
 
+void BridgeManager::SetFilePart(int sequenceIndex, int filePartIndex) const
+{
+	std::lock_guard<std::mutex> lock(diagnosticsMutex);
+
+	diagnostics.sequenceIndex = sequenceIndex;
+	diagnostics.filePartIndex = filePartIndex;
+}
+
+int BridgeManager::BulkSend(unsigned char *data, int length, int *dataTransferred, int timeout) const
+{
+	*dataTransferred = 0;
+
+	int result = (aborted) ? LIBUSB_ERROR_INTERRUPTED : libusb_bulk_transfer(deviceHandle, outEndpoint, data, length, dataTransferred,
+		timeout);
+
+	std::lock_guard<std::mutex> lock(diagnosticsMutex);
+	diagnostics.lastSendResult = result;
+
+	return (result);
+}
+
+int BridgeManager::BulkReceive(unsigned char *data, int length, int *dataTransferred, int timeout) const
+{
+	*dataTransferred = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(diagnosticsMutex);
+		diagnostics.receiveDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+	}
+
+	int result = LIBUSB_ERROR_INTERRUPTED;
+
+	if (!abortable)
+	{
+		if (!aborted)
+			result = libusb_bulk_transfer(deviceHandle, inEndpoint, data, length, dataTransferred, timeout);
+	}
+	else
+	{
+		// Wait in slices, so that an aborted session isn't left waiting for as long as a sequence may take to be confirmed.
+		while (!aborted)
+		{
+			int sliceTimeout = (timeout > kAbortPollInterval) ? kAbortPollInterval : timeout;
+			result = libusb_bulk_transfer(deviceHandle, inEndpoint, data, length, dataTransferred, sliceTimeout);
+			timeout -= sliceTimeout;
+
+			if (result != LIBUSB_ERROR_TIMEOUT || *dataTransferred > 0 || timeout <= 0)
+				break;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(diagnosticsMutex);
+	diagnostics.lastReceiveResult = result;
+
+	if (result == LIBUSB_SUCCESS)
+		diagnostics.lastResponseTime = std::chrono::steady_clock::now();
+
+	return (result);
+}
+
+void BridgeManager::RecordTransferResult(int result, bool retry) const
+{
+	std::lock_guard<std::mutex> lock(diagnosticsMutex);
+
+	usbStatistics.transferCount++;
+
+	if (retry)
+		usbStatistics.retryCount++;
+
+	// Aborted transfers say nothing about the health of the connection.
+	if (result == LIBUSB_ERROR_TIMEOUT)
+		usbStatistics.timeoutCount++;
+	else if (result != LIBUSB_SUCCESS && result != LIBUSB_ERROR_INTERRUPTED)
+		usbStatistics.errorCounts[result]++;
+}
+
+void BridgeManager::RecordFilePartRetry(void) const
+{
+	std::lock_guard<std::mutex> lock(diagnosticsMutex);
+	usbStatistics.filePartRetryCount++;
+}
+
 bool BridgeManager::SendBulkTransfer(unsigned char *data, int length, int timeout, bool retry) const
 {
 	int dataTransferred;
-	int result = libusb_bulk_transfer(deviceHandle, outEndpoint, data, length, &dataTransferred, timeout);
+	int result = BulkSend(data, length, &dataTransferred, timeout);
+
+	if (retry)
+		RecordTransferResult(result, false);
 
 	if (result != LIBUSB_SUCCESS && retry)
 	{
@@ -624,7 +866,7 @@ bool BridgeManager::SendBulkTransfer(unsigned char *data, int length, int timeou
 			Interface::PrintError("libusb error %d whilst sending bulk transfer.", result);
 
 		// Retry
-		for (int i = 0; i < 5; i++)
+		for (int i = 0; i < 5 && !aborted; i++)
 		{
 			if (verbose)
 				Interface::PrintErrorSameLine(" Retrying...\n");
@@ -632,7 +874,8 @@ bool BridgeManager::SendBulkTransfer(unsigned char *data, int length, int timeou
 			// Wait longer each retry
 			Sleep(retryDelay * (i + 1));
 
-			result = libusb_bulk_transfer(deviceHandle, outEndpoint, data, length, &dataTransferred, timeout);
+			result = BulkSend(data, length, &dataTransferred, timeout);
+			RecordTransferResult(result, true);
 
 			if (result == LIBUSB_SUCCESS)
 				break;
@@ -650,7 +893,10 @@ bool BridgeManager::SendBulkTransfer(unsigned char *data, int length, int timeou
 
 int BridgeManager::ReceiveBulkTransfer(unsigned char *data, int length, int timeout, bool retry) const
 {
-	if (data == nullptr)
+	// Empty transfers are allowed to fail, so they say nothing about the health of the connection.
+	bool emptyTransfer = data == nullptr;
+
+	if (emptyTransfer)
 	{
 		// HACK: It seems WinUSB ignores us when we try to read with length zero.
 		static unsigned char dummyData;
@@ -659,7 +905,10 @@ int BridgeManager::ReceiveBulkTransfer(unsigned char *data, int length, int time
 	}
 
 	int dataTransferred;
-	int result = libusb_bulk_transfer(deviceHandle, inEndpoint, data, length, &dataTransferred, timeout);
+	int result = BulkReceive(data, length, &dataTransferred, timeout);
+
+	if (!emptyTransfer)
+		RecordTransferResult(result, false);
 
 	if (result != LIBUSB_SUCCESS && retry)
 	{
@@ -669,7 +918,7 @@ int BridgeManager::ReceiveBulkTransfer(unsigned char *data, int length, int time
 			Interface::PrintError("libusb error %d whilst receiving bulk transfer.", result);
 
 		// Retry
-		for (int i = 0; i < 5; i++)
+		for (int i = 0; i < 5 && !aborted; i++)
 		{
 			if (verbose)
 				Interface::PrintErrorSameLine(" Retrying...\n");
@@ -677,7 +926,8 @@ int BridgeManager::ReceiveBulkTransfer(unsigned char *data, int length, int time
 			// Wait longer each retry
 			Sleep(retryDelay * (i + 1));
 
-			result = libusb_bulk_transfer(deviceHandle, inEndpoint, data, length, &dataTransferred, timeout);
+			result = BulkReceive(data, length, &dataTransferred, timeout);
+			RecordTransferResult(result, true);
 
 			if (result == LIBUSB_SUCCESS)
 				break;
@@ -722,7 +972,7 @@ bool BridgeManager::SendPacket(OutboundPacket *packet, int timeout, int emptyTra
 	return (true);
 }
 
-bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, int emptyTransferFlags) const
+bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, int emptyTransferFlags, bool retry) const
 {
 	if (emptyTransferFlags & kEmptyTransferBefore)
 	{
@@ -732,12 +982,12 @@ bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, int emptyT
 		}
 	}
 
-	int receivedSize = ReceiveBulkTransfer(packet->GetData(), packet->GetSize(), timeout);
+	int receivedSize = ReceiveBulkTransfer(packet->GetData(), packet->GetSize(), timeout, retry);
 
 	if (receivedSize < 0)
 		return (false);
 
-	if (receivedSize != packet->GetSize() && !packet->IsSizeVariable())
+	if ((unsigned int)receivedSize != packet->GetSize() && !packet->IsSizeVariable())
 	{
 		if (verbose)
 			Interface::PrintError("Incorrect packet size received - expected size = %d, received size = %d.\n", packet->GetSize(), receivedSize);
@@ -790,12 +1040,13 @@ bool BridgeManager::RequestDeviceType(unsigned int request, int *result) const
 
 bool BridgeManager::SendPitData(const PitData *pitData) const
 {
+	Progress::Phase("upload-pit");
+
 	unsigned int pitBufferSize = pitData->GetPaddedSize();
 
 	// Start file transfer
-	PitFilePacket *pitFilePacket = new PitFilePacket(PitFilePacket::kRequestFlash);
-	bool success = SendPacket(pitFilePacket);
-	delete pitFilePacket;
+	PitFilePacket pitFilePacket(PitFilePacket::kRequestFlash);
+	bool success = SendPacket(&pitFilePacket);
 
 	if (!success)
 	{
@@ -803,9 +1054,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 		return (false);
 	}
 
-	PitFileResponse *pitFileResponse = new PitFileResponse();
-	success = ReceivePacket(pitFileResponse);
-	delete pitFileResponse;
+	PitFileResponse pitFileResponse;
+	success = ReceivePacket(&pitFileResponse);
 
 	if (!success)
 	{
@@ -814,9 +1064,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 	}
 
 	// Transfer file size
-	FlashPartPitFilePacket *flashPartPitFilePacket = new FlashPartPitFilePacket(pitBufferSize);
-	success = SendPacket(flashPartPitFilePacket);
-	delete flashPartPitFilePacket;
+	FlashPartPitFilePacket flashPartPitFilePacket(pitBufferSize);
+	success = SendPacket(&flashPartPitFilePacket);
 
 	if (!success)
 	{
@@ -824,9 +1073,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 		return (false);
 	}
 
-	pitFileResponse = new PitFileResponse();
-	success = ReceivePacket(pitFileResponse);
-	delete pitFileResponse;
+	PitFileResponse partSizeResponse;
+	success = ReceivePacket(&partSizeResponse);
 
 	if (!success)
 	{
@@ -842,9 +1090,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 	pitData->Pack(pitBuffer);
 
 	// Flash pit file
-	SendFilePartPacket *sendFilePartPacket = new SendFilePartPacket(pitBuffer, pitBufferSize);
-	success = SendPacket(sendFilePartPacket);
-	delete sendFilePartPacket;
+	SendFilePartPacket sendFilePartPacket(nullptr, pitBuffer, pitBufferSize, 0, pitBufferSize);
+	success = SendPacket(&sendFilePartPacket);
 
 	delete [] pitBuffer;
 
@@ -854,9 +1101,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 		return (false);
 	}
 
-	pitFileResponse = new PitFileResponse();
-	success = ReceivePacket(pitFileResponse);
-	delete pitFileResponse;
+	PitFileResponse filePartResponse;
+	success = ReceivePacket(&filePartResponse);
 
 	if (!success)
 	{
@@ -865,9 +1111,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 	}
 
 	// End pit file transfer
-	EndPitFileTransferPacket *endPitFileTransferPacket = new EndPitFileTransferPacket(pitBufferSize);
-	success = SendPacket(endPitFileTransferPacket);
-	delete endPitFileTransferPacket;
+	EndPitFileTransferPacket endPitFileTransferPacket(pitBufferSize);
+	success = SendPacket(&endPitFileTransferPacket);
 
 	if (!success)
 	{
@@ -875,9 +1120,8 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 		return (false);
 	}
 
-	pitFileResponse = new PitFileResponse();
-	success = ReceivePacket(pitFileResponse);
-	delete pitFileResponse;
+	PitFileResponse endTransferResponse;
+	success = ReceivePacket(&endTransferResponse);
 
 	if (!success)
 	{
@@ -888,16 +1132,17 @@ bool BridgeManager::SendPitData(const PitData *pitData) const
 	return (true);
 }
 
-int BridgeManager::ReceivePitFile(unsigned char **pitBuffer) const
+int BridgeManager::ReceivePitFile(unsigned char **pitBuffer, const PitCache *pitCache, bool allowEarlyEnd) const
 {
+	Progress::Phase("download-pit");
+
 	*pitBuffer = nullptr;
 
 	bool success;
 
 	// Start file transfer
-	PitFilePacket *pitFilePacket = new PitFilePacket(PitFilePacket::kRequestDump);
-	success = SendPacket(pitFilePacket);
-	delete pitFilePacket;
+	PitFilePacket pitFilePacket(PitFilePacket::kRequestDump);
+	success = SendPacket(&pitFilePacket);
 
 	if (!success)
 	{
@@ -905,10 +1150,9 @@ int BridgeManager::ReceivePitFile(unsigned char **pitBuffer) const
 		return (0);
 	}
 
-	PitFileResponse *pitFileResponse = new PitFileResponse();
-	success = ReceivePacket(pitFileResponse);
-	unsigned int fileSize = pitFileResponse->GetFileSize();
-	delete pitFileResponse;
+	PitFileResponse pitFileResponse;
+	success = ReceivePacket(&pitFileResponse);
+	unsigned int fileSize = pitFileResponse.GetFileSize();
 
 	if (!success)
 	{
@@ -920,74 +1164,135 @@ int BridgeManager::ReceivePitFile(unsigned char **pitBuffer) const
 	if (fileSize % ReceiveFilePartPacket::kDataSize != 0)
 		transferCount++;
 
+	// A cached PIT is only worth checking if it's the same size as the device's.
+	unsigned char *cachedBuffer = nullptr;
+
+	if (pitCache && allowEarlyEnd && !serialNumber.empty() && pitCache->Load(serialNumber, &cachedBuffer) != fileSize)
+	{
+		delete [] cachedBuffer;
+		cachedBuffer = nullptr;
+	}
+
+	bool cached = false;
+	bool endedEarly = false;
+
 	unsigned char *buffer = new unsigned char[fileSize];
-	int offset = 0;
+	unsigned int offset = 0;
 
 	for (unsigned int i = 0; i < transferCount; i++)
 	{
-		DumpPartPitFilePacket *requestPacket = new DumpPartPitFilePacket(i);
-		success = SendPacket(requestPacket);
-		delete requestPacket;
+		DumpPartPitFilePacket requestPacket(i);
+		success = SendPacket(&requestPacket);
 
 		if (!success)
 		{
 			Interface::PrintError("Failed to request PIT file part #%d!\n", i);
+			delete [] cachedBuffer;
 			delete [] buffer;
 			return (0);
 		}
 
 		int receiveEmptyTransferFlags = (i == transferCount - 1) ? kEmptyTransferAfter : kEmptyTransferNone;
 		
-		ReceiveFilePartPacket *receiveFilePartPacket = new ReceiveFilePartPacket();
-		success = ReceivePacket(receiveFilePartPacket, kDefaultTimeoutReceive, receiveEmptyTransferFlags);
+		ReceiveFilePartPacket receiveFilePartPacket;
+		success = ReceivePacket(&receiveFilePartPacket, kDefaultTimeoutReceive, receiveEmptyTransferFlags);
 
 		if (!success)
 		{
 			Interface::PrintError("Failed to receive PIT file part #%d!\n", i);
-			delete receiveFilePartPacket;
+			delete [] cachedBuffer;
 			delete [] buffer;
 			return (0);
 		}
 
-		// Copy the whole packet data into the buffer.
-		memcpy(buffer + offset, receiveFilePartPacket->GetData(), receiveFilePartPacket->GetReceivedSize());
-		offset += receiveFilePartPacket->GetReceivedSize();
+		// Copy the whole packet data into the buffer, but never past the file size the device reported.
+		unsigned int partSize = receiveFilePartPacket.GetReceivedSize();
+
+		if (partSize > fileSize - offset)
+			partSize = fileSize - offset;
+
+		memcpy(buffer + offset, receiveFilePartPacket.GetData(), partSize);
+		offset += partSize;
 
-		delete receiveFilePartPacket;
+		if (cachedBuffer)
+		{
+			if (memcmp(buffer, cachedBuffer, offset) == 0)
+			{
+				if (i < transferCount - 1)
+				{
+					// The header and leading entries match, so skip the rest of the download.
+					if (ReceiveBulkTransfer(nullptr, 0, kDefaultTimeoutEmptyTransfer, false) < 0 && verbose)
+						Interface::PrintWarning("Empty bulk transfer after receiving packet failed. Continuing anyway...\n");
+
+					endedEarly = true;
+				}
+
+				Interface::Print("Using cached PIT file.\n");
+
+				delete [] buffer;
+				buffer = cachedBuffer;
+				cachedBuffer = nullptr;
+				cached = true;
+				break;
+			}
+
+			delete [] cachedBuffer;
+			cachedBuffer = nullptr;
+		}
 	}
 
 	// End file transfer
-	pitFilePacket = new PitFilePacket(PitFilePacket::kRequestEndTransfer);
-	success = SendPacket(pitFilePacket);
-	delete pitFilePacket;
+	PitFilePacket endTransferPacket(PitFilePacket::kRequestEndTransfer);
+	success = SendPacket(&endTransferPacket);
 
-	if (!success)
+	if (!success && !endedEarly)
 	{
 		Interface::PrintError("Failed to send request to end PIT file transfer!\n");
 		delete [] buffer;
 		return (0);
 	}
 
-	pitFileResponse = new PitFileResponse();
-	success = ReceivePacket(pitFileResponse);
-	delete pitFileResponse;
+	PitFileResponse endTransferResponse;
 
-	if (!success)
+	if (success)
+		success = ReceivePacket(&endTransferResponse);
+
+	if (!success && !endedEarly)
 	{
 		Interface::PrintError("Failed to receive end PIT file transfer verification!\n");
 		delete [] buffer;
 		return (0);
 	}
 
+	if (!success)
+	{
+		// Not every bootloader is known to accept ending the transfer before the last part, so download all of it instead.
+		Interface::PrintWarning("Device didn't confirm the early end of the PIT file transfer, downloading all of it...\n");
+		delete [] buffer;
+
+		return (ReceivePitFile(pitBuffer, pitCache, false));
+	}
+
+	if (pitCache && !serialNumber.empty() && !cached && !pitCache->Store(serialNumber, buffer, fileSize))
+		Interface::PrintWarning("Failed to store PIT file in cache.\n");
+
 	*pitBuffer = buffer;
 	return (fileSize);
 }
 
-int BridgeManager::DownloadPitFile(unsigned char **pitBuffer) const
+int BridgeManager::ReceivePitFile(unsigned char **pitBuffer, const PitCache *pitCache) const
+{
+	return (ReceivePitFile(pitBuffer, pitCache, true));
+}
+
+int BridgeManager::DownloadPitFile(unsigned char **pitBuffer, const PitCache *pitCache) const
 {
 	Interface::Print("Downloading device's PIT file...\n");
 
-	int devicePitFileSize = ReceivePitFile(pitBuffer);
+	if (pitCache && serialNumber.empty())
+		Interface::PrintWarning("Device has no serial number, so its PIT file can't be cached.\n");
+
+	int devicePitFileSize = ReceivePitFile(pitBuffer, pitCache);
 
 	if (!*pitBuffer)
 	{
@@ -1000,6 +1305,22 @@ int BridgeManager::DownloadPitFile(unsigned char **pitBuffer) const
 }
 
 bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int deviceType, unsigned int fileIdentifier) const
+{
+	FileSeek(file, 0, SEEK_END);
+	unsigned int fileSize = (unsigned int)FileTell(file);
+	FileRewind(file);
+
+	return (SendFile(file, nullptr, fileSize, destination, deviceType, fileIdentifier));
+}
+
+bool BridgeManager::SendFile(const unsigned char *fileData, unsigned int fileSize, unsigned int destination, unsigned int deviceType,
+	unsigned int fileIdentifier) const
+{
+	return (SendFile(nullptr, fileData, fileSize, destination, deviceType, fileIdentifier));
+}
+
+bool BridgeManager::SendFile(FILE *file, const unsigned char *fileData, unsigned int fileSize, unsigned int destination,
+	unsigned int deviceType, unsigned int fileIdentifier) const
 {
 	if (destination != EndFileTransferPacket::kDestinationModem && destination != EndFileTransferPacket::kDestinationPhone)
 	{
@@ -1013,9 +1334,22 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 		return (false);
 	}
 
-	FileTransferPacket *flashFileTransferPacket = new FileTransferPacket(FileTransferPacket::kRequestFlash);
-	bool success = SendPacket(flashFileTransferPacket);
-	delete flashFileTransferPacket;
+	{
+		std::lock_guard<std::mutex> lock(diagnosticsMutex);
+		diagnostics.waitingForBandwidth = true;
+	}
+
+	// Wait before the transfer begins, while the device is idle, so that time spent waiting can't cause a timeout.
+	TransferScheduler::Slot transferSlot(transferScheduler, busNumber, portNumbers, expectedBytesPerSecond);
+
+	{
+		std::lock_guard<std::mutex> lock(diagnosticsMutex);
+		diagnostics.waitingForBandwidth = false;
+		diagnostics.lastResponseTime = std::chrono::steady_clock::now();
+	}
+
+	FileTransferPacket flashFileTransferPacket(FileTransferPacket::kRequestFlash);
+	bool success = SendPacket(&flashFileTransferPacket);
 
 	if (!success)
 	{
@@ -1023,13 +1357,8 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 		return (false);
 	}
 
-	FileSeek(file, 0, SEEK_END);
-	unsigned int fileSize = (unsigned int)FileTell(file);
-	FileRewind(file);
-
-	ResponsePacket *fileTransferResponse = new ResponsePacket(ResponsePacket::kResponseTypeFileTransfer);
-	success = ReceivePacket(fileTransferResponse);
-	delete fileTransferResponse;
+	ResponsePacket fileTransferResponse(ResponsePacket::kResponseTypeFileTransfer);
+	success = ReceivePacket(&fileTransferResponse);
 
 	if (!success)
 	{
@@ -1053,9 +1382,7 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 	}
 
 	unsigned int bytesTransferred = 0;
-	unsigned int currentPercent;
-	unsigned int previousPercent = 0;
-	Interface::Print("0%%");
+	Progress::BeginTransfer(fileSize, verbose);
 
 	for (unsigned int sequenceIndex = 0; sequenceIndex < sequenceCount; sequenceIndex++)
 	{
@@ -1063,9 +1390,8 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 		unsigned int sequenceSize = (isLastSequence) ? lastSequenceSize : fileTransferSequenceMaxLength;
 		unsigned int sequenceTotalByteCount = sequenceSize * fileTransferPacketSize;
 
-		FlashPartFileTransferPacket *beginFileTransferPacket = new FlashPartFileTransferPacket(sequenceTotalByteCount);
-		success = SendPacket(beginFileTransferPacket);
-		delete beginFileTransferPacket;
+		FlashPartFileTransferPacket beginFileTransferPacket(sequenceTotalByteCount);
+		success = SendPacket(&beginFileTransferPacket);
 
 		if (!success)
 		{
@@ -1074,9 +1400,8 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 			return (false);
 		}
 
-		fileTransferResponse = new ResponsePacket(ResponsePacket::kResponseTypeFileTransfer);
-		bool success = ReceivePacket(fileTransferResponse);
-		delete fileTransferResponse;
+		ResponsePacket beginSequenceResponse(ResponsePacket::kResponseTypeFileTransfer);
+		bool success = ReceivePacket(&beginSequenceResponse);
 
 		if (!success)
 		{
@@ -1090,10 +1415,12 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 			// NOTE: This empty transfer thing is entirely ridiculous, but sadly it seems to be required.
 			int sendEmptyTransferFlags = (filePartIndex == 0) ? kEmptyTransferNone : kEmptyTransferBefore;
 
+			unsigned int filePartOffset = (sequenceIndex * fileTransferSequenceMaxLength + filePartIndex) * fileTransferPacketSize;
+			SetFilePart(sequenceIndex, filePartIndex);
+
 			// Send
-			SendFilePartPacket *sendFilePartPacket = new SendFilePartPacket(file, fileTransferPacketSize);
-			success = SendPacket(sendFilePartPacket, kDefaultTimeoutSend, sendEmptyTransferFlags);
-			delete sendFilePartPacket;
+			SendFilePartPacket sendFilePartPacket(file, fileData, fileSize, filePartOffset, fileTransferPacketSize);
+			success = SendPacket(&sendFilePartPacket, kDefaultTimeoutSend, sendEmptyTransferFlags);
 
 			if (!success)
 			{
@@ -1103,26 +1430,25 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 			}
 
 			// Response
-			SendFilePartResponse *sendFilePartResponse = new SendFilePartResponse();
-			success = ReceivePacket(sendFilePartResponse);
-			int receivedPartIndex = sendFilePartResponse->GetPartIndex();
-
-			delete sendFilePartResponse;
+			SendFilePartResponse sendFilePartResponse;
+			success = ReceivePacket(&sendFilePartResponse);
+			unsigned int receivedPartIndex = sendFilePartResponse.GetPartIndex();
 
 			if (!success)
 			{
 				Interface::PrintErrorSameLine("\n");
 				Interface::PrintError("Failed to receive file part response!\n");
 
-				for (int retry = 0; retry < 4; retry++)
+				for (int retry = 0; retry < 4 && !aborted; retry++)
 				{
 					Interface::PrintErrorSameLine("\n");
 					Interface::PrintError("Retrying...");
+					Progress::Retry(retry + 1);
+					RecordFilePartRetry();
 
 					// Send
-					sendFilePartPacket = new SendFilePartPacket(file, fileTransferPacketSize);
-					success = SendPacket(sendFilePartPacket, kDefaultTimeoutSend, sendEmptyTransferFlags);
-					delete sendFilePartPacket;
+					SendFilePartPacket retryFilePartPacket(file, fileData, fileSize, filePartOffset, fileTransferPacketSize);
+					success = SendPacket(&retryFilePartPacket, kDefaultTimeoutSend, sendEmptyTransferFlags);
 
 					if (!success)
 					{
@@ -1132,11 +1458,9 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 					}
 
 					// Response
-					sendFilePartResponse = new SendFilePartResponse();
-					success = ReceivePacket(sendFilePartResponse);
-					unsigned int receivedPartIndex = sendFilePartResponse->GetPartIndex();
-
-					delete sendFilePartResponse;
+					SendFilePartResponse retryFilePartResponse;
+					success = ReceivePacket(&retryFilePartResponse);
+					unsigned int receivedPartIndex = retryFilePartResponse.GetPartIndex();
 
 					if (receivedPartIndex != filePartIndex)
 					{
@@ -1165,24 +1489,7 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 			if (bytesTransferred > fileSize)
 				bytesTransferred = fileSize;
 
-			currentPercent = (unsigned int)(100.0 * ((double)bytesTransferred / (double)fileSize));
-
-			if (currentPercent != previousPercent)
-			{
-				if (!verbose)
-				{
-					if (previousPercent < 10)
-						Interface::Print("\b\b%d%%", currentPercent);
-					else
-						Interface::Print("\b\b\b%d%%", currentPercent);
-				}
-				else
-				{
-					Interface::Print("\n%d%%\n", currentPercent);
-				}
-			}
-
-			previousPercent = currentPercent;
+			Progress::Transfer(bytesTransferred);
 		}
 
 		unsigned int sequenceEffectiveByteCount = (isLastSequence && partialPacketByteCount != 0) ?
@@ -1190,10 +1497,9 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 
 		if (destination == EndFileTransferPacket::kDestinationPhone)
 		{
-			EndPhoneFileTransferPacket *endPhoneFileTransferPacket = new EndPhoneFileTransferPacket(sequenceEffectiveByteCount, 0, deviceType, fileIdentifier, isLastSequence);
+			EndPhoneFileTransferPacket endPhoneFileTransferPacket(sequenceEffectiveByteCount, 0, deviceType, fileIdentifier, isLastSequence);
 
-			success = SendPacket(endPhoneFileTransferPacket, kDefaultTimeoutSend, kEmptyTransferBeforeAndAfter);
-			delete endPhoneFileTransferPacket;
+			success = SendPacket(&endPhoneFileTransferPacket, kDefaultTimeoutSend, kEmptyTransferBeforeAndAfter);
 
 			if (!success)
 			{
@@ -1204,10 +1510,9 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 		}
 		else // destination == EndFileTransferPacket::kDestinationModem
 		{
-			EndModemFileTransferPacket *endModemFileTransferPacket = new EndModemFileTransferPacket(sequenceEffectiveByteCount, 0, deviceType, isLastSequence);
+			EndModemFileTransferPacket endModemFileTransferPacket(sequenceEffectiveByteCount, 0, deviceType, isLastSequence);
 
-			success = SendPacket(endModemFileTransferPacket, kDefaultTimeoutSend, kEmptyTransferBeforeAndAfter);
-			delete endModemFileTransferPacket;
+			success = SendPacket(&endModemFileTransferPacket, kDefaultTimeoutSend, kEmptyTransferBeforeAndAfter);
 
 			if (!success)
 			{
@@ -1217,9 +1522,10 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 			}
 		}
 
-		fileTransferResponse = new ResponsePacket(ResponsePacket::kResponseTypeFileTransfer);
-		success = ReceivePacket(fileTransferResponse, fileTransferSequenceTimeout);
-		delete fileTransferResponse;
+		// A watched device that hasn't committed the sequence within the timeout is considered stalled, rather than being waited
+		// for several more times.
+		ResponsePacket endSequenceResponse(ResponsePacket::kResponseTypeFileTransfer);
+		success = ReceivePacket(&endSequenceResponse, fileTransferSequenceTimeout, kEmptyTransferNone, !abortable);
 
 		if (!success)
 		{
@@ -1229,12 +1535,70 @@ bool BridgeManager::SendFile(FILE *file, unsigned int destination, unsigned int
 		}
 	}
 
-	if (!verbose)
-		Interface::Print("\n");
+	SetFilePart(-1, -1);
+	Progress::EndTransfer();
+
+	return (true);
+}
+
+void BridgeManager::SetTransferProfiles(const TransferProfiles *transferProfiles)
+{
+	this->transferProfiles = transferProfiles;
+}
+
+void BridgeManager::SetTransferScheduler(TransferScheduler *transferScheduler)
+{
+	this->transferScheduler = transferScheduler;
+}
+
+void BridgeManager::EnableAbort(void)
+{
+	abortable = true;
+}
 
+void BridgeManager::Abort(void)
+{
+	aborted = true;
+}
+
+TransferDiagnostics BridgeManager::GetTransferDiagnostics(void) const
+{
+	std::lock_guard<std::mutex> lock(diagnosticsMutex);
+	return (diagnostics);
+}
+
+UsbStatistics BridgeManager::GetUsbStatistics(void) const
+{
+	std::lock_guard<std::mutex> lock(diagnosticsMutex);
+	return (usbStatistics);
+}
+
+bool BridgeManager::SetFileTransferParameters(unsigned int filePartSize, unsigned int sequenceMaxLength)
+{
+	if (filePartSize == 0 || sequenceMaxLength == 0)
+		return (false);
+
+	if (filePartSize != fileTransferPacketSize)
+	{
+		if (!filePartSizeSupported)
+		{
+			Interface::PrintError("The device doesn't support changing the file part size!\n");
+			return (false);
+		}
+
+		if (!SendFilePartSize(filePartSize))
+			return (false);
+	}
+
+	fileTransferSequenceMaxLength = sequenceMaxLength;
 	return (true);
 }
 
+std::string BridgeManager::GetTransferProfileKey(void) const
+{
+	return (TransferProfiles::GetKey(vendorId, productId, deviceRelease));
+}
+
 void BridgeManager::SetUsbLogLevel(UsbLogLevel usbLogLevel)
 {
 	this->usbLogLevel = usbLogLevel;
@@ -21,6 +21,14 @@
 #ifndef BRIDGEMANAGER_H
 #define BRIDGEMANAGER_H
 
+// C/C++ Standard Library
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
 // libpit
 #include "libpit.h"
 
@@ -35,6 +43,9 @@ namespace Heimdall
 {
 	class InboundPacket;
 	class OutboundPacket;
+	class PitCache;
+	class TransferProfiles;
+	class TransferScheduler;
 
 	class DeviceIdentifier
 	{
@@ -50,6 +61,44 @@ namespace Heimdall
 			}
 	};
 
+	// Where a supported device is attached, as reported by BridgeManager::EnumerateDevices().
+	struct DeviceLocation
+	{
+		int vendorId;
+		int productId;
+		int busNumber;
+		int deviceAddress;
+		std::vector<unsigned char> portNumbers; // From the root hub, empty if libusb can't report them.
+	};
+
+	// The state of a session's USB transfers, for diagnosing a device that has stopped responding.
+	struct TransferDiagnostics
+	{
+		int lastSendResult; // libusb result codes
+		int lastReceiveResult;
+
+		int sequenceIndex; // -1 unless a file is being sent.
+		int filePartIndex;
+
+		// The device is idle whilst a file transfer waits for bandwidth, so the wait ending counts as a response.
+		bool waitingForBandwidth;
+		std::chrono::steady_clock::time_point lastResponseTime;
+
+		// The device is due to respond by the later of these, as a receive may legitimately take its whole timeout.
+		std::chrono::steady_clock::time_point receiveDeadline; // Of the receive in progress, or the most recent one.
+	};
+
+	// Counts of a session's USB transfers, other than the empty transfers the protocol tolerates failing.
+	struct UsbStatistics
+	{
+		unsigned int transferCount; // Including retries.
+		unsigned int retryCount;
+		unsigned int filePartRetryCount; // File parts resent because the device didn't acknowledge them.
+		unsigned int timeoutCount;
+
+		std::map<int, unsigned int> errorCounts; // Keyed by libusb error code, excluding timeouts.
+	};
+
 	class BridgeManager
 	{
 		public:
@@ -85,6 +134,11 @@ namespace Heimdall
 				kDefaultTimeoutEmptyTransfer = 100
 			};
 
+			enum
+			{
+				kAbortPollInterval = 500 // milliseconds
+			};
+
 			enum class UsbLogLevel
 			{
 				None = 0,
@@ -121,6 +175,19 @@ namespace Heimdall
 
 			bool interfaceClaimed;
 
+			std::string serialNumber;
+
+			int deviceBusNumber;
+			int deviceAddress;
+
+			// Where the device is connected, once initialised.
+			int busNumber;
+			std::vector<unsigned char> portNumbers;
+
+			unsigned int vendorId;
+			unsigned int productId;
+			unsigned int deviceRelease;
+
 #ifdef OS_LINUX
 
 			bool detachedDriver;
@@ -131,8 +198,21 @@ namespace Heimdall
 			unsigned int fileTransferPacketSize;
 			unsigned int fileTransferSequenceTimeout;
 
+			bool filePartSizeSupported;
+			const TransferProfiles *transferProfiles;
+
+			TransferScheduler *transferScheduler;
+			unsigned int expectedBytesPerSecond; // Demanded of the transfer scheduler by each file transfer.
+
 			UsbLogLevel usbLogLevel;
 
+			bool abortable;
+			std::atomic<bool> aborted;
+
+			mutable std::mutex diagnosticsMutex; // Guards diagnostics and usbStatistics.
+			mutable TransferDiagnostics diagnostics;
+			mutable UsbStatistics usbStatistics;
+
 			int FindDeviceInterface(void);
 			bool ClaimDeviceInterface(void);
 			bool SetupDeviceInterface(void);
@@ -140,6 +220,22 @@ namespace Heimdall
 
 			bool InitialiseProtocol(void);
 
+			bool SendFilePartSize(unsigned int filePartSize);
+
+			// Reads from fileData if provided, otherwise from file.
+			bool SendFile(FILE *file, const unsigned char *fileData, unsigned int fileSize, unsigned int destination, unsigned int deviceType,
+				unsigned int fileIdentifier) const;
+
+			// allowEarlyEnd stops downloading once the first part matches the cached PIT.
+			int ReceivePitFile(unsigned char **pitBuffer, const PitCache *pitCache, bool allowEarlyEnd) const;
+
+			void SetFilePart(int sequenceIndex, int filePartIndex) const;
+			void RecordTransferResult(int result, bool retry) const;
+			void RecordFilePartRetry(void) const;
+
+			int BulkSend(unsigned char *data, int length, int *dataTransferred, int timeout) const;
+			int BulkReceive(unsigned char *data, int length, int *dataTransferred, int timeout) const;
+
 			bool SendBulkTransfer(unsigned char *data, int length, int timeout, bool retry = true) const;
 			int ReceiveBulkTransfer(unsigned char *data, int length, int timeout, bool retry = true) const;
 
@@ -148,6 +244,14 @@ namespace Heimdall
 			BridgeManager(bool verbose);
 			~BridgeManager();
 
+			static bool IsSupportedDevice(int vendorId, int productId);
+
+			// Lists every supported device that's connected, without opening any of them. Returns false if libusb fails.
+			static bool EnumerateDevices(std::vector<DeviceLocation>& devices);
+
+			// Must be called before Initialise(). By default the first supported device found is used.
+			void SetDeviceLocation(int busNumber, int deviceAddress);
+
 			bool DetectDevice(void);
 			int Initialise(bool resume);
 
@@ -155,18 +259,70 @@ namespace Heimdall
 			bool EndSession(bool reboot) const;
 
 			bool SendPacket(OutboundPacket *packet, int timeout = kDefaultTimeoutSend, int emptyTransferFlags = kEmptyTransferAfter) const;
-			bool ReceivePacket(InboundPacket *packet, int timeout = kDefaultTimeoutReceive, int emptyTransferFlags = kEmptyTransferNone) const;
+			bool ReceivePacket(InboundPacket *packet, int timeout = kDefaultTimeoutReceive, int emptyTransferFlags = kEmptyTransferNone,
+				bool retry = true) const;
 
 			bool RequestDeviceType(unsigned int request, int *result) const;
 
 			bool SendPitData(const libpit::PitData *pitData) const;
-			int ReceivePitFile(unsigned char **pitBuffer) const;
-			int DownloadPitFile(unsigned char **pitBuffer) const; // Thin wrapper around ReceivePitFile() with additional logging.
+			// When a cache is provided, a cached PIT is used if the device's PIT file size and first part match it. If the device
+			// doesn't confirm ending the transfer there, the PIT file is downloaded in full.
+			int ReceivePitFile(unsigned char **pitBuffer, const PitCache *pitCache = nullptr) const;
+			int DownloadPitFile(unsigned char **pitBuffer, const PitCache *pitCache = nullptr) const; // Thin wrapper around ReceivePitFile() with additional logging.
 
 			bool SendFile(FILE *file, unsigned int destination, unsigned int deviceType, unsigned int fileIdentifier = 0xFFFFFFFF) const;
 
+			// Sends a file from memory, which may be shared by concurrent sessions as it's only ever read.
+			bool SendFile(const unsigned char *fileData, unsigned int fileSize, unsigned int destination, unsigned int deviceType,
+				unsigned int fileIdentifier = 0xFFFFFFFF) const;
+
 			void SetUsbLogLevel(UsbLogLevel usbLogLevel);
 
+			// Must be called before BeginSession(). A profile matching the device replaces the default transfer parameters.
+			void SetTransferProfiles(const TransferProfiles *transferProfiles);
+
+			// Makes each file transfer wait for bandwidth on the hubs between the device and the host, which are shared with other
+			// sessions using the same scheduler. Passing nullptr (the default) sends files without waiting.
+			void SetTransferScheduler(TransferScheduler *transferScheduler);
+
+			// Changes the transfer parameters during a session. Fails if the device doesn't support changing the file part size.
+			bool SetFileTransferParameters(unsigned int filePartSize, unsigned int sequenceMaxLength);
+
+			unsigned int GetFileTransferPacketSize(void) const
+			{
+				return (fileTransferPacketSize);
+			}
+
+			unsigned int GetFileTransferSequenceMaxLength(void) const
+			{
+				return (fileTransferSequenceMaxLength);
+			}
+
+			bool IsFilePartSizeSupported(void) const
+			{
+				return (filePartSizeSupported);
+			}
+
+			// Must be called before Initialise() for Abort() to interrupt a receive in progress. Receives are then waited for in
+			// slices of kAbortPollInterval, otherwise each is a single transfer with the caller's timeout.
+			void EnableAbort(void);
+
+			// May be called from any thread, e.g. by a watchdog. No more transfers are attempted, so the session can only be
+			// abandoned. Unless EnableAbort() was called, a transfer in progress still runs until it times out.
+			void Abort(void);
+
+			bool IsAborted(void) const
+			{
+				return (aborted);
+			}
+
+			// May be called from any thread.
+			TransferDiagnostics GetTransferDiagnostics(void) const;
+			UsbStatistics GetUsbStatistics(void) const;
+
+			// Identifies the device's model and bootloader, valid once initialised.
+			std::string GetTransferProfileKey(void) const;
+
 			UsbLogLevel GetUsbLogLevel(void) const
 			{
 				return usbLogLevel;
@@ -176,6 +332,12 @@ namespace Heimdall
 			{
 				return (verbose);
 			}
+
+			// Empty if the device doesn't report a serial number.
+			const std::string& GetSerialNumber(void) const
+			{
+				return (serialNumber);
+			}
 	};
 }
 
@@ -0,0 +1,149 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C Standard Library
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+// Heimdall
+#include "Arguments.h"
+#include "CacheImageAction.h"
+#include "Heimdall.h"
+#include "ImageCache.h"
+#include "Interface.h"
+
+using namespace std;
+using namespace Heimdall;
+
+const char *CacheImageAction::usage = "Action: cache-image\n\
+Arguments: --image-cache <directory> --key <key> [--file <filename>]\n\
+    [--max-size <MiB>] [--stdout-errors]\n\
+Description: Stores an extracted firmware image in an image cache, keyed by a\n\
+    hash of the package member or compressed file it was extracted from e.g.\n\
+    the output of sha256sum. If a file isn't specified, prints the cached\n\
+    image's filename, or fails if the image isn't cached.\n\
+Note: --file - reads the image from stdin, so that it can be decompressed\n\
+      straight into the cache.\n\
+Note: Once the cache exceeds --max-size MiB (default 16384) the least recently\n\
+      used images are removed.\n\
+Note: The flash action's partition arguments accept cache:<key> in place of a\n\
+      filename, when --image-cache is specified.\n";
+
+int CacheImageAction::Execute(int argc, char **argv)
+{
+	// Handle arguments
+
+	map<string, ArgumentType> argumentTypes;
+	argumentTypes["image-cache"] = kArgumentTypeString;
+	argumentTypes["key"] = kArgumentTypeString;
+	argumentTypes["file"] = kArgumentTypeString;
+	argumentTypes["max-size"] = kArgumentTypeUnsignedInteger;
+	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+
+	Arguments arguments(argumentTypes);
+
+	if (!arguments.ParseArguments(argc, argv, 2))
+	{
+		Interface::Print(CacheImageAction::usage);
+		return (0);
+	}
+
+	const StringArgument *imageCacheArgument = static_cast<const StringArgument *>(arguments.GetArgument("image-cache"));
+	const StringArgument *keyArgument = static_cast<const StringArgument *>(arguments.GetArgument("key"));
+	const StringArgument *fileArgument = static_cast<const StringArgument *>(arguments.GetArgument("file"));
+	const UnsignedIntegerArgument *maxSizeArgument = static_cast<const UnsignedIntegerArgument *>(arguments.GetArgument("max-size"));
+
+	if (!imageCacheArgument || !keyArgument)
+	{
+		Interface::Print("Both an image cache directory and a key must be specified.\n\n");
+		Interface::Print(CacheImageAction::usage);
+		return (0);
+	}
+
+	if (arguments.GetArgument("stdout-errors") != nullptr)
+		Interface::SetStdoutErrors(true);
+
+	const string& key = keyArgument->GetValue();
+
+	if (!ImageCache::IsValidKey(key))
+	{
+		Interface::Print("Keys must be hexadecimal digests: %s\n\n", key.c_str());
+		Interface::Print(CacheImageAction::usage);
+		return (0);
+	}
+
+	unsigned long long maxSize = maxSizeArgument ? (unsigned long long)maxSizeArgument->GetValue() * 1024 * 1024 : ImageCache::kDefaultMaxSize;
+	ImageCache imageCache(imageCacheArgument->GetValue(), maxSize);
+
+	if (!imageCache.Initialise())
+	{
+		Interface::PrintError("Failed to create image cache directory \"%s\"\n", imageCacheArgument->GetValue().c_str());
+		return (1);
+	}
+
+	if (!fileArgument)
+	{
+		string filename = imageCache.Find(key);
+
+		if (filename.empty())
+			return (1);
+
+		Interface::Print("%s\n", filename.c_str());
+		return (0);
+	}
+
+	const string& filename = fileArgument->GetValue();
+	FILE *file;
+
+	if (filename.compare("-") == 0)
+	{
+#ifdef _WIN32
+		_setmode(_fileno(stdin), _O_BINARY);
+#endif
+		file = stdin;
+	}
+	else
+	{
+		file = FileOpen(filename.c_str(), "rb");
+
+		if (!file)
+		{
+			Interface::PrintError("Failed to open file \"%s\"\n", filename.c_str());
+			return (1);
+		}
+	}
+
+	bool stored = imageCache.Store(key, file);
+
+	if (file != stdin)
+		FileClose(file);
+
+	if (!stored)
+	{
+		Interface::PrintError("Failed to store image \"%s\" in the image cache\n", filename.c_str());
+		return (1);
+	}
+
+	return (0);
+}
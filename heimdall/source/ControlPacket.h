@@ -21,6 +21,9 @@
 #ifndef CONTROLPACKET_H
 #define CONTROLPACKET_H
 
+// C++ Standard Library
+#include <array>
+
 // Heimdall
 #include "OutboundPacket.h"
 
@@ -42,17 +45,23 @@ namespace Heimdall
 
 			enum
 			{
-				kDataSize = 4
+				kPacketSize = 1024
 			};
 
+			typedef PacketField<kPacketSize, 0> ControlTypeField;
+
 		private:
 
+			std::array<unsigned char, kPacketSize> storage;
+
 			unsigned int controlType;
 
 		public:
 
-			ControlPacket(unsigned int controlType) : OutboundPacket(1024)
+			ControlPacket(unsigned int controlType) : OutboundPacket(kPacketSize), storage()
 			{
+				data = storage.data();
+
 				this->controlType = controlType;
 			}
 
@@ -63,7 +72,7 @@ namespace Heimdall
 
 			virtual void Pack(void)
 			{
-				PackInteger(0, controlType);
+				PackField<ControlTypeField>(controlType);
 			}
 	};
 }
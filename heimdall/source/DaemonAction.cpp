@@ -0,0 +1,399 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Heimdall
+#include "Arguments.h"
+#include "BatchSession.h"
+#include "BridgeManager.h"
+#include "DaemonAction.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "PitCache.h"
+#include "TransferProfiles.h"
+
+using namespace std;
+using namespace Heimdall;
+
+const char *DaemonAction::usage = "Action: daemon\n\
+Arguments: --socket <filename> [--verbose] [--resume]\n\
+    [--usb-log-level <none/error/warning/debug>] [--pit-cache <directory>]\n\
+    [--transfer-profiles <filename>]\n\
+Description: Begins a session and keeps it open, performing commands received\n\
+    over a Unix domain socket. Clients connect one at a time and send one\n\
+    command per line, using the same actions and arguments as the batch\n\
+    action, plus end-session. Output is streamed back to the client and\n\
+    each command is completed by a line containing \"#done 0\" on success, or\n\
+    \"#done 1\" on failure.\n\
+Note: reboot and end-session end the session, rebooting the device or leaving\n\
+      it in download mode respectively, and stop the daemon. If the daemon is\n\
+      interrupted the session is ended without rebooting.\n\
+Note: --transfer-profiles applies the file transfer parameters measured by the\n\
+      tune action, if the file contains a profile for the device.\n\
+Note: The daemon action is not available on Windows.\n";
+
+#ifndef _WIN32
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handleInterrupt(int)
+{
+	interrupted = 1;
+}
+
+static int createSocket(const char *socketFilename)
+{
+	struct sockaddr_un address;
+
+	if (strlen(socketFilename) >= sizeof(address.sun_path))
+	{
+		Interface::PrintError("Socket filename \"%s\" is too long.\n", socketFilename);
+		return (-1);
+	}
+
+	// Replace a stale socket from a previous daemon, but never anything else.
+	struct stat socketStatus;
+
+	if (lstat(socketFilename, &socketStatus) == 0)
+	{
+		if (!S_ISSOCK(socketStatus.st_mode))
+		{
+			Interface::PrintError("\"%s\" already exists and isn't a socket.\n", socketFilename);
+			return (-1);
+		}
+
+		unlink(socketFilename);
+	}
+
+	int listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (listenSocket < 0)
+	{
+		Interface::PrintError("Failed to create socket!\n");
+		return (-1);
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socketFilename);
+
+	// Only the user running the daemon may control the device.
+	mode_t previousMask = umask(0077);
+	int result = bind(listenSocket, (struct sockaddr *)&address, sizeof(address));
+	umask(previousMask);
+
+	if (result != 0 || listen(listenSocket, 4) != 0)
+	{
+		Interface::PrintError("Failed to listen on socket \"%s\"\n", socketFilename);
+		close(listenSocket);
+		return (-1);
+	}
+
+	return (listenSocket);
+}
+
+// Returns false once the session has been ended by the client.
+static bool serveClient(int clientSocket, BatchSession *batchSession, BridgeManager *bridgeManager, bool& success)
+{
+	FILE *clientInput = fdopen(clientSocket, "r");
+	FILE *clientOutput = fdopen(dup(clientSocket), "w");
+
+	if (!clientInput || !clientOutput)
+	{
+		if (clientInput)
+			fclose(clientInput);
+		else
+			close(clientSocket);
+
+		if (clientOutput)
+			fclose(clientOutput);
+
+		return (true);
+	}
+
+	bool sessionOpen = true;
+	char buffer[1024];
+	string line;
+	vector<string> words;
+
+	while (sessionOpen && !interrupted && fgets(buffer, sizeof(buffer), clientInput))
+	{
+		line += buffer;
+
+		if (line.empty() || line[line.size() - 1] != '\n')
+		{
+			if (!feof(clientInput))
+				continue;
+		}
+
+		while (!line.empty() && (line[line.size() - 1] == '\n' || line[line.size() - 1] == '\r'))
+			line.erase(line.size() - 1);
+
+		Interface::SetOutputFiles(clientOutput, clientOutput);
+
+		bool commandSucceeded = false;
+
+		if (!BatchSession::SplitCommand(line, words))
+		{
+			// SplitCommand() has already reported the problem.
+		}
+		else if (words.empty() || words[0][0] == '#')
+		{
+			line.clear();
+			Interface::SetOutputFiles(nullptr, nullptr);
+			continue;
+		}
+		else if (words[0] == "end-session" || words[0] == "reboot")
+		{
+			if (words.size() == 1)
+			{
+				commandSucceeded = bridgeManager->EndSession(words[0] == "reboot");
+				success = commandSucceeded;
+				sessionOpen = false;
+			}
+			else
+			{
+				Interface::PrintError("%s doesn't accept any arguments.\n", words[0].c_str());
+			}
+		}
+		else
+		{
+			Arguments *arguments = BatchSession::ParseCommand(words);
+
+			if (arguments)
+			{
+				commandSucceeded = batchSession->ExecuteCommand(words[0], *arguments);
+				delete arguments;
+			}
+		}
+
+		Interface::SetOutputFiles(nullptr, nullptr);
+
+		// Start on a new line, in case the command's output didn't end with one.
+		fprintf(clientOutput, "\n#done %d\n", commandSucceeded ? 0 : 1);
+		fflush(clientOutput);
+
+		line.clear();
+	}
+
+	fclose(clientInput);
+	fclose(clientOutput);
+
+	return (sessionOpen);
+}
+
+#endif
+
+int DaemonAction::Execute(int argc, char **argv)
+{
+	// Handle arguments
+
+	map<string, ArgumentType> argumentTypes;
+	argumentTypes["socket"] = kArgumentTypeString;
+	argumentTypes["resume"] = kArgumentTypeFlag;
+	argumentTypes["verbose"] = kArgumentTypeFlag;
+	argumentTypes["usb-log-level"] = kArgumentTypeString;
+	argumentTypes["pit-cache"] = kArgumentTypeString;
+	argumentTypes["transfer-profiles"] = kArgumentTypeString;
+
+	Arguments arguments(argumentTypes);
+
+	if (!arguments.ParseArguments(argc, argv, 2))
+	{
+		Interface::Print(DaemonAction::usage);
+		return (0);
+	}
+
+	const StringArgument *socketArgument = static_cast<const StringArgument *>(arguments.GetArgument("socket"));
+
+	if (!socketArgument)
+	{
+		Interface::Print("Socket filename was not specified.\n\n");
+		Interface::Print(DaemonAction::usage);
+		return (0);
+	}
+
+#ifdef _WIN32
+
+	Interface::PrintError("The daemon action is not available on Windows.\n");
+	return (1);
+
+#else
+
+	bool resume = arguments.GetArgument("resume") != nullptr;
+	bool verbose = arguments.GetArgument("verbose") != nullptr;
+
+	const StringArgument *usbLogLevelArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-log-level"));
+
+	BridgeManager::UsbLogLevel usbLogLevel = BridgeManager::UsbLogLevel::Default;
+
+	if (usbLogLevelArgument)
+	{
+		const string& usbLogLevelString = usbLogLevelArgument->GetValue();
+
+		if (usbLogLevelString.compare("none") == 0 || usbLogLevelString.compare("NONE") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::None;
+		}
+		else if (usbLogLevelString.compare("error") == 0 || usbLogLevelString.compare("ERROR") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Error;
+		}
+		else if (usbLogLevelString.compare("warning") == 0 || usbLogLevelString.compare("WARNING") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Warning;
+		}
+		else if (usbLogLevelString.compare("info") == 0 || usbLogLevelString.compare("INFO") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Info;
+		}
+		else if (usbLogLevelString.compare("debug") == 0 || usbLogLevelString.compare("DEBUG") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Debug;
+		}
+		else
+		{
+			Interface::Print("Unknown USB log level: %s\n\n", usbLogLevelString.c_str());
+			Interface::Print(DaemonAction::usage);
+			return (0);
+		}
+	}
+
+	const StringArgument *pitCacheArgument = static_cast<const StringArgument *>(arguments.GetArgument("pit-cache"));
+	PitCache *pitCache = nullptr;
+
+	if (pitCacheArgument)
+	{
+		pitCache = new PitCache(pitCacheArgument->GetValue());
+
+		if (!pitCache->Initialise())
+		{
+			Interface::PrintError("Failed to create PIT cache directory \"%s\"\n", pitCacheArgument->GetValue().c_str());
+			delete pitCache;
+			return (1);
+		}
+	}
+
+	const StringArgument *transferProfilesArgument = static_cast<const StringArgument *>(arguments.GetArgument("transfer-profiles"));
+	TransferProfiles transferProfiles((transferProfilesArgument) ? transferProfilesArgument->GetValue() : "");
+
+	if (transferProfilesArgument && !transferProfiles.Load())
+	{
+		delete pitCache;
+		return (1);
+	}
+
+	const char *socketFilename = socketArgument->GetValue().c_str();
+	int listenSocket = createSocket(socketFilename);
+
+	if (listenSocket < 0)
+	{
+		delete pitCache;
+		return (1);
+	}
+
+	// A client disconnecting mid-command mustn't take the daemon (and the session) down with it.
+	signal(SIGPIPE, SIG_IGN);
+
+	// Without SA_RESTART, so that accept() returns when we're interrupted.
+	struct sigaction interruptAction;
+	memset(&interruptAction, 0, sizeof(interruptAction));
+	interruptAction.sa_handler = handleInterrupt;
+	sigemptyset(&interruptAction.sa_mask);
+
+	sigaction(SIGINT, &interruptAction, nullptr);
+	sigaction(SIGTERM, &interruptAction, nullptr);
+
+	Interface::PrintReleaseInfo();
+	Sleep(1000);
+
+	BridgeManager *bridgeManager = new BridgeManager(verbose);
+	bridgeManager->SetUsbLogLevel(usbLogLevel);
+	bridgeManager->SetTransferProfiles((transferProfilesArgument) ? &transferProfiles : nullptr);
+
+	if (bridgeManager->Initialise(resume) != BridgeManager::kInitialiseSucceeded || !bridgeManager->BeginSession())
+	{
+		close(listenSocket);
+		unlink(socketFilename);
+
+		delete bridgeManager;
+		delete pitCache;
+
+		return (1);
+	}
+
+	BatchSession *batchSession = new BatchSession(bridgeManager, pitCache);
+
+	Interface::Print("Listening on \"%s\"\n", socketFilename);
+
+	bool sessionOpen = true;
+	bool success = true;
+
+	while (sessionOpen && !interrupted)
+	{
+		int clientSocket = accept(listenSocket, nullptr, nullptr);
+
+		if (clientSocket < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+
+			Interface::PrintError("Failed to accept connection!\n");
+			success = false;
+			break;
+		}
+
+		sessionOpen = serveClient(clientSocket, batchSession, bridgeManager, success);
+	}
+
+	delete batchSession;
+
+	if (sessionOpen)
+	{
+		Interface::Print("Ending session...\n");
+
+		if (!bridgeManager->EndSession(false))
+			success = false;
+	}
+
+	close(listenSocket);
+	unlink(socketFilename);
+
+	delete bridgeManager;
+	delete pitCache;
+
+	return (success ? 0 : 1);
+
+#endif
+}
@@ -0,0 +1,238 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C Standard Library
+#include <stdio.h>
+
+// Heimdall
+#include "Arguments.h"
+#include "BridgeManager.h"
+#include "DiffPitAction.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "PitCache.h"
+
+using namespace std;
+using namespace libpit;
+using namespace Heimdall;
+
+const char *DiffPitAction::usage = "Action: diff-pit\n\
+Arguments: --file <filename> [--other-file <filename>] [--verbose]\n\
+    [--no-reboot] [--resume] [--stdout-errors]\n\
+    [--usb-log-level <none/error/warning/debug>] [--pit-cache <directory>]\n\
+Description: Compares two PIT files and prints every entry that was added,\n\
+    removed or changed, field by field. Entries are matched by identifier, or\n\
+    failing that by partition name. If an other filename is not provided then\n\
+    Heimdall compares the PIT file with the one retrieved from the connected\n\
+    device. Exits with status 2 if the PIT files differ, or 1 on failure.\n\
+Note: --no-reboot causes the device to remain in download mode after the action\n\
+      is completed. If you wish to perform another action whilst remaining in\n\
+      download mode, then the following action must specify the --resume flag.\n\
+Note: --pit-cache reuses the device's PIT file from the specified directory,\n\
+      rather than downloading all of it, when the PIT file's size and first\n\
+      part are unchanged. Devices are identified by their USB serial number.\n";
+
+enum
+{
+	kExitDifferent = 2 // Distinct from failure, so scripts can use diff-pit as a check.
+};
+
+static bool loadPitFile(const char *filename, PitData *pitData)
+{
+	PitFileMapping pitFileMapping;
+
+	if (!pitFileMapping.Open(filename))
+	{
+		Interface::PrintError("Failed to open file \"%s\"\n", filename);
+		return (false);
+	}
+
+	if (!pitData->Unpack(pitFileMapping.GetData(), pitFileMapping.GetSize()))
+	{
+		Interface::PrintError("Failed to unpack PIT file \"%s\"\n", filename);
+		return (false);
+	}
+
+	return (true);
+}
+
+int DiffPitAction::Execute(int argc, char **argv)
+{
+	// Handle arguments
+
+	map<string, ArgumentType> argumentTypes;
+	argumentTypes["file"] = kArgumentTypeString;
+	argumentTypes["other-file"] = kArgumentTypeString;
+	argumentTypes["no-reboot"] = kArgumentTypeFlag;
+	argumentTypes["resume"] = kArgumentTypeFlag;
+	argumentTypes["verbose"] = kArgumentTypeFlag;
+	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+	argumentTypes["usb-log-level"] = kArgumentTypeString;
+	argumentTypes["pit-cache"] = kArgumentTypeString;
+
+	Arguments arguments(argumentTypes);
+
+	if (!arguments.ParseArguments(argc, argv, 2))
+	{
+		Interface::Print(DiffPitAction::usage);
+		return (0);
+	}
+
+	const StringArgument *fileArgument = static_cast<const StringArgument *>(arguments.GetArgument("file"));
+	const StringArgument *otherFileArgument = static_cast<const StringArgument *>(arguments.GetArgument("other-file"));
+
+	if (!fileArgument)
+	{
+		Interface::Print("PIT file was not specified.\n\n");
+		Interface::Print(DiffPitAction::usage);
+		return (0);
+	}
+
+	bool reboot = arguments.GetArgument("no-reboot") == nullptr;
+	bool resume = arguments.GetArgument("resume") != nullptr;
+	bool verbose = arguments.GetArgument("verbose") != nullptr;
+	
+	if (arguments.GetArgument("stdout-errors") != nullptr)
+		Interface::SetStdoutErrors(true);
+
+	const StringArgument *usbLogLevelArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-log-level"));
+
+	BridgeManager::UsbLogLevel usbLogLevel = BridgeManager::UsbLogLevel::Default;
+
+	if (usbLogLevelArgument)
+	{
+		const string& usbLogLevelString = usbLogLevelArgument->GetValue();
+
+		if (usbLogLevelString.compare("none") == 0 || usbLogLevelString.compare("NONE") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::None;
+		}
+		else if (usbLogLevelString.compare("error") == 0 || usbLogLevelString.compare("ERROR") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Error;
+		}
+		else if (usbLogLevelString.compare("warning") == 0 || usbLogLevelString.compare("WARNING") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Warning;
+		}
+		else if (usbLogLevelString.compare("info") == 0 || usbLogLevelString.compare("INFO") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Info;
+		}
+		else if (usbLogLevelString.compare("debug") == 0 || usbLogLevelString.compare("DEBUG") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Debug;
+		}
+		else
+		{
+			Interface::Print("Unknown USB log level: %s\n\n", usbLogLevelString.c_str());
+			Interface::Print(DiffPitAction::usage);
+			return (0);
+		}
+	}
+
+	// Load the PIT file.
+
+	PitData pitData;
+
+	if (!loadPitFile(fileArgument->GetValue().c_str(), &pitData))
+		return (1);
+
+	// Info
+
+	Interface::PrintReleaseInfo();
+	Sleep(1000);
+
+	PitData otherPitData;
+	PitDiff pitDiff;
+
+	if (otherFileArgument)
+	{
+		// Compare with another file; there's no need for a BridgeManager.
+
+		if (!loadPitFile(otherFileArgument->GetValue().c_str(), &otherPitData))
+			return (1);
+
+		pitDiff.Compare(&pitData, &otherPitData);
+		Interface::PrintPitDiff(&pitDiff, &pitData, &otherPitData, fileArgument->GetValue().c_str(), otherFileArgument->GetValue().c_str());
+
+		return (pitDiff.IsEmpty() ? 0 : (int)kExitDifferent);
+	}
+	else
+	{
+		// Compare with the device's PIT.
+
+		const StringArgument *pitCacheArgument = static_cast<const StringArgument *>(arguments.GetArgument("pit-cache"));
+		PitCache *pitCache = nullptr;
+
+		if (pitCacheArgument)
+		{
+			pitCache = new PitCache(pitCacheArgument->GetValue());
+
+			if (!pitCache->Initialise())
+			{
+				Interface::PrintError("Failed to create PIT cache directory \"%s\"\n", pitCacheArgument->GetValue().c_str());
+				delete pitCache;
+				return (1);
+			}
+		}
+
+		BridgeManager *bridgeManager = new BridgeManager(verbose);
+		bridgeManager->SetUsbLogLevel(usbLogLevel);
+
+		if (bridgeManager->Initialise(resume) != BridgeManager::kInitialiseSucceeded || !bridgeManager->BeginSession())
+		{
+			delete bridgeManager;
+			delete pitCache;
+			return (1);
+		}
+
+		unsigned char *devicePit;
+		int devicePitSize = bridgeManager->DownloadPitFile(&devicePit, pitCache);
+		bool success = devicePitSize != 0;
+
+		if (success)
+		{
+			if (otherPitData.Unpack(devicePit, devicePitSize))
+			{
+				pitDiff.Compare(&pitData, &otherPitData);
+				Interface::PrintPitDiff(&pitDiff, &pitData, &otherPitData, fileArgument->GetValue().c_str(), "device");
+			}
+			else
+			{
+				Interface::PrintError("Failed to unpack device's PIT file!\n");
+				success = false;
+			}
+		}
+
+		delete [] devicePit;
+
+		if (!bridgeManager->EndSession(reboot))
+			success = false;
+
+		delete bridgeManager;
+		delete pitCache;
+
+		if (!success)
+			return (1);
+
+		return (pitDiff.IsEmpty() ? 0 : (int)kExitDifferent);
+	}
+}
@@ -27,18 +27,27 @@
 #include "DownloadPitAction.h"
 #include "Heimdall.h"
 #include "Interface.h"
+#include "PitCache.h"
+#include "Progress.h"
 
 using namespace std;
 using namespace Heimdall;
 
 const char *DownloadPitAction::usage = "Action: download-pit\n\
 Arguments: --output <filename> [--verbose] [--no-reboot] [--stdout-errors]\n\
-    [--usb-log-level <none/error/warning/debug>]\n\
+    [--usb-log-level <none/error/warning/debug>] [--pit-cache <directory>]\n\
+    [--progress <text/json>] [--progress-interval <milliseconds>]\n\
 Description: Downloads the connected device's PIT file to the specified\n\
     output file.\n\
 Note: --no-reboot causes the device to remain in download mode after the action\n\
       is completed. If you wish to perform another action whilst remaining in\n\
-      download mode, then the following action must specify the --resume flag.\n";
+      download mode, then the following action must specify the --resume flag.\n\
+Note: --pit-cache reuses the device's PIT file from the specified directory,\n\
+      rather than downloading all of it, when the PIT file's size and first\n\
+      part are unchanged. Devices are identified by their USB serial number.\n\
+Note: --progress json reports progress as JSON lines on stdout, at most once\n\
+      per --progress-interval milliseconds (default 250). All other output is\n\
+      written to stderr.\n";
 
 int DownloadPitAction::Execute(int argc, char **argv)
 {
@@ -51,6 +60,9 @@ int DownloadPitAction::Execute(int argc, char **argv)
 	argumentTypes["verbose"] = kArgumentTypeFlag;
 	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
 	argumentTypes["usb-log-level"] = kArgumentTypeString;
+	argumentTypes["pit-cache"] = kArgumentTypeString;
+
+	Progress::AddArgumentTypes(argumentTypes);
 
 	Arguments arguments(argumentTypes);
 
@@ -76,6 +88,12 @@ int DownloadPitAction::Execute(int argc, char **argv)
 	if (arguments.GetArgument("stdout-errors") != nullptr)
 		Interface::SetStdoutErrors(true);
 
+	if (!Progress::ApplyArguments(arguments))
+	{
+		Interface::Print(DownloadPitAction::usage);
+		return (0);
+	}
+
 	const StringArgument *usbLogLevelArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-log-level"));
 
 	BridgeManager::UsbLogLevel usbLogLevel = BridgeManager::UsbLogLevel::Default;
@@ -112,6 +130,21 @@ int DownloadPitAction::Execute(int argc, char **argv)
 		}
 	}
 
+	const StringArgument *pitCacheArgument = static_cast<const StringArgument *>(arguments.GetArgument("pit-cache"));
+	PitCache *pitCache = nullptr;
+
+	if (pitCacheArgument)
+	{
+		pitCache = new PitCache(pitCacheArgument->GetValue());
+
+		if (!pitCache->Initialise())
+		{
+			Interface::PrintError("Failed to create PIT cache directory \"%s\"\n", pitCacheArgument->GetValue().c_str());
+			delete pitCache;
+			return (1);
+		}
+	}
+
 	// Info
 
 	Interface::PrintReleaseInfo();
@@ -125,6 +158,7 @@ int DownloadPitAction::Execute(int argc, char **argv)
 	if (!outputPitFile)
 	{
 		Interface::PrintError("Failed to open output file \"%s\"\n", outputFilename);
+		delete pitCache;
 		return (1);
 	}
 
@@ -137,18 +171,19 @@ int DownloadPitAction::Execute(int argc, char **argv)
 	{
 		FileClose(outputPitFile);
 		delete bridgeManager;
+		delete pitCache;
 
 		return (1);
 	}
 
 	unsigned char *pitBuffer;
-	int fileSize = bridgeManager->DownloadPitFile(&pitBuffer);
+	int fileSize = bridgeManager->DownloadPitFile(&pitBuffer, pitCache);
 
 	bool success = true;
 
 	if (fileSize > 0)
 	{
-		if (fwrite(pitBuffer, 1, fileSize, outputPitFile) != fileSize)
+		if (fwrite(pitBuffer, 1, fileSize, outputPitFile) != (size_t)fileSize)
 		{
 			Interface::PrintError("Failed to write PIT data to output file.\n");
 			success = false;
@@ -163,6 +198,7 @@ int DownloadPitAction::Execute(int argc, char **argv)
 		success = false;
 
 	delete bridgeManager;
+	delete pitCache;
 	
 	FileClose(outputPitFile);
 	delete [] pitBuffer;
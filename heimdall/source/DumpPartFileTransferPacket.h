@@ -30,6 +30,8 @@ namespace Heimdall
 	{
 		private:
 
+			typedef NextPacketField<FileTransferPacket::RequestField> PartIndexField;
+
 			unsigned int partIndex;
 
 		public:
@@ -48,7 +50,7 @@ namespace Heimdall
 			{
 				FileTransferPacket::Pack();
 
-				PackInteger(FileTransferPacket::kDataSize, partIndex);
+				PackField<PartIndexField>(partIndex);
 			}
 	};
 }
@@ -30,6 +30,8 @@ namespace Heimdall
 	{
 		private:
 
+			typedef NextPacketField<PitFilePacket::RequestField> PartIndexField;
+
 			unsigned int partIndex;
 
 		public:
@@ -48,7 +50,7 @@ namespace Heimdall
 			{
 				PitFilePacket::Pack();
 
-				PackInteger(PitFilePacket::kDataSize, partIndex);
+				PackField<PartIndexField>(partIndex);
 			}
 	};
 }
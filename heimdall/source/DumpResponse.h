@@ -48,7 +48,7 @@ namespace Heimdall
 				if (!ResponsePacket::Unpack())
 					return (false);
 
-				dumpSize = UnpackInteger(ResponsePacket::kDataSize);
+				dumpSize = UnpackField<ValueField>();
 				
 				return (true);
 			}
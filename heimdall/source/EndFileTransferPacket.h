@@ -38,10 +38,10 @@ namespace Heimdall
 
 		protected:
 
-			enum
-			{
-				kDataSize = FileTransferPacket::kDataSize + 16
-			};
+			typedef NextPacketField<FileTransferPacket::RequestField> DestinationField;
+			typedef NextPacketField<DestinationField> SequenceByteCountField;
+			typedef NextPacketField<SequenceByteCountField> Unknown1Field;
+			typedef NextPacketField<Unknown1Field> DeviceTypeField;
 
 		private:
 
@@ -87,10 +87,10 @@ namespace Heimdall
 			{
 				FileTransferPacket::Pack();
 
-				PackInteger(FileTransferPacket::kDataSize, destination);
-				PackInteger(FileTransferPacket::kDataSize + 4, sequenceByteCount);
-				PackInteger(FileTransferPacket::kDataSize + 8, unknown1);
-				PackInteger(FileTransferPacket::kDataSize + 12, deviceType);
+				PackField<DestinationField>(destination);
+				PackField<SequenceByteCountField>(sequenceByteCount);
+				PackField<Unknown1Field>(unknown1);
+				PackField<DeviceTypeField>(deviceType);
 			}
 	};
 }
@@ -30,6 +30,8 @@ namespace Heimdall
 	{
 		private:
 
+			typedef NextPacketField<EndFileTransferPacket::DeviceTypeField> EndOfFileField;
+
 			unsigned int endOfFile;
 
 		public:
@@ -49,7 +51,7 @@ namespace Heimdall
 			{
 				EndFileTransferPacket::Pack();
 
-				PackInteger(EndFileTransferPacket::kDataSize, endOfFile);
+				PackField<EndOfFileField>(endOfFile);
 			}
 	};
 }
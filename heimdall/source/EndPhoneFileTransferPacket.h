@@ -52,6 +52,9 @@ namespace Heimdall
 
 		private:
 
+			typedef NextPacketField<EndFileTransferPacket::DeviceTypeField> FileIdentifierField;
+			typedef NextPacketField<FileIdentifierField> EndOfFileField;
+
 			unsigned int fileIdentifier;
 			unsigned int endOfFile;
 
@@ -79,8 +82,8 @@ namespace Heimdall
 			{
 				EndFileTransferPacket::Pack();
 
-				PackInteger(EndFileTransferPacket::kDataSize, fileIdentifier);
-				PackInteger(EndFileTransferPacket::kDataSize + 4, endOfFile);
+				PackField<FileIdentifierField>(fileIdentifier);
+				PackField<EndOfFileField>(endOfFile);
 			}
 	};
 }
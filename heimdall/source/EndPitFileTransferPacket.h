@@ -30,6 +30,8 @@ namespace Heimdall
 	{
 		private:
 
+			typedef NextPacketField<PitFilePacket::RequestField> FileSizeField;
+
 			unsigned int fileSize;
 
 		public:
@@ -48,7 +50,7 @@ namespace Heimdall
 			{
 				PitFilePacket::Pack();
 
-				PackInteger(PitFilePacket::kDataSize, fileSize);
+				PackField<FileSizeField>(fileSize);
 			}
 	};
 }
@@ -38,6 +38,8 @@ namespace Heimdall
 
 		private:
 
+			typedef NextPacketField<ControlPacket::ControlTypeField> RequestField;
+
 			unsigned int request;
 
 		public:
@@ -56,7 +58,7 @@ namespace Heimdall
 			{
 				ControlPacket::Pack();
 
-				PackInteger(ControlPacket::kDataSize, request);
+				PackField<RequestField>(request);
 			}
 	};
 }
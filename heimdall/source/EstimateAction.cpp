@@ -0,0 +1,173 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <ctype.h>
+#include <stdio.h>
+#include <string>
+
+// Heimdall
+#include "Arguments.h"
+#include "EstimateAction.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "ThroughputHistory.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace Heimdall;
+
+const char *EstimateAction::usage = "Action: estimate\n\
+Arguments: --history <filename> --model <vendor:product[:release]>\n\
+    [--<partition name> <filename> ...]\n\
+    [--<partition identifier> <filename> ...] [--stdout-errors]\n\
+Description: Predicts how long flashing files to a device takes, from the\n\
+    throughput history recorded by the station action. Devices are identified\n\
+    by their USB vendor ID, product ID and optionally device release (i.e.\n\
+    bootloader) in hexadecimal, as by transfer profiles e.g. 04e8:685d or\n\
+    04e8:685d:0100.\n\
+Note: Each file is estimated from the most recent transfers to the partition of\n\
+      the same name, or to any partition if there are none. Files specified by\n\
+      partition identifier are estimated from transfers to any partition. The\n\
+      time successful sessions spent connecting and ending is added once.\n";
+
+static bool getFileSize(const string& filename, unsigned long long& fileSize)
+{
+	FILE *file = FileOpen(filename.c_str(), "rb");
+
+	if (!file)
+		return (false);
+
+	bool success = FileSeek(file, 0, SEEK_END) == 0;
+
+	if (success)
+		fileSize = FileTell(file);
+
+	FileClose(file);
+
+	return (success);
+}
+
+int EstimateAction::Execute(int argc, char **argv)
+{
+	// Handle arguments
+
+	map<string, ArgumentType> argumentTypes;
+	map<string, string> shortArgumentAliases;
+
+	argumentTypes["history"] = kArgumentTypeString;
+	argumentTypes["model"] = kArgumentTypeString;
+	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+
+	// Partitions are specified as they are to the flash action.
+	argumentTypes["%d"] = kArgumentTypeString;
+	shortArgumentAliases["%d"] = "%d";
+
+	argumentTypes["%s"] = kArgumentTypeString;
+	shortArgumentAliases["%s"] = "%s";
+
+	Arguments arguments(argumentTypes, shortArgumentAliases);
+
+	if (!arguments.ParseArguments(argc, argv, 2))
+	{
+		Interface::Print(EstimateAction::usage);
+		return (0);
+	}
+
+	const StringArgument *historyArgument = static_cast<const StringArgument *>(arguments.GetArgument("history"));
+	const StringArgument *modelArgument = static_cast<const StringArgument *>(arguments.GetArgument("model"));
+
+	if (!historyArgument || !modelArgument)
+	{
+		Interface::Print("Both a throughput history and a model must be specified.\n\n");
+		Interface::Print(EstimateAction::usage);
+		return (0);
+	}
+
+	if (arguments.GetArgument("stdout-errors") != nullptr)
+		Interface::SetStdoutErrors(true);
+
+	string model = modelArgument->GetValue();
+
+	for (string::iterator it = model.begin(); it != model.end(); it++)
+		*it = tolower((unsigned char)*it);
+
+	ThroughputHistory throughputHistory(historyArgument->GetValue());
+
+	if (!throughputHistory.Load())
+		return (1);
+
+	double overheadSeconds = 0.0;
+	unsigned int sessionCount = throughputHistory.GetOverheadSeconds(model, overheadSeconds);
+
+	if (sessionCount == 0)
+	{
+		Interface::PrintError("There are no successful sessions of model %s in the throughput history.\n", model.c_str());
+		return (1);
+	}
+
+	Interface::Print("%-24s %12s %10s %14s %10s\n", "Partition", "Size (MiB)", "Time (s)", "Rate (MiB/s)", "Samples");
+
+	double totalSeconds = overheadSeconds;
+	unsigned int fileCount = 0;
+
+	for (vector<const Argument *>::const_iterator it = arguments.GetArguments().begin(); it != arguments.GetArguments().end(); it++)
+	{
+		const string& argumentName = (*it)->GetName();
+
+		// As for the flash action, only wild-cards (i.e. partitions) are missing from the argument types.
+		if (arguments.GetArgumentTypes().find(argumentName) != arguments.GetArgumentTypes().end())
+			continue;
+
+		const string& filename = static_cast<const StringArgument *>(*it)->GetValue();
+		unsigned long long fileSize;
+
+		if (!getFileSize(filename, fileSize))
+		{
+			Interface::PrintError("Failed to open file \"%s\"\n", filename.c_str());
+			return (1);
+		}
+
+		// Identifiers can't be matched to the partition names in the history.
+		unsigned int partitionIdentifier;
+		bool isIdentifier = Utility::ParseUnsignedInt(partitionIdentifier, argumentName.c_str()) == kNumberParsingStatusSuccess;
+
+		double bytesPerSecond;
+		unsigned int sampleCount = throughputHistory.GetBytesPerSecond(model, (isIdentifier) ? "" : argumentName, bytesPerSecond);
+
+		if (sampleCount == 0 || bytesPerSecond <= 0.0)
+		{
+			Interface::PrintError("There are no transfers by model %s in the throughput history.\n", model.c_str());
+			return (1);
+		}
+
+		double seconds = fileSize / bytesPerSecond;
+		totalSeconds += seconds;
+		fileCount++;
+
+		Interface::Print("%-24s %12.1f %10.1f %14.2f %10u\n", argumentName.c_str(), fileSize / 1048576.0, seconds,
+			bytesPerSecond / 1048576.0, sampleCount);
+	}
+
+	Interface::Print("%-24s %12s %10.1f %14s %10u\n", "(session)", "", overheadSeconds, "", sessionCount);
+	Interface::Print("\nEstimated time to flash %u files: %.0f seconds\n", fileCount, totalSeconds);
+
+	return (0);
+}
@@ -30,6 +30,8 @@ namespace Heimdall
 	{
 		private:
 
+			typedef NextPacketField<SessionSetupPacket::RequestField> FilePartSizeField;
+
 			unsigned int filePartSize;
 
 		public:
@@ -48,7 +50,7 @@ namespace Heimdall
 			{
 				SessionSetupPacket::Pack();
 
-				PackInteger(SessionSetupPacket::kDataSize, filePartSize);
+				PackField<FilePartSizeField>(filePartSize);
 			}
 	};
 }
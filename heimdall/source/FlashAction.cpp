@@ -20,6 +20,7 @@
 
 // C Standard Library
 #include <stdio.h>
+#include <string.h>
 
 // Heimdall
 #include "Arguments.h"
@@ -29,9 +30,14 @@
 #include "EndPhoneFileTransferPacket.h"
 #include "FlashAction.h"
 #include "Heimdall.h"
+#include "ImageCache.h"
+#include "ImageStore.h"
 #include "Interface.h"
+#include "PitCache.h"
+#include "Progress.h"
 #include "SessionSetupResponse.h"
 #include "TotalBytesPacket.h"
+#include "TransferProfiles.h"
 #include "Utility.h"
 
 using namespace std;
@@ -43,46 +49,51 @@ Arguments:\n\
     [--<partition name> <filename> ...]\n\
     [--<partition identifier> <filename> ...]\n\
     [--pit <filename>] [--verbose] [--no-reboot] [--resume] [--stdout-errors]\n\
-    [--usb-log-level <none/error/warning/debug>]\n\
+    [--usb-log-level <none/error/warning/debug>] [--pit-cache <directory>]\n\
+    [--progress <text/json>] [--progress-interval <milliseconds>]\n\
+    [--transfer-profiles <filename>] [--image-cache <directory>]\n\
   or:\n\
     --repartition --pit <filename> [--<partition name> <filename> ...]\n\
     [--<partition identifier> <filename> ...] [--verbose] [--no-reboot]\n\
     [--resume] [--stdout-errors] [--usb-log-level <none/error/warning/debug>]\n\
-    [--tflash]\n\
+    [--tflash] [--pit-cache <directory>] [--progress <text/json>]\n\
+    [--progress-interval <milliseconds>] [--transfer-profiles <filename>]\n\
+    [--image-cache <directory>]\n\
 Description: Flashes one or more firmware files to your phone. Partition names\n\
     (or identifiers) can be obtained by executing the print-pit action.\n\
     T-Flash mode allows to flash the inserted SD-card instead of the internal MMC.\n\
 Note: --no-reboot causes the device to remain in download mode after the action\n\
       is completed. If you wish to perform another action whilst remaining in\n\
       download mode, then the following action must specify the --resume flag.\n\
+Note: --pit-cache reuses the device's PIT file from the specified directory,\n\
+      rather than downloading all of it, when the PIT file's size and first\n\
+      part are unchanged. Devices are identified by their USB serial number.\n\
+Note: --progress json reports progress as JSON lines on stdout, at most once\n\
+      per --progress-interval milliseconds (default 250). All other output is\n\
+      written to stderr.\n\
+Note: --transfer-profiles applies the file transfer parameters measured by the\n\
+      tune action, if the file contains a profile for the device.\n\
+Note: --image-cache allows cache:<key> in place of a filename, to flash an image\n\
+      stored by the cache-image action.\n\
 WARNING: If you're repartitioning it's strongly recommended you specify\n\
         all files at your disposal.\n";
 
-struct PartitionFile
-{
-	const char *argumentName;
-	FILE *file;
-
-	PartitionFile(const char *argumentName, FILE *file)
-	{
-		this->argumentName = argumentName;
-		this->file = file;
-	}
-};
+// Refers to an image in the image cache, rather than a file.
+static const char *imageCachePrefix = "cache:";
 
 struct PartitionFlashInfo
 {
 	const PitEntry *pitEntry;
-	FILE *file;
+	const FlashAction::PartitionFile *partitionFile;
 
-	PartitionFlashInfo(const PitEntry *pitEntry, FILE *file)
+	PartitionFlashInfo(const PitEntry *pitEntry, const FlashAction::PartitionFile *partitionFile)
 	{
 		this->pitEntry = pitEntry;
-		this->file = file;
+		this->partitionFile = partitionFile;
 	}
 };
 
-static bool openFiles(Arguments& arguments, vector<PartitionFile>& partitionFiles, FILE *& pitFile)
+static bool openFiles(const Arguments& arguments, vector<FlashAction::PartitionFile>& partitionFiles, FILE *& pitFile)
 {
 	// Open PIT file
 
@@ -101,6 +112,8 @@ static bool openFiles(Arguments& arguments, vector<PartitionFile>& partitionFile
 
 	// Open partition files
 
+	const StringArgument *imageCacheArgument = static_cast<const StringArgument *>(arguments.GetArgument("image-cache"));
+
 	for (vector<const Argument *>::const_iterator it = arguments.GetArguments().begin(); it != arguments.GetArguments().end(); it++)
 	{
 		const string& argumentName = (*it)->GetName();
@@ -112,22 +125,36 @@ static bool openFiles(Arguments& arguments, vector<PartitionFile>& partitionFile
 		if (arguments.GetArgumentTypes().find(argumentName) == arguments.GetArgumentTypes().end())
 		{
 			const StringArgument *stringArgument = static_cast<const StringArgument *>(*it);
-			FILE *file = FileOpen(stringArgument->GetValue().c_str(), "rb");
+			string filename = stringArgument->GetValue();
+
+			if (imageCacheArgument && filename.compare(0, strlen(imageCachePrefix), imageCachePrefix) == 0)
+			{
+				string key = filename.substr(strlen(imageCachePrefix));
+				filename = ImageCache(imageCacheArgument->GetValue()).Find(key);
+
+				if (filename.empty())
+				{
+					Interface::PrintError("Image \"%s\" isn't in the image cache\n", key.c_str());
+					return (false);
+				}
+			}
+
+			FILE *file = FileOpen(filename.c_str(), "rb");
 
 			if (!file)
 			{
-				Interface::PrintError("Failed to open file \"%s\"\n", stringArgument->GetValue().c_str());
+				Interface::PrintError("Failed to open file \"%s\"\n", filename.c_str());
 				return (false);
 			}
 
-			partitionFiles.push_back(PartitionFile(argumentName.c_str(), file));
+			partitionFiles.push_back(FlashAction::PartitionFile(argumentName, file));
 		}
 	}
 
 	return (true);
 }
 
-static void closeFiles(vector<PartitionFile>& partitionFiles, FILE *& pitFile)
+static void closeFiles(vector<FlashAction::PartitionFile>& partitionFiles, FILE *& pitFile)
 {
 	// Close PIT file
 
@@ -139,35 +166,41 @@ static void closeFiles(vector<PartitionFile>& partitionFiles, FILE *& pitFile)
 
 	// Close partition files
 
-	for (vector<PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
-		FileClose(it->file);
+	for (vector<FlashAction::PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
+	{
+		if (it->file)
+			FileClose(it->file);
+	}
 
 	partitionFiles.clear();
 }
 
-static bool sendTotalTransferSize(BridgeManager *bridgeManager, const vector<PartitionFile>& partitionFiles, FILE *pitFile, bool repartition)
+static bool sendTotalTransferSize(BridgeManager *bridgeManager, const vector<FlashAction::PartitionFile>& partitionFiles, const PitData *localPitData,
+	bool repartition)
 {
 	unsigned int totalBytes = 0;
 
-	for (vector<PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
+	for (vector<FlashAction::PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
 	{
-		FileSeek(it->file, 0, SEEK_END);
-		totalBytes += (unsigned int)FileTell(it->file);
-		FileRewind(it->file);
+		if (it->image)
+		{
+			totalBytes += it->image->GetSize();
+		}
+		else
+		{
+			FileSeek(it->file, 0, SEEK_END);
+			totalBytes += (unsigned int)FileTell(it->file);
+			FileRewind(it->file);
+		}
 	}
 
 	if (repartition)
-	{
-		FileSeek(pitFile, 0, SEEK_END);
-		totalBytes += (unsigned int)FileTell(pitFile);
-		FileRewind(pitFile);
-	}
+		totalBytes += localPitData->GetPaddedSize();
 
 	bool success;
 	
-	TotalBytesPacket *totalBytesPacket = new TotalBytesPacket(totalBytes);
-	success = bridgeManager->SendPacket(totalBytesPacket);
-	delete totalBytesPacket;
+	TotalBytesPacket totalBytesPacket(totalBytes);
+	success = bridgeManager->SendPacket(&totalBytesPacket);
 
 	if (!success)
 	{
@@ -175,10 +208,9 @@ static bool sendTotalTransferSize(BridgeManager *bridgeManager, const vector<Par
 		return (false);
 	}
 
-	SessionSetupResponse *totalBytesResponse = new SessionSetupResponse();
-	success = bridgeManager->ReceivePacket(totalBytesResponse);
-	int totalBytesResult = totalBytesResponse->GetResult();
-	delete totalBytesResponse;
+	SessionSetupResponse totalBytesResponse;
+	success = bridgeManager->ReceivePacket(&totalBytesResponse);
+	int totalBytesResult = totalBytesResponse.GetResult();
 
 	if (!success)
 	{
@@ -195,38 +227,39 @@ static bool sendTotalTransferSize(BridgeManager *bridgeManager, const vector<Par
 	return (true);
 }
 
-static bool setupPartitionFlashInfo(const vector<PartitionFile>& partitionFiles, const PitData *pitData, vector<PartitionFlashInfo>& partitionFlashInfos)
+static bool setupPartitionFlashInfo(const vector<FlashAction::PartitionFile>& partitionFiles, const PitData *pitData,
+	vector<PartitionFlashInfo>& partitionFlashInfos)
 {
-	for (vector<PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
+	for (vector<FlashAction::PartitionFile>::const_iterator it = partitionFiles.begin(); it != partitionFiles.end(); it++)
 	{
 		const PitEntry *pitEntry = nullptr;
 
 		// Was the argument a partition identifier?
 		unsigned int partitionIdentifier;
 
-		if (Utility::ParseUnsignedInt(partitionIdentifier, it->argumentName) == kNumberParsingStatusSuccess)
+		if (Utility::ParseUnsignedInt(partitionIdentifier, it->partition.c_str()) == kNumberParsingStatusSuccess)
 		{
 			pitEntry = pitData->FindEntry(partitionIdentifier);
 
 			if (!pitEntry)
 			{
-				Interface::PrintError("No partition with identifier \"%s\" exists in the specified PIT.\n", it->argumentName);
+				Interface::PrintError("No partition with identifier \"%s\" exists in the specified PIT.\n", it->partition.c_str());
 				return (false);
 			}
 		}
 		else
 		{
 			// The argument must be an partition name e.g. "ZIMAGE"
-			pitEntry = pitData->FindEntry(it->argumentName);
+			pitEntry = pitData->FindEntry(it->partition.c_str());
 
 			if (!pitEntry)
 			{
-				Interface::PrintError("Partition \"%s\" does not exist in the specified PIT.\n", it->argumentName);
+				Interface::PrintError("Partition \"%s\" does not exist in the specified PIT.\n", it->partition.c_str());
 				return (false);
 			}
 		}
 
-		partitionFlashInfos.push_back(PartitionFlashInfo(pitEntry, it->file));
+		partitionFlashInfos.push_back(PartitionFlashInfo(pitEntry, &(*it)));
 	}
 
 	return (true);
@@ -248,13 +281,29 @@ static bool flashPitData(BridgeManager *bridgeManager, const PitData *pitData)
 	}
 }
 
+static bool sendPartitionFile(BridgeManager *bridgeManager, const FlashAction::PartitionFile *partitionFile, unsigned int destination,
+	unsigned int deviceType, unsigned int fileIdentifier = 0xFFFFFFFF)
+{
+	if (partitionFile->image)
+	{
+		return (bridgeManager->SendFile(partitionFile->image->GetData(), partitionFile->image->GetSize(), destination, deviceType,
+			fileIdentifier));
+	}
+	else
+	{
+		return (bridgeManager->SendFile(partitionFile->file, destination, deviceType, fileIdentifier));
+	}
+}
+
 static bool flashFile(BridgeManager *bridgeManager, const PartitionFlashInfo& partitionFlashInfo)
 {
+	Progress::Phase("flash", partitionFlashInfo.pitEntry->GetPartitionName());
+
 	if (partitionFlashInfo.pitEntry->GetBinaryType() == PitEntry::kBinaryTypeCommunicationProcessor) // Modem
 	{			
 		Interface::Print("Uploading %s\n", partitionFlashInfo.pitEntry->GetPartitionName());
 
-		if (bridgeManager->SendFile(partitionFlashInfo.file, EndModemFileTransferPacket::kDestinationModem,
+		if (sendPartitionFile(bridgeManager, partitionFlashInfo.partitionFile, EndModemFileTransferPacket::kDestinationModem,
 			partitionFlashInfo.pitEntry->GetDeviceType()))
 		{
 			Interface::Print("%s upload successful\n\n", partitionFlashInfo.pitEntry->GetPartitionName());
@@ -270,7 +319,7 @@ static bool flashFile(BridgeManager *bridgeManager, const PartitionFlashInfo& pa
 	{
 		Interface::Print("Uploading %s\n", partitionFlashInfo.pitEntry->GetPartitionName());
 
-		if (bridgeManager->SendFile(partitionFlashInfo.file, EndPhoneFileTransferPacket::kDestinationPhone,
+		if (sendPartitionFile(bridgeManager, partitionFlashInfo.partitionFile, EndPhoneFileTransferPacket::kDestinationPhone,
 			partitionFlashInfo.pitEntry->GetDeviceType(), partitionFlashInfo.pitEntry->GetIdentifier()))
 		{
 			Interface::Print("%s upload successful\n\n", partitionFlashInfo.pitEntry->GetPartitionName());
@@ -284,7 +333,8 @@ static bool flashFile(BridgeManager *bridgeManager, const PartitionFlashInfo& pa
 	}
 }
 
-static bool flashPartitions(BridgeManager *bridgeManager, const vector<PartitionFile>& partitionFiles, const PitData *pitData, bool repartition)
+static bool flashPartitions(BridgeManager *bridgeManager, const vector<FlashAction::PartitionFile>& partitionFiles, const PitData *pitData, bool repartition,
+	const PitCache *pitCache)
 {
 	vector<PartitionFlashInfo> partitionFlashInfos;
 
@@ -295,6 +345,10 @@ static bool flashPartitions(BridgeManager *bridgeManager, const vector<Partition
 	// If we're repartitioning then we need to flash the PIT file first (if it is listed in the PIT file).
 	if (repartition)
 	{
+		// The device's PIT is about to change, so it mustn't be taken from the cache again.
+		if (pitCache && !bridgeManager->GetSerialNumber().empty())
+			pitCache->Remove(bridgeManager->GetSerialNumber());
+
 		if (!flashPitData(bridgeManager, pitData))
 			return (false);
 	}
@@ -308,74 +362,97 @@ static bool flashPartitions(BridgeManager *bridgeManager, const vector<Partition
 	return (true);
 }
 
-static PitData *getPitData(BridgeManager *bridgeManager, FILE *pitFile, bool repartition)
+static PitData *loadPitFile(FILE *pitFile)
 {
-	PitData *pitData;
-	PitData *localPitData = nullptr;
+	// Load the local pit file into memory.
 
-	// If a PIT file was passed as an argument then we must unpack it.
+	FileSeek(pitFile, 0, SEEK_END);
+	unsigned int localPitFileSize = (unsigned int)FileTell(pitFile);
+	FileRewind(pitFile);
 
-	if (pitFile)
-	{
-		// Load the local pit file into memory.
+	unsigned char *pitFileBuffer = new unsigned char[localPitFileSize];
+	memset(pitFileBuffer, 0, localPitFileSize);
 
-		FileSeek(pitFile, 0, SEEK_END);
-		unsigned int localPitFileSize = (unsigned int)FileTell(pitFile);
-		FileRewind(pitFile);
+	int dataRead = fread(pitFileBuffer, 1, localPitFileSize, pitFile);
 
-		unsigned char *pitFileBuffer = new unsigned char[localPitFileSize];
-		memset(pitFileBuffer, 0, localPitFileSize);
+	if (dataRead <= 0)
+	{
+		Interface::PrintError("Failed to read PIT file.\n");
 
-		int dataRead = fread(pitFileBuffer, 1, localPitFileSize, pitFile);
+		delete [] pitFileBuffer;
+		return (nullptr);
+	}
 
-		if (dataRead > 0)
-		{
-			FileRewind(pitFile);
+	FileRewind(pitFile);
 
-			localPitData = new PitData();
-			localPitData->Unpack(pitFileBuffer);
+	PitData *localPitData = new PitData();
+	bool unpacked = localPitData->Unpack(pitFileBuffer, dataRead);
 
-			delete [] pitFileBuffer;
-		}
-		else
-		{
-			Interface::PrintError("Failed to read PIT file.\n");
+	delete [] pitFileBuffer;
 
-			delete [] pitFileBuffer;
-			return (nullptr);
-		}
+	if (!unpacked)
+	{
+		Interface::PrintError("Failed to unpack PIT file.\n");
+
+		delete localPitData;
+		return (nullptr);
 	}
 
+	return (localPitData);
+}
+
+static PitData *getPitData(BridgeManager *bridgeManager, const PitData *localPitData, bool repartition, const PitData *devicePitData,
+	const PitCache *pitCache)
+{
+	PitData *pitData;
+
 	if (repartition)
 	{
 		// Use the local PIT file data.
-		pitData = localPitData;
+		pitData = new PitData(*localPitData);
+	}
+	else if (devicePitData)
+	{
+		// The device's PIT has already been retrieved during this session.
+		pitData = new PitData(*devicePitData);
 	}
 	else
 	{
 		// If we're not repartitioning then we need to retrieve the device's PIT file and unpack it.
 		unsigned char *pitFileBuffer;
+		int pitFileSize = bridgeManager->DownloadPitFile(&pitFileBuffer, pitCache);
 
-		if (bridgeManager->DownloadPitFile(&pitFileBuffer) == 0)
+		if (pitFileSize == 0)
 			return (nullptr);
 
 		pitData = new PitData();
-		pitData->Unpack(pitFileBuffer);
+		bool unpacked = pitData->Unpack(pitFileBuffer, pitFileSize);
 
 		delete [] pitFileBuffer;
 
-		if (localPitData != nullptr)
+		if (!unpacked)
 		{
-			// The user has specified a PIT without repartitioning, we should verify the local and device PIT data match!
-			bool pitsMatch = pitData->Matches(localPitData);
-			delete localPitData;
+			Interface::PrintError("Failed to unpack device's PIT file!\n");
 
-			if (!pitsMatch)
-			{
-				Interface::Print("Local and device PIT files don't match and repartition wasn't specified!\n");
-				Interface::PrintError("Flash aborted!\n");
-				return (nullptr);
-			}
+			delete pitData;
+			return (nullptr);
+		}
+	}
+
+	if (!repartition && localPitData != nullptr)
+	{
+		// The user has specified a PIT without repartitioning, we should verify the local and device PIT data match!
+		PitDiff pitDiff;
+		pitDiff.Compare(localPitData, pitData);
+
+		if (!pitDiff.IsEmpty())
+		{
+			Interface::Print("Local and device PIT files don't match and repartition wasn't specified!\n");
+			Interface::PrintPitDiff(&pitDiff, localPitData, pitData, "local", "device");
+			Interface::PrintError("Flash aborted!\n");
+
+			delete pitData;
+			return (nullptr);
 		}
 	}
 
@@ -386,9 +463,8 @@ static bool enableTFlash(BridgeManager *bridgeManager)
 {
 	bool success;
 
-	EnableTFlashPacket *enableTFlashPacket = new EnableTFlashPacket();
-	success = bridgeManager->SendPacket(enableTFlashPacket);
-	delete enableTFlashPacket;
+	EnableTFlashPacket enableTFlashPacket;
+	success = bridgeManager->SendPacket(&enableTFlashPacket);
 
 	if (!success)
 	{
@@ -396,10 +472,9 @@ static bool enableTFlash(BridgeManager *bridgeManager)
 		return false;
 	}
 
-	SessionSetupResponse *enableTFlashResponse = new SessionSetupResponse();
-	success = bridgeManager->ReceivePacket(enableTFlashResponse, 5000);
-	unsigned int result = enableTFlashResponse->GetResult();
-	delete enableTFlashResponse;
+	SessionSetupResponse enableTFlashResponse;
+	success = bridgeManager->ReceivePacket(&enableTFlashResponse, 5000);
+	unsigned int result = enableTFlashResponse.GetResult();
 
 	if (!success)
 	{
@@ -416,25 +491,38 @@ static bool enableTFlash(BridgeManager *bridgeManager)
 	return true;
 }
 
-int FlashAction::Execute(int argc, char **argv)
+static bool flash(BridgeManager *bridgeManager, const vector<FlashAction::PartitionFile>& partitionFiles, FILE *pitFile, bool repartition,
+	bool tflash, const PitData *devicePitData, const PitCache *pitCache)
 {
-	// Setup argument types
+	// If a PIT file was passed as an argument then we must unpack it.
+	PitData *localPitData = nullptr;
 
-	map<string, ArgumentType> argumentTypes;
-	map<string, string> shortArgumentAliases;
+	if (pitFile)
+	{
+		localPitData = loadPitFile(pitFile);
 
-	argumentTypes["repartition"] = kArgumentTypeFlag;
+		if (!localPitData)
+			return (false);
+	}
 
-	argumentTypes["no-reboot"] = kArgumentTypeFlag;
-	argumentTypes["resume"] = kArgumentTypeFlag;
-	argumentTypes["verbose"] = kArgumentTypeFlag;
-	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
-	argumentTypes["usb-log-level"] = kArgumentTypeString;
+	bool success = FlashAction::Flash(bridgeManager, partitionFiles, localPitData, repartition, tflash, devicePitData, pitCache);
+
+	delete localPitData;
+
+	return (success);
+}
+
+void FlashAction::AddArgumentTypes(map<string, ArgumentType>& argumentTypes, map<string, string>& shortArgumentAliases,
+	map<string, string>& argumentAliases)
+{
+	argumentTypes["repartition"] = kArgumentTypeFlag;
 	argumentTypes["tflash"] = kArgumentTypeFlag;
 
 	argumentTypes["pit"] = kArgumentTypeString;
 	shortArgumentAliases["pit"] = "pit";
 
+	argumentTypes["image-cache"] = kArgumentTypeString;
+
 	// Add wild-cards "%d" and "%s", for partition identifiers and partition names respectively.
 	argumentTypes["%d"] = kArgumentTypeString;
 	shortArgumentAliases["%d"] = "%d";
@@ -442,8 +530,89 @@ int FlashAction::Execute(int argc, char **argv)
 	argumentTypes["%s"] = kArgumentTypeString;
 	shortArgumentAliases["%s"] = "%s";
 
-	map<string, string> argumentAliases;
 	argumentAliases["PIT"] = "pit"; // Map upper-case PIT argument (i.e. partition name) to known lower-case pit argument.
+}
+
+bool FlashAction::Flash(BridgeManager *bridgeManager, const Arguments& arguments, const PitData *devicePitData, const PitCache *pitCache)
+{
+	bool repartition = arguments.GetArgument("repartition") != nullptr;
+	bool tflash = arguments.GetArgument("tflash") != nullptr;
+
+	if (repartition && !arguments.GetArgument("pit"))
+	{
+		Interface::PrintError("If you wish to repartition then a PIT file must be specified.\n");
+		return (false);
+	}
+
+	FILE *pitFile = nullptr;
+	vector<PartitionFile> partitionFiles;
+
+	if (!openFiles(arguments, partitionFiles, pitFile))
+	{
+		closeFiles(partitionFiles, pitFile);
+		return (false);
+	}
+
+	if (partitionFiles.size() == 0)
+	{
+		Interface::PrintError("No partitions were specified to flash.\n");
+		closeFiles(partitionFiles, pitFile);
+		return (false);
+	}
+
+	bool success = flash(bridgeManager, partitionFiles, pitFile, repartition, tflash, devicePitData, pitCache);
+
+	closeFiles(partitionFiles, pitFile);
+
+	return (success);
+}
+
+bool FlashAction::Flash(BridgeManager *bridgeManager, const vector<PartitionFile>& partitionFiles, const PitData *localPitData, bool repartition,
+	bool tflash, const PitData *devicePitData, const PitCache *pitCache)
+{
+	if (repartition && !localPitData)
+	{
+		Interface::PrintError("If you wish to repartition then a PIT file must be specified.\n");
+		return (false);
+	}
+
+	if (tflash && !enableTFlash(bridgeManager))
+		return (false);
+
+	if (!sendTotalTransferSize(bridgeManager, partitionFiles, localPitData, repartition))
+		return (false);
+
+	PitData *pitData = getPitData(bridgeManager, localPitData, repartition, devicePitData, pitCache);
+
+	if (!pitData)
+		return (false);
+
+	bool success = flashPartitions(bridgeManager, partitionFiles, pitData, repartition, pitCache);
+
+	delete pitData;
+
+	return (success);
+}
+
+int FlashAction::Execute(int argc, char **argv)
+{
+	// Setup argument types
+
+	map<string, ArgumentType> argumentTypes;
+	map<string, string> shortArgumentAliases;
+	map<string, string> argumentAliases;
+
+	argumentTypes["no-reboot"] = kArgumentTypeFlag;
+	argumentTypes["resume"] = kArgumentTypeFlag;
+	argumentTypes["verbose"] = kArgumentTypeFlag;
+	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+	argumentTypes["usb-log-level"] = kArgumentTypeString;
+	argumentTypes["pit-cache"] = kArgumentTypeString;
+	argumentTypes["transfer-profiles"] = kArgumentTypeString;
+
+	Progress::AddArgumentTypes(argumentTypes);
+
+	AddArgumentTypes(argumentTypes, shortArgumentAliases, argumentAliases);
 
 	// Handle arguments
 
@@ -463,6 +632,12 @@ int FlashAction::Execute(int argc, char **argv)
 	if (arguments.GetArgument("stdout-errors") != nullptr)
 		Interface::SetStdoutErrors(true);
 
+	if (!Progress::ApplyArguments(arguments))
+	{
+		Interface::Print(FlashAction::usage);
+		return (0);
+	}
+
 	const StringArgument *usbLogLevelArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-log-level"));
 
 	BridgeManager::UsbLogLevel usbLogLevel = BridgeManager::UsbLogLevel::Default;
@@ -510,6 +685,30 @@ int FlashAction::Execute(int argc, char **argv)
 		return (0);
 	}
 
+	const StringArgument *pitCacheArgument = static_cast<const StringArgument *>(arguments.GetArgument("pit-cache"));
+	PitCache *pitCache = nullptr;
+
+	if (pitCacheArgument)
+	{
+		pitCache = new PitCache(pitCacheArgument->GetValue());
+
+		if (!pitCache->Initialise())
+		{
+			Interface::PrintError("Failed to create PIT cache directory \"%s\"\n", pitCacheArgument->GetValue().c_str());
+			delete pitCache;
+			return (1);
+		}
+	}
+
+	const StringArgument *transferProfilesArgument = static_cast<const StringArgument *>(arguments.GetArgument("transfer-profiles"));
+	TransferProfiles transferProfiles((transferProfilesArgument) ? transferProfilesArgument->GetValue() : "");
+
+	if (transferProfilesArgument && !transferProfiles.Load())
+	{
+		delete pitCache;
+		return (1);
+	}
+
 	// Open files
 	
 	FILE *pitFile = nullptr;
@@ -518,12 +717,14 @@ int FlashAction::Execute(int argc, char **argv)
 	if (!openFiles(arguments, partitionFiles, pitFile))
 	{
 		closeFiles(partitionFiles, pitFile);
+		delete pitCache;
 		return (1);
 	}
 
 	if (partitionFiles.size() == 0)
 	{
 		Interface::Print(FlashAction::usage);
+		delete pitCache;
 		return (0);
 	}
 
@@ -536,41 +737,24 @@ int FlashAction::Execute(int argc, char **argv)
 
 	BridgeManager *bridgeManager = new BridgeManager(verbose);
 	bridgeManager->SetUsbLogLevel(usbLogLevel);
+	bridgeManager->SetTransferProfiles((transferProfilesArgument) ? &transferProfiles : nullptr);
 
 	if (bridgeManager->Initialise(resume) != BridgeManager::kInitialiseSucceeded || !bridgeManager->BeginSession())
 	{
 		closeFiles(partitionFiles, pitFile);
 		delete bridgeManager;
+		delete pitCache;
 
 		return (1);
 	}
 
-	if (tflash && !enableTFlash(bridgeManager))
-	{
-		closeFiles(partitionFiles, pitFile);
-		delete bridgeManager;
-
-		return (1);
-	}
-
-	bool success = sendTotalTransferSize(bridgeManager, partitionFiles, pitFile, repartition);
-
-	if (success)
-	{
-		PitData *pitData = getPitData(bridgeManager, pitFile, repartition);
-	
-		if (pitData)
-			success = flashPartitions(bridgeManager, partitionFiles, pitData, repartition);
-		else
-			success = false;
-
-		delete pitData;
-	}
+	bool success = flash(bridgeManager, partitionFiles, pitFile, repartition, tflash, nullptr, pitCache);
 
 	if (!bridgeManager->EndSession(reboot))
 		success = false;
 
 	delete bridgeManager;
+	delete pitCache;
 	
 	closeFiles(partitionFiles, pitFile);
 
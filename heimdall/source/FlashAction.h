@@ -21,12 +21,62 @@
 #ifndef FLASHACTION_H
 #define FLASHACTION_H
 
+// C/C++ Standard Library
+#include <map>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// libpit
+#include "libpit.h"
+
+// Heimdall
+#include "Arguments.h"
+
 namespace Heimdall
 {
+	class BridgeManager;
+	class Image;
+	class PitCache;
+
 	namespace FlashAction
 	{
 		extern const char *usage;
 
+		// Either a file or an image, which is sent from memory and may be shared with other sessions.
+		struct PartitionFile
+		{
+			std::string partition; // A partition name or identifier.
+			FILE *file;
+			std::shared_ptr<const Image> image;
+
+			PartitionFile(const std::string& partition, FILE *file)
+			{
+				this->partition = partition;
+				this->file = file;
+			}
+
+			PartitionFile(const std::string& partition, const std::shared_ptr<const Image>& image)
+			{
+				this->partition = partition;
+				this->file = nullptr;
+				this->image = image;
+			}
+		};
+
+		// Adds the argument types understood by Flash() i.e. every flash argument that doesn't control the session.
+		void AddArgumentTypes(std::map<std::string, ArgumentType>& argumentTypes, std::map<std::string, std::string>& shortArgumentAliases,
+			std::map<std::string, std::string>& argumentAliases);
+
+		// Flashes within a session that has already begun. The device's PIT is downloaded unless devicePitData is provided.
+		bool Flash(BridgeManager *bridgeManager, const Arguments& arguments, const libpit::PitData *devicePitData, const PitCache *pitCache);
+
+		// As above, for callers that have already opened their files and unpacked their PIT. localPitData may be nullptr unless
+		// repartitioning, otherwise it must match the device's PIT.
+		bool Flash(BridgeManager *bridgeManager, const std::vector<PartitionFile>& partitionFiles, const libpit::PitData *localPitData,
+			bool repartition, bool tflash, const libpit::PitData *devicePitData, const PitCache *pitCache);
+
 		int Execute(int argc, char **argv);
 	}
 }
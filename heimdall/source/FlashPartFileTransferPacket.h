@@ -30,6 +30,8 @@ namespace Heimdall
 	{
 		private:
 
+			typedef NextPacketField<FileTransferPacket::RequestField> SequenceByteCountField;
+
 			unsigned int sequenceByteCount;
 
 		public:
@@ -49,7 +51,7 @@ namespace Heimdall
 			{
 				FileTransferPacket::Pack();
 
-				PackInteger(FileTransferPacket::kDataSize, sequenceByteCount);
+				PackField<SequenceByteCountField>(sequenceByteCount);
 			}
 	};
 }
@@ -30,6 +30,8 @@ namespace Heimdall
 	{
 		private:
 
+			typedef NextPacketField<PitFilePacket::RequestField> PartSizeField;
+
 			unsigned int partSize;
 
 		public:
@@ -48,7 +50,7 @@ namespace Heimdall
 			{
 				PitFilePacket::Pack();
 
-				PackInteger(PitFilePacket::kDataSize, partSize);
+				PackField<PartSizeField>(partSize);
 			}
 	};
 }
@@ -0,0 +1,298 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <string.h>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#undef GetBinaryType
+#include <direct.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <utime.h>
+#endif
+
+// Heimdall
+#include "Heimdall.h"
+#include "ImageCache.h"
+
+using namespace std;
+using namespace Heimdall;
+
+const unsigned long long ImageCache::kDefaultMaxSize = 16ULL * 1024 * 1024 * 1024;
+
+enum
+{
+	kCopyBufferSize = 262144,
+	kTemporaryFileMaxAge = 86400 // seconds
+};
+
+struct CachedImage
+{
+	string filename;
+	unsigned long long size;
+	long long lastUsedTime; // Seconds since the epoch.
+	bool temporary; // Left by Store(), which may still be writing it or may have been interrupted.
+};
+
+// Store() writes images to <key>.<suffix>.tmp before renaming them.
+static bool isTemporaryFilename(const string& filename)
+{
+	size_t keyEnd = filename.find('.');
+
+	return (keyEnd != string::npos && filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".tmp") == 0
+		&& ImageCache::IsValidKey(filename.substr(0, keyEnd)));
+}
+
+static void findImages(const string& directory, vector<CachedImage>& images)
+{
+#ifdef _WIN32
+
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA((directory + "\\*").c_str(), &findData);
+
+	if (findHandle == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		bool temporary = isTemporaryFilename(findData.cFileName);
+
+		if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || (!temporary && !ImageCache::IsValidKey(findData.cFileName)))
+			continue;
+
+		// FILETIME counts 100 nanosecond intervals since 1601.
+		long long lastWriteTime = ((long long)findData.ftLastWriteTime.dwHighDateTime << 32) | findData.ftLastWriteTime.dwLowDateTime;
+
+		CachedImage image;
+		image.filename = directory + "/" + findData.cFileName;
+		image.size = ((unsigned long long)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+		image.lastUsedTime = (lastWriteTime - 116444736000000000LL) / 10000000;
+		image.temporary = temporary;
+
+		images.push_back(image);
+	} while (FindNextFileA(findHandle, &findData));
+
+	FindClose(findHandle);
+
+#else
+
+	DIR *dir = opendir(directory.c_str());
+
+	if (!dir)
+		return;
+
+	struct dirent *entry;
+
+	while ((entry = readdir(dir)) != nullptr)
+	{
+		// Partially stored images have a suffix, so they're never mistaken for complete images.
+		bool temporary = isTemporaryFilename(entry->d_name);
+
+		if (!temporary && !ImageCache::IsValidKey(entry->d_name))
+			continue;
+
+		string filename = directory + "/" + entry->d_name;
+		struct stat fileStatus;
+
+		if (stat(filename.c_str(), &fileStatus) != 0 || !S_ISREG(fileStatus.st_mode))
+			continue;
+
+		CachedImage image;
+		image.filename = filename;
+		image.size = fileStatus.st_size;
+		image.lastUsedTime = fileStatus.st_mtime;
+		image.temporary = temporary;
+
+		images.push_back(image);
+	}
+
+	closedir(dir);
+
+#endif
+}
+
+ImageCache::ImageCache(const string& directory, unsigned long long maxSize)
+{
+	this->directory = directory;
+	this->maxSize = maxSize;
+}
+
+string ImageCache::GetFilename(const string& key) const
+{
+	// Keys are case-insensitive, as are filenames on some platforms.
+	string filename = directory + "/" + key;
+	transform(filename.end() - key.size(), filename.end(), filename.end() - key.size(), ::tolower);
+
+	return (filename);
+}
+
+bool ImageCache::IsValidKey(const string& key)
+{
+	if (key.empty() || key.length() > 128)
+		return (false);
+
+	for (string::const_iterator it = key.begin(); it != key.end(); it++)
+	{
+		if (!((*it >= '0' && *it <= '9') || (*it >= 'a' && *it <= 'f') || (*it >= 'A' && *it <= 'F')))
+			return (false);
+	}
+
+	return (true);
+}
+
+bool ImageCache::Initialise(void) const
+{
+#ifdef _WIN32
+	int result = _mkdir(directory.c_str());
+#else
+	int result = mkdir(directory.c_str(), 0755);
+#endif
+
+	return (result == 0 || errno == EEXIST);
+}
+
+string ImageCache::Find(const string& key) const
+{
+	if (!IsValidKey(key))
+		return ("");
+
+	string filename = GetFilename(key);
+
+	// The modification time records when the image was last used, a missing image simply fails to be touched.
+#ifdef _WIN32
+	bool found = _utime(filename.c_str(), nullptr) == 0;
+#else
+	bool found = utime(filename.c_str(), nullptr) == 0;
+#endif
+
+	return (found ? filename : "");
+}
+
+bool ImageCache::Store(const string& key, FILE *file) const
+{
+	if (!IsValidKey(key))
+		return (false);
+
+	string filename = GetFilename(key);
+
+	// Unique per thread, in case several processes (or threads) store the same image at once.
+	unsigned long long suffix = (unsigned long long)chrono::steady_clock::now().time_since_epoch().count()
+		^ hash<thread::id>()(this_thread::get_id());
+	string temporaryFilename = filename + "." + to_string(suffix) + ".tmp";
+
+	// Write then rename, so that an interrupted write never leaves a truncated image in the cache.
+	FILE *cacheFile = FileOpen(temporaryFilename.c_str(), "wb");
+
+	if (!cacheFile)
+		return (false);
+
+	vector<char> buffer(kCopyBufferSize);
+	bool success = true;
+
+	while (true)
+	{
+		size_t dataRead = fread(buffer.data(), 1, buffer.size(), file);
+
+		if (dataRead > 0 && fwrite(buffer.data(), 1, dataRead, cacheFile) != dataRead)
+		{
+			success = false;
+			break;
+		}
+
+		if (dataRead < buffer.size())
+		{
+			success = !ferror(file);
+			break;
+		}
+	}
+
+	if (FileClose(cacheFile) != 0)
+		success = false;
+
+	if (success)
+	{
+#ifdef _WIN32
+		remove(filename.c_str());
+#endif
+		success = rename(temporaryFilename.c_str(), filename.c_str()) == 0;
+	}
+
+	if (!success)
+	{
+		remove(temporaryFilename.c_str());
+		return (false);
+	}
+
+	Evict();
+
+	return (true);
+}
+
+void ImageCache::Evict(void) const
+{
+	vector<CachedImage> files;
+	findImages(directory, files);
+
+	vector<CachedImage> images;
+	unsigned long long totalSize = 0;
+	long long now = time(nullptr);
+
+	for (const CachedImage& file : files)
+	{
+		// Left by an interrupted Store(), as no image takes this long to write.
+		if (file.temporary && now - file.lastUsedTime > kTemporaryFileMaxAge && remove(file.filename.c_str()) == 0)
+			continue;
+
+		// Temporary files still being written count towards the size, but can't be evicted.
+		if (!file.temporary)
+			images.push_back(file);
+
+		totalSize += file.size;
+	}
+
+	if (totalSize <= maxSize)
+		return;
+
+	sort(images.begin(), images.end(), [](const CachedImage& image, const CachedImage& otherImage)
+	{
+		return (image.lastUsedTime < otherImage.lastUsedTime);
+	});
+
+	// The most recently used image is always kept, even if it alone exceeds the maximum size. Images in use may fail to be removed
+	// (on Windows), in which case they're simply skipped.
+	for (size_t i = 0; i + 1 < images.size() && totalSize > maxSize; i++)
+	{
+		if (remove(images[i].filename.c_str()) == 0)
+			totalSize -= images[i].size;
+	}
+}
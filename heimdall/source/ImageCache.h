@@ -0,0 +1,70 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+// C/C++ Standard Library
+#include <stdio.h>
+#include <string>
+
+// Heimdall
+#include "Heimdall.h"
+
+namespace Heimdall
+{
+	// On-disk cache of extracted firmware images, keyed by a hash of the package member or compressed file they were extracted
+	// from, so that each image is only extracted once. When the cache grows beyond its maximum size the least recently used
+	// images are removed.
+	class ImageCache
+	{
+		public:
+
+			static const unsigned long long kDefaultMaxSize;
+
+		private:
+
+			std::string directory;
+			unsigned long long maxSize;
+
+			std::string GetFilename(const std::string& key) const;
+
+		public:
+
+			ImageCache(const std::string& directory, unsigned long long maxSize = kDefaultMaxSize);
+
+			// Keys are hexadecimal digests e.g. the output of sha256sum, in either case.
+			static bool IsValidKey(const std::string& key);
+
+			// Creates the cache directory if it doesn't already exist.
+			bool Initialise(void) const;
+
+			// Returns the cached image's filename and marks it as recently used, or an empty string if the image isn't cached.
+			std::string Find(const std::string& key) const;
+
+			// Copies the remainder of file into the cache, then evicts images to bring the cache within its maximum size.
+			bool Store(const std::string& key, FILE *file) const;
+
+			// Also removes files left by interrupted calls to Store().
+			void Evict(void) const;
+	};
+}
+
+#endif
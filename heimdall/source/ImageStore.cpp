@@ -0,0 +1,286 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifdef _WIN32
+#include <Windows.h>
+#undef GetBinaryType
+#include <sys/stat.h>
+#include <sys/types.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// C/C++ Standard Library
+#include <stdio.h>
+
+// Heimdall
+#include "Heimdall.h"
+#include "ImageStore.h"
+
+using namespace std;
+using namespace Heimdall;
+
+#ifdef _WIN32
+typedef struct _stat64 FileStatus;
+#else
+typedef struct stat FileStatus;
+#endif
+
+static bool getFileStatus(FILE *file, FileStatus& status)
+{
+#ifdef _WIN32
+	return (_fstat64(_fileno(file), &status) == 0);
+#else
+	return (fstat(fileno(file), &status) == 0);
+#endif
+}
+
+static bool getFileStatus(const string& filename, FileStatus& status)
+{
+#ifdef _WIN32
+	return (_stat64(filename.c_str(), &status) == 0);
+#else
+	return (stat(filename.c_str(), &status) == 0);
+#endif
+}
+
+Image::Image()
+{
+	data = nullptr;
+	size = 0;
+
+	mapped = false;
+	ownsData = false;
+
+	modifiedTime = 0;
+	fileIndex = 0;
+
+#ifdef _WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = nullptr;
+#endif
+}
+
+Image::Image(const unsigned char *data, unsigned int size)
+{
+	this->data = data;
+	this->size = size;
+
+	mapped = false;
+	ownsData = false;
+
+	modifiedTime = 0;
+	fileIndex = 0;
+
+#ifdef _WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = nullptr;
+#endif
+}
+
+Image::~Image()
+{
+	Close();
+}
+
+void Image::Close(void)
+{
+	if (mapped)
+	{
+#ifdef _WIN32
+
+		UnmapViewOfFile(data);
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+
+		fileHandle = INVALID_HANDLE_VALUE;
+		mappingHandle = nullptr;
+
+#else
+
+		munmap((void *)data, size);
+
+#endif
+	}
+	else if (ownsData)
+	{
+		delete [] data;
+	}
+
+	data = nullptr;
+	size = 0;
+
+	mapped = false;
+	ownsData = false;
+
+	filename.clear();
+	modifiedTime = 0;
+	fileIndex = 0;
+}
+
+bool Image::Open(const string& filename)
+{
+	Close();
+
+	FILE *file = FileOpen(filename.c_str(), "rb");
+
+	if (!file)
+		return (false);
+
+	FileStatus fileStatus;
+
+	if (!getFileStatus(file, fileStatus))
+	{
+		FileClose(file);
+		return (false);
+	}
+
+	this->filename = filename;
+	modifiedTime = fileStatus.st_mtime;
+	fileIndex = fileStatus.st_ino;
+
+	FileSeek(file, 0, SEEK_END);
+	long long fileSize = FileTell(file);
+	FileRewind(file);
+
+	// Files are sent with a 32-bit size. Empty files can't be mapped, but then there's nothing to send anyway.
+	if (fileSize < 0 || fileSize > 0xFFFFFFFFLL)
+	{
+		FileClose(file);
+		return (false);
+	}
+
+	if (fileSize == 0)
+	{
+		FileClose(file);
+		return (true);
+	}
+
+#ifdef _WIN32
+
+	fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (fileHandle != INVALID_HANDLE_VALUE)
+	{
+		mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (mappingHandle)
+			data = (const unsigned char *)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+
+	if (data)
+	{
+		mapped = true;
+	}
+	else
+	{
+		if (mappingHandle)
+			CloseHandle(mappingHandle);
+
+		if (fileHandle != INVALID_HANDLE_VALUE)
+			CloseHandle(fileHandle);
+
+		fileHandle = INVALID_HANDLE_VALUE;
+		mappingHandle = nullptr;
+	}
+
+#else
+
+	void *mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+
+	if (mapping != MAP_FAILED)
+	{
+		data = (const unsigned char *)mapping;
+		mapped = true;
+	}
+
+#endif
+
+	// Address space may be too scarce to map the file (on 32-bit hosts), in which case it's read instead.
+	if (!mapped)
+	{
+		unsigned char *buffer = new (nothrow) unsigned char[fileSize];
+
+		if (!buffer || fread(buffer, 1, fileSize, file) != (size_t)fileSize)
+		{
+			delete [] buffer;
+			FileClose(file);
+
+			return (false);
+		}
+
+		data = buffer;
+		ownsData = true;
+	}
+
+	size = (unsigned int)fileSize;
+	FileClose(file);
+
+	return (true);
+}
+
+bool Image::IsUnchanged(void) const
+{
+	if (filename.empty())
+		return (true);
+
+	FileStatus fileStatus;
+
+	return (getFileStatus(filename, fileStatus) && fileStatus.st_size == (long long)size && fileStatus.st_mtime == modifiedTime
+		&& (unsigned long long)fileStatus.st_ino == fileIndex);
+}
+
+shared_ptr<const Image> ImageStore::Open(const string& filename)
+{
+	lock_guard<std::mutex> lock(mutex);
+
+	shared_ptr<const Image> image = images[filename].lock();
+
+	// Sessions still holding the image would send a mixture of the old and new files, if not fault on a truncated mapping.
+	if (image)
+		return ((image->IsUnchanged()) ? image : nullptr);
+
+	Image *newImage = new Image();
+
+	if (!newImage->Open(filename))
+	{
+		delete newImage;
+		images.erase(filename);
+
+		return (nullptr);
+	}
+
+	image.reset(newImage);
+	images[filename] = image;
+
+	// Forget images that are no longer held by any session.
+	for (map<string, weak_ptr<const Image>>::iterator it = images.begin(); it != images.end();)
+	{
+		if (it->second.expired())
+			it = images.erase(it);
+		else
+			it++;
+	}
+
+	return (image);
+}
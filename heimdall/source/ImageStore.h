@@ -0,0 +1,111 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef IMAGESTORE_H
+#define IMAGESTORE_H
+
+// C/C++ Standard Library
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Heimdall
+#include "Heimdall.h"
+
+namespace Heimdall
+{
+	// A file's contents, mapped (or read) into memory once and never modified, so that it can be sent by sessions on any
+	// number of threads at once. The file mustn't be modified whilst it's open, reading a mapping of a file that has since been
+	// truncated is fatal (SIGBUS).
+	class Image
+	{
+		private:
+
+			const unsigned char *data;
+			unsigned int size;
+
+			bool mapped;
+			bool ownsData;
+
+			// The version of the file that was opened, so that modifications since can be detected.
+			std::string filename; // Empty unless opened from a file.
+			long long modifiedTime;
+			unsigned long long fileIndex; // i.e. inode number, 0 where the platform doesn't have one.
+
+#ifdef _WIN32
+			void *fileHandle;
+			void *mappingHandle;
+#endif
+
+			Image(const Image&);
+			Image& operator=(const Image&);
+
+			void Close(void);
+
+		public:
+
+			Image();
+
+			// Refers to data owned by the caller, which must outlive the image.
+			Image(const unsigned char *data, unsigned int size);
+
+			~Image();
+
+			bool Open(const std::string& filename);
+
+			// Whether the file is still the one that was opened, with the same size and modification time. Always true for images
+			// that weren't opened from a file.
+			bool IsUnchanged(void) const;
+
+			const std::string& GetFilename(void) const
+			{
+				return (filename);
+			}
+
+			const unsigned char *GetData(void) const
+			{
+				return (data);
+			}
+
+			unsigned int GetSize(void) const
+			{
+				return (size);
+			}
+	};
+
+	// Shares images between the sessions of one process, so that flashing the same file to several devices at once costs about
+	// as much memory and I/O as flashing one. Each file is opened once, for as long as any session holds a reference to it.
+	class ImageStore
+	{
+		private:
+
+			std::mutex mutex;
+			std::map<std::string, std::weak_ptr<const Image>> images;
+
+		public:
+
+			// Returns nullptr if the file can't be opened, or has been modified since it was opened for a session still holding it.
+			// May be called from any thread.
+			std::shared_ptr<const Image> Open(const std::string& filename);
+	};
+}
+
+#endif
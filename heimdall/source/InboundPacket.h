@@ -48,6 +48,13 @@ namespace Heimdall
 				return (value);
 			}
 
+			template <typename Field>
+			unsigned int UnpackField(void) const
+			{
+				static_assert(Field::kSize == 4, "Only integer fields are received.");
+				return (UnpackInteger(Field::kOffset));
+			}
+
 		public:
 
 			InboundPacket(unsigned int size, bool sizeVariable = false) : Packet(size)
@@ -21,18 +21,29 @@
 // C/C++ Standard Library
 #include <cstdarg>
 #include <cstdlib>
+#include <cstring>
 #include <stdio.h>
 
 // Heimdall
+#include "BatchAction.h"
+#include "CacheImageAction.h"
 #include "ClosePcScreenAction.h"
+#include "DaemonAction.h"
 #include "DetectAction.h"
+#include "DiffPitAction.h"
 #include "DownloadPitAction.h"
+#include "EstimateAction.h"
 #include "FlashAction.h"
 #include "HelpAction.h"
 #include "InfoAction.h"
 #include "Heimdall.h"
 #include "Interface.h"
+#include "PitInventoryAction.h"
+#include "PortHealthAction.h"
 #include "PrintPitAction.h"
+#include "Progress.h"
+#include "StationAction.h"
+#include "TuneAction.h"
 #include "VersionAction.h"
 
 using namespace std;
@@ -41,6 +52,16 @@ using namespace Heimdall;
 
 map<string, Interface::ActionInfo> actionMap;
 bool stdoutErrors = false;
+
+// Output is directed per thread, so that sessions embedded on different threads each receive their own output.
+
+// When set, these replace stdout and stderr respectively e.g. to direct output to a daemon's client.
+thread_local FILE *outputFile = nullptr;
+thread_local FILE *errorFile = nullptr;
+
+// When set, all output is passed to this function instead.
+thread_local Interface::OutputFunction outputFunction = nullptr;
+thread_local void *outputFunctionUserData = nullptr;
 		
 const char *version = "v1.4.2";
 const char *actionUsage = "Usage: heimdall <action> <action arguments>\n";
@@ -60,16 +81,66 @@ libusbx is licensed under the LGPL-2.1:\n\
 
 void populateActionMap(void)
 {
+	actionMap["batch"] = Interface::ActionInfo(&BatchAction::Execute, BatchAction::usage);
+	actionMap["cache-image"] = Interface::ActionInfo(&CacheImageAction::Execute, CacheImageAction::usage);
 	actionMap["close-pc-screen"] = Interface::ActionInfo(&ClosePcScreenAction::Execute, ClosePcScreenAction::usage);
+	actionMap["daemon"] = Interface::ActionInfo(&DaemonAction::Execute, DaemonAction::usage);
 	actionMap["detect"] = Interface::ActionInfo(&DetectAction::Execute, DetectAction::usage);
+	actionMap["diff-pit"] = Interface::ActionInfo(&DiffPitAction::Execute, DiffPitAction::usage);
 	actionMap["download-pit"] = Interface::ActionInfo(&DownloadPitAction::Execute, DownloadPitAction::usage);
+	actionMap["estimate"] = Interface::ActionInfo(&EstimateAction::Execute, EstimateAction::usage);
 	actionMap["flash"] = Interface::ActionInfo(&FlashAction::Execute, FlashAction::usage);
 	actionMap["help"] = Interface::ActionInfo(&HelpAction::Execute, HelpAction::usage);
 	actionMap["info"] = Interface::ActionInfo(&InfoAction::Execute, InfoAction::usage);
+	actionMap["pit-inventory"] = Interface::ActionInfo(&PitInventoryAction::Execute, PitInventoryAction::usage);
+	actionMap["port-health"] = Interface::ActionInfo(&PortHealthAction::Execute, PortHealthAction::usage);
 	actionMap["print-pit"] = Interface::ActionInfo(&PrintPitAction::Execute, PrintPitAction::usage);
+	actionMap["station"] = Interface::ActionInfo(&StationAction::Execute, StationAction::usage);
+	actionMap["tune"] = Interface::ActionInfo(&TuneAction::Execute, TuneAction::usage);
 	actionMap["version"] = Interface::ActionInfo(&VersionAction::Execute, VersionAction::usage);
 }
 
+static FILE *getOutputFile(void)
+{
+	return (outputFile ? outputFile : stdout);
+}
+
+static FILE *getErrorFile(void)
+{
+	return (errorFile ? errorFile : stderr);
+}
+
+static void printOutput(bool error, const char *prefix, const char *format, va_list args)
+{
+	if (outputFunction)
+	{
+		va_list lengthArgs;
+		va_copy(lengthArgs, args);
+		int length = vsnprintf(nullptr, 0, format, lengthArgs);
+		va_end(lengthArgs);
+
+		if (length < 0)
+			return;
+
+		size_t prefixLength = strlen(prefix);
+		char *text = new char[prefixLength + length + 1];
+
+		memcpy(text, prefix, prefixLength);
+		vsnprintf(text + prefixLength, length + 1, format, args);
+
+		outputFunction(text, error, outputFunctionUserData);
+
+		delete [] text;
+		return;
+	}
+
+	FILE *file = error ? getErrorFile() : getOutputFile();
+
+	fputs(prefix, file);
+	vfprintf(file, format, args);
+	fflush(file);
+}
+
 const map<string, Interface::ActionInfo>& Interface::GetActionMap(void)
 {
 	if (actionMap.size() == 0)
@@ -83,8 +154,7 @@ void Interface::Print(const char *format, ...)
 	va_list args;
 	va_start(args, format);
 
-	vfprintf(stdout, format, args);
-	fflush(stdout);
+	printOutput(false, "", format, args);
 
 	va_end(args);
 	
@@ -99,15 +169,11 @@ void Interface::PrintWarning(const char *format, ...)
 	{
 		va_list stdoutArgs;
 		va_copy(stdoutArgs, stderrArgs);
-		fprintf(stdout, "WARNING: ");
-		vfprintf(stdout, format, stdoutArgs);
-		fflush(stdout);
+		printOutput(false, "WARNING: ", format, stdoutArgs);
 		va_end(stdoutArgs);
 	}
 
-	fprintf(stderr, "WARNING: ");
-	vfprintf(stderr, format, stderrArgs);
-	fflush(stderr);
+	printOutput(true, "WARNING: ", format, stderrArgs);
 
 	va_end(stderrArgs);
 }
@@ -121,13 +187,11 @@ void Interface::PrintWarningSameLine(const char *format, ...)
 	{
 		va_list stdoutArgs;
 		va_copy(stdoutArgs, stderrArgs);
-		vfprintf(stdout, format, stdoutArgs);
-		fflush(stdout);
+		printOutput(false, "", format, stdoutArgs);
 		va_end(stdoutArgs);
 	}
 
-	vfprintf(stderr, format, stderrArgs);
-	fflush(stderr);
+	printOutput(true, "", format, stderrArgs);
 
 	va_end(stderrArgs);
 }
@@ -141,15 +205,28 @@ void Interface::PrintError(const char *format, ...)
 	{
 		va_list stdoutArgs;
 		va_copy(stdoutArgs, stderrArgs);
-		fprintf(stdout, "ERROR: ");
-		vfprintf(stdout, format, stdoutArgs);
-		fflush(stdout);
+		printOutput(false, "ERROR: ", format, stdoutArgs);
 		va_end(stdoutArgs);
 	}
 
-	fprintf(stderr, "ERROR: ");
-	vfprintf(stderr, format, stderrArgs);
-	fflush(stderr);
+	if (Progress::GetFormat() == Progress::kFormatJson || Progress::GetListener())
+	{
+		va_list progressArgs;
+		va_copy(progressArgs, stderrArgs);
+
+		char message[1024];
+		vsnprintf(message, sizeof(message), format, progressArgs);
+		va_end(progressArgs);
+
+		size_t length = strlen(message);
+
+		while (length > 0 && message[length - 1] == '\n')
+			message[--length] = '\0';
+
+		Progress::Error(message);
+	}
+
+	printOutput(true, "ERROR: ", format, stderrArgs);
 
 	va_end(stderrArgs);
 }
@@ -163,13 +240,11 @@ void Interface::PrintErrorSameLine(const char *format, ...)
 	{
 		va_list stdoutArgs;
 		va_copy(stdoutArgs, stderrArgs);
-		vfprintf(stdout, format, stdoutArgs);
-		fflush(stdout);
+		printOutput(false, "", format, stdoutArgs);
 		va_end(stdoutArgs);
 	}
 
-	vfprintf(stderr, format, stderrArgs);
-	fflush(stderr);
+	printOutput(true, "", format, stderrArgs);
 
 	va_end(stderrArgs);
 }
@@ -205,122 +280,236 @@ void Interface::PrintDeviceDetectionFailed(void)
 	Interface::PrintError("Failed to detect compatible download-mode device.\n");
 }
 
-void Interface::PrintPit(const PitData *pitData)
+// PitData and PitView share their getters, so they're printed by the same code.
+template <typename PitType>
+static void printPitHeader(const PitType *pit)
 {
-	Interface::Print("Entry Count: %d\n", pitData->GetEntryCount());
+	Interface::Print("Entry Count: %d\n", pit->GetEntryCount());
+
+	Interface::Print("Unknown 1: %d\n", pit->GetUnknown1());
+	Interface::Print("Unknown 2: %d\n", pit->GetUnknown2());
+	Interface::Print("Unknown 3: %d\n", pit->GetUnknown3());
+	Interface::Print("Unknown 4: %d\n", pit->GetUnknown4());
+	Interface::Print("Unknown 5: %d\n", pit->GetUnknown5());
+	Interface::Print("Unknown 6: %d\n", pit->GetUnknown6());
+	Interface::Print("Unknown 7: %d\n", pit->GetUnknown7());
+	Interface::Print("Unknown 8: %d\n", pit->GetUnknown8());
+}
 
-	Interface::Print("Unknown 1: %d\n", pitData->GetUnknown1());
-	Interface::Print("Unknown 2: %d\n", pitData->GetUnknown2());
-	Interface::Print("Unknown 3: %d\n", pitData->GetUnknown3());
-	Interface::Print("Unknown 4: %d\n", pitData->GetUnknown4());
-	Interface::Print("Unknown 5: %d\n", pitData->GetUnknown5());
-	Interface::Print("Unknown 6: %d\n", pitData->GetUnknown6());
-	Interface::Print("Unknown 7: %d\n", pitData->GetUnknown7());
-	Interface::Print("Unknown 8: %d\n", pitData->GetUnknown8());
+template <typename PitEntryType>
+static void printPitEntry(unsigned int index, const PitEntryType& entry)
+{
+	Interface::Print("\n\n--- Entry #%d ---\n", index);
+	Interface::Print("Binary Type: %d (", entry.GetBinaryType());
 
-	for (unsigned int i = 0; i < pitData->GetEntryCount(); i++)
+	switch (entry.GetBinaryType())
 	{
-		const PitEntry *entry = pitData->GetEntry(i);
+		case PitEntry::kBinaryTypeApplicationProcessor:
+			Interface::Print("AP");
+			break;
 
-		Interface::Print("\n\n--- Entry #%d ---\n", i);
-		Interface::Print("Binary Type: %d (", entry->GetBinaryType());
+		case PitEntry::kBinaryTypeCommunicationProcessor:
+			Interface::Print("CP");
+			break;
 
-		switch (entry->GetBinaryType())
-		{
-			case PitEntry::kBinaryTypeApplicationProcessor:
-				Interface::Print("AP");
-				break;
+		default:
+			Interface::Print("Unknown");
+			break;
+	}
 
-			case PitEntry::kBinaryTypeCommunicationProcessor:
-				Interface::Print("CP");
-				break;
+	Interface::Print(")\n");
 
-			default:
-				Interface::Print("Unknown");
-				break;
-		}
+	Interface::Print("Device Type: %d (", entry.GetDeviceType());
 
-		Interface::Print(")\n");
+	switch (entry.GetDeviceType())
+	{
+		case PitEntry::kDeviceTypeOneNand:
+			Interface::Print("OneNAND");
+			break;
 
-		Interface::Print("Device Type: %d (", entry->GetDeviceType());
+		case PitEntry::kDeviceTypeFile:
+			Interface::Print("File/FAT");
+			break;
 
-		switch (entry->GetDeviceType())
-		{
-			case PitEntry::kDeviceTypeOneNand:
-				Interface::Print("OneNAND");
-				break;
+		case PitEntry::kDeviceTypeMMC:
+			Interface::Print("MMC");
+			break;
 
-			case PitEntry::kDeviceTypeFile:
-				Interface::Print("File/FAT");
-				break;
+		case PitEntry::kDeviceTypeAll:
+			Interface::Print("All (?)");
+			break;
 
-			case PitEntry::kDeviceTypeMMC:
-				Interface::Print("MMC");
-				break;
+		default:
+			Interface::Print("Unknown");
+			break;
+	}
 
-			case PitEntry::kDeviceTypeAll:
-				Interface::Print("All (?)");
-				break;
+	Interface::Print(")\n");
 
-			default:
-				Interface::Print("Unknown");
-				break;
-		}
+	Interface::Print("Identifier: %d\n", entry.GetIdentifier());
 
-		Interface::Print(")\n");
-
-		Interface::Print("Identifier: %d\n", entry->GetIdentifier());
+	Interface::Print("Attributes: %d (", entry.GetAttributes());
 
-		Interface::Print("Attributes: %d (", entry->GetAttributes());
+	if (entry.GetAttributes() & PitEntry::kAttributeSTL)
+		Interface::Print("STL ");
 
-		if (entry->GetAttributes() & PitEntry::kAttributeSTL)
-			Interface::Print("STL ");
+	/*if (entry.GetAttributes() & PitEntry::kAttributeBML)
+		Interface::Print("BML ");*/
 
-		/*if (entry->GetAttributes() & PitEntry::kAttributeBML)
-			Interface::Print("BML ");*/
+	if (entry.GetAttributes() & PitEntry::kAttributeWrite)
+		Interface::Print("Read/Write");
+	else
+		Interface::Print("Read-Only");
 
-		if (entry->GetAttributes() & PitEntry::kAttributeWrite)
-			Interface::Print("Read/Write");
-		else
-			Interface::Print("Read-Only");
+	Interface::Print(")\n");
 
-		Interface::Print(")\n");
+	Interface::Print("Update Attributes: %d", entry.GetUpdateAttributes());
 
-		Interface::Print("Update Attributes: %d", entry->GetUpdateAttributes());
+	if (entry.GetUpdateAttributes())
+	{
+		Interface::Print(" (");
 
-		if (entry->GetUpdateAttributes())
+		if (entry.GetUpdateAttributes() & PitEntry::kUpdateAttributeFota)
 		{
-			Interface::Print(" (");
-
-			if (entry->GetUpdateAttributes() & PitEntry::kUpdateAttributeFota)
-			{
-				if (entry->GetUpdateAttributes() & PitEntry::kUpdateAttributeSecure)
-					Interface::Print("FOTA, Secure");
-				else
-					Interface::Print("FOTA");
-			}
+			if (entry.GetUpdateAttributes() & PitEntry::kUpdateAttributeSecure)
+				Interface::Print("FOTA, Secure");
 			else
-			{
-				if (entry->GetUpdateAttributes() & PitEntry::kUpdateAttributeSecure)
-					Interface::Print("Secure");
-			}
-
-			Interface::Print(")\n");
+				Interface::Print("FOTA");
 		}
 		else
 		{
-			Interface::Print("\n");
+			if (entry.GetUpdateAttributes() & PitEntry::kUpdateAttributeSecure)
+				Interface::Print("Secure");
 		}
 
-		Interface::Print("Partition Block Size/Offset: %d\n", entry->GetBlockSizeOrOffset());
-		Interface::Print("Partition Block Count: %d\n", entry->GetBlockCount());
+		Interface::Print(")\n");
+	}
+	else
+	{
+		Interface::Print("\n");
+	}
+
+	Interface::Print("Partition Block Size/Offset: %d\n", entry.GetBlockSizeOrOffset());
+	Interface::Print("Partition Block Count: %d\n", entry.GetBlockCount());
+
+	Interface::Print("File Offset (Obsolete): %d\n", entry.GetFileOffset());
+	Interface::Print("File Size (Obsolete): %d\n", entry.GetFileSize());
+
+	Interface::Print("Partition Name: %.*s\n", PitEntry::kPartitionNameMaxLength, entry.GetPartitionName());
+	Interface::Print("Flash Filename: %.*s\n", PitEntry::kFlashFilenameMaxLength, entry.GetFlashFilename());
+	Interface::Print("FOTA Filename: %.*s\n", PitEntry::kFotaFilenameMaxLength, entry.GetFotaFilename());
+}
+
+void Interface::PrintPit(const PitData *pitData)
+{
+	printPitHeader(pitData);
 
-		Interface::Print("File Offset (Obsolete): %d\n", entry->GetFileOffset());
-		Interface::Print("File Size (Obsolete): %d\n", entry->GetFileSize());
+	for (unsigned int i = 0; i < pitData->GetEntryCount(); i++)
+		printPitEntry(i, *pitData->GetEntry(i));
+
+	Interface::Print("\n");
+}
+
+void Interface::PrintPit(const PitView *pitView)
+{
+	printPitHeader(pitView);
+
+	for (unsigned int i = 0; i < pitView->GetEntryCount(); i++)
+		printPitEntry(i, pitView->GetEntry(i));
+
+	Interface::Print("\n");
+}
+
+static void printChangedHeaderField(const PitDiff *pitDiff, unsigned int field, const char *name, unsigned int value, unsigned int otherValue)
+{
+	if (pitDiff->GetChangedHeaderFields() & field)
+		Interface::Print("%s: %u -> %u\n", name, value, otherValue);
+}
+
+static void printChangedEntryField(const PitEntryDifference *difference, unsigned int field, const char *name, unsigned int value,
+	unsigned int otherValue)
+{
+	if (difference->GetChangedFields() & field)
+		Interface::Print("    %s: %u -> %u\n", name, value, otherValue);
+}
 
-		Interface::Print("Partition Name: %s\n", entry->GetPartitionName());
-		Interface::Print("Flash Filename: %s\n", entry->GetFlashFilename());
-		Interface::Print("FOTA Filename: %s\n", entry->GetFotaFilename());
+static void printChangedEntryField(const PitEntryDifference *difference, unsigned int field, const char *name, const char *value,
+	const char *otherValue)
+{
+	if (difference->GetChangedFields() & field)
+		Interface::Print("    %s: \"%s\" -> \"%s\"\n", name, value, otherValue);
+}
+
+void Interface::PrintPitDiff(const PitDiff *pitDiff, const PitData *pitData, const PitData *otherPitData, const char *pitName,
+	const char *otherPitName)
+{
+	Interface::Print("Comparing %s PIT with %s PIT:\n", pitName, otherPitName);
+
+	if (pitDiff->IsEmpty())
+	{
+		Interface::Print("No differences.\n\n");
+		return;
+	}
+
+	printChangedHeaderField(pitDiff, PitDiff::kHeaderFieldEntryCount, "Entry Count", pitData->GetEntryCount(), otherPitData->GetEntryCount());
+	printChangedHeaderField(pitDiff, PitDiff::kHeaderFieldUnknown1, "Unknown 1", pitData->GetUnknown1(), otherPitData->GetUnknown1());
+	printChangedHeaderField(pitDiff, PitDiff::kHeaderFieldUnknown2, "Unknown 2", pitData->GetUnknown2(), otherPitData->GetUnknown2());
+	printChangedHeaderField(pitDiff, PitDiff::kHeaderFieldUnknown3, "Unknown 3", pitData->GetUnknown3(), otherPitData->GetUnknown3());
+	printChangedHeaderField(pitDiff, PitDiff::kHeaderFieldUnknown4, "Unknown 4", pitData->GetUnknown4(), otherPitData->GetUnknown4());
+	printChangedHeaderField(pitDiff, PitDiff::kHeaderFieldUnknown5, "Unknown 5", pitData->GetUnknown5(), otherPitData->GetUnknown5());
+	printChangedHeaderField(pitDiff, PitDiff::kHeaderFieldUnknown6, "Unknown 6", pitData->GetUnknown6(), otherPitData->GetUnknown6());
+	printChangedHeaderField(pitDiff, PitDiff::kHeaderFieldUnknown7, "Unknown 7", pitData->GetUnknown7(), otherPitData->GetUnknown7());
+	printChangedHeaderField(pitDiff, PitDiff::kHeaderFieldUnknown8, "Unknown 8", pitData->GetUnknown8(), otherPitData->GetUnknown8());
+
+	for (unsigned int i = 0; i < pitDiff->GetEntryDifferenceCount(); i++)
+	{
+		const PitEntryDifference *difference = pitDiff->GetEntryDifference(i);
+		const PitEntry *entry = difference->GetEntry();
+		const PitEntry *otherEntry = difference->GetOtherEntry();
+
+		switch (difference->GetType())
+		{
+			case PitEntryDifference::kTypeAdded:
+				Interface::Print("Entry #%u (Identifier: %u, Partition Name: \"%s\") only in %s PIT\n", difference->GetOtherIndex(),
+					otherEntry->GetIdentifier(), otherEntry->GetPartitionName(), otherPitName);
+				break;
+
+			case PitEntryDifference::kTypeRemoved:
+				Interface::Print("Entry #%u (Identifier: %u, Partition Name: \"%s\") only in %s PIT\n", difference->GetIndex(),
+					entry->GetIdentifier(), entry->GetPartitionName(), pitName);
+				break;
+
+			case PitEntryDifference::kTypeChanged:
+				Interface::Print("Entry #%u (Identifier: %u, Partition Name: \"%s\") changed:\n", difference->GetIndex(),
+					entry->GetIdentifier(), entry->GetPartitionName());
+
+				printChangedEntryField(difference, PitEntryDifference::kFieldIndex, "Entry", difference->GetIndex(), difference->GetOtherIndex());
+				printChangedEntryField(difference, PitEntryDifference::kFieldIdentifier, "Identifier", entry->GetIdentifier(),
+					otherEntry->GetIdentifier());
+				printChangedEntryField(difference, PitEntryDifference::kFieldBinaryType, "Binary Type", entry->GetBinaryType(),
+					otherEntry->GetBinaryType());
+				printChangedEntryField(difference, PitEntryDifference::kFieldDeviceType, "Device Type", entry->GetDeviceType(),
+					otherEntry->GetDeviceType());
+				printChangedEntryField(difference, PitEntryDifference::kFieldAttributes, "Attributes", entry->GetAttributes(),
+					otherEntry->GetAttributes());
+				printChangedEntryField(difference, PitEntryDifference::kFieldUpdateAttributes, "Update Attributes",
+					entry->GetUpdateAttributes(), otherEntry->GetUpdateAttributes());
+				printChangedEntryField(difference, PitEntryDifference::kFieldBlockSizeOrOffset, "Partition Block Size/Offset",
+					entry->GetBlockSizeOrOffset(), otherEntry->GetBlockSizeOrOffset());
+				printChangedEntryField(difference, PitEntryDifference::kFieldBlockCount, "Partition Block Count", entry->GetBlockCount(),
+					otherEntry->GetBlockCount());
+				printChangedEntryField(difference, PitEntryDifference::kFieldFileOffset, "File Offset (Obsolete)", entry->GetFileOffset(),
+					otherEntry->GetFileOffset());
+				printChangedEntryField(difference, PitEntryDifference::kFieldFileSize, "File Size (Obsolete)", entry->GetFileSize(),
+					otherEntry->GetFileSize());
+				printChangedEntryField(difference, PitEntryDifference::kFieldPartitionName, "Partition Name", entry->GetPartitionName(),
+					otherEntry->GetPartitionName());
+				printChangedEntryField(difference, PitEntryDifference::kFieldFlashFilename, "Flash Filename", entry->GetFlashFilename(),
+					otherEntry->GetFlashFilename());
+				printChangedEntryField(difference, PitEntryDifference::kFieldFotaFilename, "FOTA Filename", entry->GetFotaFilename(),
+					otherEntry->GetFotaFilename());
+				break;
+		}
 	}
 
 	Interface::Print("\n");
@@ -330,3 +519,21 @@ void Interface::SetStdoutErrors(bool enabled)
 {
 	stdoutErrors = enabled;
 }
+
+void Interface::SetOutputFiles(FILE *outputFile, FILE *errorFile)
+{
+	::outputFile = outputFile;
+	::errorFile = errorFile;
+}
+
+void Interface::SetOutputFunction(OutputFunction outputFunction, void *userData)
+{
+	::outputFunction = outputFunction;
+	outputFunctionUserData = userData;
+}
+
+void Interface::GetOutputFunction(OutputFunction& outputFunction, void *& userData)
+{
+	outputFunction = ::outputFunction;
+	userData = outputFunctionUserData;
+}
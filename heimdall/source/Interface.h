@@ -23,6 +23,7 @@
 
 // C/C++ Standard Library
 #include <map>
+#include <stdio.h>
 #include <string>
 
 // libpit
@@ -36,6 +37,7 @@ namespace Heimdall
 	namespace Interface
 	{
 		typedef int (*ActionExecuteFunction)(int, char **);
+		typedef void (*OutputFunction)(const char *text, bool error, void *userData);
 
 		typedef struct ActionInfo
 		{
@@ -72,8 +74,19 @@ namespace Heimdall
 		void PrintDeviceDetectionFailed(void);
 
 		void PrintPit(const libpit::PitData *pitData);
+		void PrintPit(const libpit::PitView *pitView);
+		void PrintPitDiff(const libpit::PitDiff *pitDiff, const libpit::PitData *pitData, const libpit::PitData *otherPitData,
+			const char *pitName, const char *otherPitName);
 
 		void SetStdoutErrors(bool enabled);
+
+		// Redirects the calling thread's output away from stdout and stderr. Passing nullptr restores the default.
+		void SetOutputFiles(FILE *outputFile, FILE *errorFile);
+
+		// Delivers the calling thread's output to a function instead of any file e.g. when Heimdall is embedded in another
+		// application. Passing nullptr restores output to files.
+		void SetOutputFunction(OutputFunction outputFunction, void *userData);
+		void GetOutputFunction(OutputFunction& outputFunction, void *& userData);
 	}
 }
 
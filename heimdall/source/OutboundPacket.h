@@ -58,6 +58,15 @@ namespace Heimdall
 #endif
 			}
 
+			template <typename Field>
+			void PackField(unsigned int value)
+			{
+				if (Field::kSize == 2)
+					PackShort(Field::kOffset, value);
+				else
+					PackInteger(Field::kOffset, value);
+			}
+
 		public:
 
 			OutboundPacket(unsigned int size) : Packet(size)
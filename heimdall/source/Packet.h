@@ -26,6 +26,30 @@
 
 namespace Heimdall
 {
+	// A little-endian integer field at a fixed offset within a packet of PacketSize bytes. Offsets are checked against
+	// the packet size when the field is first used, so a misplaced field fails to compile rather than corrupting data.
+	template <unsigned int PacketSize, unsigned int Offset, unsigned int Size = 4>
+	struct PacketField
+	{
+		static_assert(Size == 2 || Size == 4, "Packet fields must be 2 or 4 bytes in size.");
+		static_assert(Offset + Size <= PacketSize, "Packet field lies outside of the packet.");
+
+		enum
+		{
+			kPacketSize = PacketSize,
+			kOffset = Offset,
+			kSize = Size,
+			kEnd = Offset + Size
+		};
+	};
+
+	// The field immediately following PreviousField. Layouts are declared as a chain of these, so each offset is
+	// written down exactly once.
+	template <typename PreviousField, unsigned int Size = 4>
+	struct NextPacketField : public PacketField<PreviousField::kPacketSize, PreviousField::kEnd, Size>
+	{
+	};
+
 	class Packet
 	{
 		private:
@@ -34,21 +58,19 @@ namespace Heimdall
 
 		protected:
 
+			// Provided by the derived class. Fixed size packets hold their data inline, only file parts use the heap.
 			unsigned char *data;
 
-		public:
-
 			Packet(unsigned int size)
 			{
 				this->size = size;
-				data = new unsigned char[size];
-				memset(data, 0, size);
+				data = nullptr;
 			}
 
-			~Packet()
-			{
-				delete [] data;
-			}
+		public:
+
+			Packet(const Packet&) = delete;
+			Packet& operator=(const Packet&) = delete;
 
 			unsigned int GetSize(void) const
 			{
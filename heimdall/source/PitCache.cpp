@@ -0,0 +1,134 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <cerrno>
+#include <cstdio>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+// Heimdall
+#include "Heimdall.h"
+#include "PitCache.h"
+
+using namespace std;
+using namespace Heimdall;
+
+PitCache::PitCache(const string& directory)
+{
+	this->directory = directory;
+}
+
+string PitCache::GetFilename(const string& serialNumber) const
+{
+	// Serial numbers come from the device, so don't let them escape the cache directory.
+	string filename = serialNumber;
+
+	for (string::iterator it = filename.begin(); it != filename.end(); it++)
+	{
+		if (!((*it >= 'A' && *it <= 'Z') || (*it >= 'a' && *it <= 'z') || (*it >= '0' && *it <= '9') || *it == '-' || *it == '_'))
+			*it = '_';
+	}
+
+	return (directory + "/" + filename + ".pit");
+}
+
+bool PitCache::Initialise(void) const
+{
+#ifdef _WIN32
+	int result = _mkdir(directory.c_str());
+#else
+	int result = mkdir(directory.c_str(), 0755);
+#endif
+
+	return (result == 0 || errno == EEXIST);
+}
+
+unsigned int PitCache::Load(const string& serialNumber, unsigned char **pitBuffer) const
+{
+	*pitBuffer = nullptr;
+
+	FILE *file = FileOpen(GetFilename(serialNumber).c_str(), "rb");
+
+	if (!file)
+		return (0);
+
+	FileSeek(file, 0, SEEK_END);
+	long long fileSize = FileTell(file);
+	FileRewind(file);
+
+	if (fileSize <= 0 || fileSize > 0xFFFFFFFFLL)
+	{
+		FileClose(file);
+		return (0);
+	}
+
+	unsigned char *buffer = new unsigned char[fileSize];
+
+	if (fread(buffer, 1, fileSize, file) != (size_t)fileSize)
+	{
+		delete [] buffer;
+		FileClose(file);
+		return (0);
+	}
+
+	FileClose(file);
+
+	*pitBuffer = buffer;
+	return ((unsigned int)fileSize);
+}
+
+bool PitCache::Store(const string& serialNumber, const unsigned char *pitBuffer, unsigned int pitBufferSize) const
+{
+	string filename = GetFilename(serialNumber);
+	string temporaryFilename = filename + ".tmp";
+
+	// Write then rename, so that an interrupted write never leaves a truncated PIT in the cache.
+	FILE *file = FileOpen(temporaryFilename.c_str(), "wb");
+
+	if (!file)
+		return (false);
+
+	bool success = fwrite(pitBuffer, 1, pitBufferSize, file) == pitBufferSize;
+
+	if (FileClose(file) != 0)
+		success = false;
+
+	if (success)
+	{
+#ifdef _WIN32
+		remove(filename.c_str());
+#endif
+		success = rename(temporaryFilename.c_str(), filename.c_str()) == 0;
+	}
+
+	if (!success)
+		remove(temporaryFilename.c_str());
+
+	return (success);
+}
+
+void PitCache::Remove(const string& serialNumber) const
+{
+	remove(GetFilename(serialNumber).c_str());
+}
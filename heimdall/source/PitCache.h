@@ -0,0 +1,56 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef PITCACHE_H
+#define PITCACHE_H
+
+// C/C++ Standard Library
+#include <string>
+
+// Heimdall
+#include "Heimdall.h"
+
+namespace Heimdall
+{
+	// On-disk cache of device PIT files, keyed by USB serial number.
+	class PitCache
+	{
+		private:
+
+			std::string directory;
+
+			std::string GetFilename(const std::string& serialNumber) const;
+
+		public:
+
+			PitCache(const std::string& directory);
+
+			// Creates the cache directory if it doesn't already exist.
+			bool Initialise(void) const;
+
+			// Returns the size of the cached PIT file, or 0 if there isn't one. The caller must delete [] the buffer.
+			unsigned int Load(const std::string& serialNumber, unsigned char **pitBuffer) const;
+
+			bool Store(const std::string& serialNumber, const unsigned char *pitBuffer, unsigned int pitBufferSize) const;
+			void Remove(const std::string& serialNumber) const;
+	};
+}
+
+#endif
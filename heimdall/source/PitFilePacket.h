@@ -40,10 +40,7 @@ namespace Heimdall
 
 		protected:
 
-			enum
-			{
-				kDataSize = ControlPacket::kDataSize + 4
-			};
+			typedef NextPacketField<ControlPacket::ControlTypeField> RequestField;
 
 		private:
 
@@ -65,7 +62,7 @@ namespace Heimdall
 			{
 				ControlPacket::Pack();
 
-				PackInteger(ControlPacket::kDataSize, request);
+				PackField<RequestField>(request);
 			}
 	};
 }
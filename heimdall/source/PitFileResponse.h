@@ -48,7 +48,7 @@ namespace Heimdall
 				if (!ResponsePacket::Unpack())
 					return (false);
 
-				fileSize = UnpackInteger(ResponsePacket::kDataSize);
+				fileSize = UnpackField<ValueField>();
 
 				return (true);
 			}
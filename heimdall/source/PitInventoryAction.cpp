@@ -0,0 +1,493 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#undef GetBinaryType
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+// libpit
+#include "libpit.h"
+
+// Heimdall
+#include "Arguments.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "PitInventoryAction.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace libpit;
+using namespace Heimdall;
+
+const char *PitInventoryAction::usage = "Action: pit-inventory\n\
+Arguments: --directory <directory> --output <filename> [--format <csv/json>]\n\
+    [--threads <count>] [--stdout-errors]\n\
+Description: Scans a directory tree for PIT files, in parallel, and writes one\n\
+    record per partition to the output file, as CSV (default) or JSON lines.\n\
+    Afterwards, statistics are printed for the whole tree, including the\n\
+    number of distinct layouts per model and the distribution of each\n\
+    partition's block count.\n\
+Note: A PIT file's model is the name of the directory containing it. Files\n\
+      that aren't PIT files are skipped.\n";
+
+enum
+{
+	kOutputFormatCsv = 0,
+	kOutputFormatJson
+};
+
+struct ModelStatistics
+{
+	unsigned int pitFileCount;
+	set<unsigned long long> layouts;
+
+	ModelStatistics()
+	{
+		pitFileCount = 0;
+	}
+};
+
+struct InventoryStatistics
+{
+	unsigned int pitFileCount;
+	unsigned int skippedFileCount;
+
+	map<string, ModelStatistics> models;
+	map<string, vector<unsigned int> > partitionBlockCounts;
+
+	InventoryStatistics()
+	{
+		pitFileCount = 0;
+		skippedFileCount = 0;
+	}
+};
+
+struct InventoryContext
+{
+	const vector<string> *filenames;
+	unsigned int rootLength;
+	int format;
+
+	FILE *outputFile;
+	bool outputFailed;
+
+	atomic<unsigned int> nextFileIndex;
+
+	// Guards outputFile, outputFailed and statistics.
+	mutex inventoryMutex;
+	InventoryStatistics statistics;
+};
+
+static void findFiles(const string& directory, vector<string>& filenames)
+{
+#ifdef _WIN32
+
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA((directory + "\\*").c_str(), &findData);
+
+	if (findHandle == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if (strcmp(findData.cFileName, ".") == 0 || strcmp(findData.cFileName, "..") == 0)
+			continue;
+
+		string path = directory + "/" + findData.cFileName;
+
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+			continue;
+
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			findFiles(path, filenames);
+		else
+			filenames.push_back(path);
+	} while (FindNextFileA(findHandle, &findData));
+
+	FindClose(findHandle);
+
+#else
+
+	DIR *dir = opendir(directory.c_str());
+
+	if (!dir)
+		return;
+
+	struct dirent *entry;
+
+	while ((entry = readdir(dir)) != nullptr)
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+
+		string path = directory + "/" + entry->d_name;
+		struct stat pathStatus;
+
+		// Don't follow symbolic links, they could lead us in circles.
+		if (lstat(path.c_str(), &pathStatus) != 0)
+			continue;
+
+		if (S_ISDIR(pathStatus.st_mode))
+			findFiles(path, filenames);
+		else if (S_ISREG(pathStatus.st_mode))
+			filenames.push_back(path);
+	}
+
+	closedir(dir);
+
+#endif
+}
+
+static string getModel(const string& relativePath)
+{
+	size_t separator = relativePath.find_last_of('/');
+
+	if (separator == string::npos)
+		return (string());
+
+	size_t previousSeparator = (separator > 0) ? relativePath.find_last_of('/', separator - 1) : string::npos;
+	size_t modelStart = (previousSeparator == string::npos) ? 0 : previousSeparator + 1;
+
+	return (relativePath.substr(modelStart, separator - modelStart));
+}
+
+// PIT names needn't be terminated.
+static string getName(const char *name, unsigned int maxLength)
+{
+	const void *terminator = memchr(name, '\0', maxLength);
+	return (string(name, terminator ? (const char *)terminator - name : maxLength));
+}
+
+static unsigned long long getLayout(const PitView& pitView, const unsigned char *data)
+{
+	// FNV-1a over the header and entries, ignoring any padding.
+	unsigned long long layout = 14695981039346656037ULL;
+
+	for (unsigned int i = 0; i < pitView.GetDataSize(); i++)
+		layout = (layout ^ data[i]) * 1099511628211ULL;
+
+	return (layout);
+}
+
+static void appendCsvValue(string& record, const string& value)
+{
+	if (value.find_first_of(",\"\r\n") == string::npos)
+	{
+		record += value;
+		return;
+	}
+
+	record += '"';
+
+	for (string::const_iterator it = value.begin(); it != value.end(); it++)
+	{
+		if (*it == '"')
+			record += '"';
+
+		record += *it;
+	}
+
+	record += '"';
+}
+
+static void appendRecord(string& records, int format, const string& relativePath, const string& model, unsigned int index,
+	const PitEntryView& entry, unsigned long long layout)
+{
+	char numbers[160];
+	string partitionName = getName(entry.GetPartitionName(), PitEntry::kPartitionNameMaxLength);
+	string flashFilename = getName(entry.GetFlashFilename(), PitEntry::kFlashFilenameMaxLength);
+
+	if (format == kOutputFormatCsv)
+	{
+		appendCsvValue(records, relativePath);
+		records += ',';
+		appendCsvValue(records, model);
+
+		sprintf(numbers, ",%u,%u,", index, entry.GetIdentifier());
+		records += numbers;
+
+		appendCsvValue(records, partitionName);
+		records += ',';
+		appendCsvValue(records, flashFilename);
+
+		sprintf(numbers, ",%u,%u,%u,%u,%u,%u,%016llx\n", entry.GetBinaryType(), entry.GetDeviceType(), entry.GetAttributes(),
+			entry.GetUpdateAttributes(), entry.GetBlockSizeOrOffset(), entry.GetBlockCount(), layout);
+		records += numbers;
+	}
+	else
+	{
+		records += "{\"file\":";
+		Utility::AppendJsonString(records, relativePath);
+		records += ",\"model\":";
+		Utility::AppendJsonString(records, model);
+
+		sprintf(numbers, ",\"entry\":%u,\"identifier\":%u,\"partitionName\":", index, entry.GetIdentifier());
+		records += numbers;
+
+		Utility::AppendJsonString(records, partitionName);
+		records += ",\"flashFilename\":";
+		Utility::AppendJsonString(records, flashFilename);
+
+		sprintf(numbers, ",\"binaryType\":%u,\"deviceType\":%u,\"attributes\":%u,\"updateAttributes\":%u,\"blockSizeOrOffset\":%u,"
+			"\"blockCount\":%u,\"layout\":\"%016llx\"}\n", entry.GetBinaryType(), entry.GetDeviceType(), entry.GetAttributes(),
+			entry.GetUpdateAttributes(), entry.GetBlockSizeOrOffset(), entry.GetBlockCount(), layout);
+		records += numbers;
+	}
+}
+
+static void inventoryWorker(InventoryContext *context)
+{
+	string records;
+
+	for (;;)
+	{
+		unsigned int fileIndex = context->nextFileIndex++;
+
+		if (fileIndex >= context->filenames->size())
+			break;
+
+		const string& filename = (*context->filenames)[fileIndex];
+		string relativePath = filename.substr(context->rootLength);
+
+		PitFileMapping pitFileMapping;
+		PitView pitView;
+
+		if (!pitFileMapping.Open(filename.c_str()) || !pitView.Open(pitFileMapping.GetData(), pitFileMapping.GetSize()))
+		{
+			lock_guard<mutex> lock(context->inventoryMutex);
+			context->statistics.skippedFileCount++;
+			continue;
+		}
+
+		// Format records without holding the lock, so workers only contend for the output itself.
+		string model = getModel(relativePath);
+		unsigned long long layout = getLayout(pitView, pitFileMapping.GetData());
+
+		records.clear();
+
+		for (unsigned int i = 0; i < pitView.GetEntryCount(); i++)
+			appendRecord(records, context->format, relativePath, model, i, pitView.GetEntry(i), layout);
+
+		lock_guard<mutex> lock(context->inventoryMutex);
+
+		if (!context->outputFailed && fwrite(records.data(), 1, records.size(), context->outputFile) != records.size())
+			context->outputFailed = true;
+
+		InventoryStatistics& statistics = context->statistics;
+		statistics.pitFileCount++;
+
+		ModelStatistics& modelStatistics = statistics.models[model];
+		modelStatistics.pitFileCount++;
+		modelStatistics.layouts.insert(layout);
+
+		for (unsigned int i = 0; i < pitView.GetEntryCount(); i++)
+		{
+			PitEntryView entry = pitView.GetEntry(i);
+
+			if (entry.IsFlashable())
+			{
+				string partitionName = getName(entry.GetPartitionName(), PitEntry::kPartitionNameMaxLength);
+				statistics.partitionBlockCounts[partitionName].push_back(entry.GetBlockCount());
+			}
+		}
+	}
+}
+
+static void printStatistics(InventoryStatistics& statistics)
+{
+	Interface::Print("PIT files: %u\n", statistics.pitFileCount);
+	Interface::Print("Skipped files: %u\n\n", statistics.skippedFileCount);
+
+	Interface::Print("--- Models ---\n");
+
+	for (map<string, ModelStatistics>::const_iterator it = statistics.models.begin(); it != statistics.models.end(); it++)
+	{
+		Interface::Print("%s: %u PIT files, %u distinct layouts\n", it->first.empty() ? "(none)" : it->first.c_str(),
+			it->second.pitFileCount, (unsigned int)it->second.layouts.size());
+	}
+
+	Interface::Print("\n--- Partition Block Counts ---\n");
+
+	for (map<string, vector<unsigned int> >::iterator it = statistics.partitionBlockCounts.begin(); it != statistics.partitionBlockCounts.end(); it++)
+	{
+		vector<unsigned int>& blockCounts = it->second;
+		sort(blockCounts.begin(), blockCounts.end());
+
+		unsigned long long total = 0;
+		unsigned int distinctCount = 0;
+
+		for (unsigned int i = 0; i < blockCounts.size(); i++)
+		{
+			total += blockCounts[i];
+
+			if (i == 0 || blockCounts[i] != blockCounts[i - 1])
+				distinctCount++;
+		}
+
+		Interface::Print("%s: %u entries, %u distinct, min %u, median %u, max %u, mean %llu\n", it->first.c_str(),
+			(unsigned int)blockCounts.size(), distinctCount, blockCounts.front(), blockCounts[blockCounts.size() / 2], blockCounts.back(),
+			total / blockCounts.size());
+	}
+
+	Interface::Print("\n");
+}
+
+int PitInventoryAction::Execute(int argc, char **argv)
+{
+	// Handle arguments
+
+	map<string, ArgumentType> argumentTypes;
+	argumentTypes["directory"] = kArgumentTypeString;
+	argumentTypes["output"] = kArgumentTypeString;
+	argumentTypes["format"] = kArgumentTypeString;
+	argumentTypes["threads"] = kArgumentTypeUnsignedInteger;
+	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+
+	Arguments arguments(argumentTypes);
+
+	if (!arguments.ParseArguments(argc, argv, 2))
+	{
+		Interface::Print(PitInventoryAction::usage);
+		return (0);
+	}
+
+	const StringArgument *directoryArgument = static_cast<const StringArgument *>(arguments.GetArgument("directory"));
+	const StringArgument *outputArgument = static_cast<const StringArgument *>(arguments.GetArgument("output"));
+	const StringArgument *formatArgument = static_cast<const StringArgument *>(arguments.GetArgument("format"));
+	const UnsignedIntegerArgument *threadsArgument = static_cast<const UnsignedIntegerArgument *>(arguments.GetArgument("threads"));
+
+	if (!directoryArgument || !outputArgument)
+	{
+		Interface::Print("Both a directory and an output file must be specified.\n\n");
+		Interface::Print(PitInventoryAction::usage);
+		return (0);
+	}
+
+	if (arguments.GetArgument("stdout-errors") != nullptr)
+		Interface::SetStdoutErrors(true);
+
+	int format = kOutputFormatCsv;
+
+	if (formatArgument)
+	{
+		const string& formatString = formatArgument->GetValue();
+
+		if (formatString.compare("csv") == 0 || formatString.compare("CSV") == 0)
+		{
+			format = kOutputFormatCsv;
+		}
+		else if (formatString.compare("json") == 0 || formatString.compare("JSON") == 0)
+		{
+			format = kOutputFormatJson;
+		}
+		else
+		{
+			Interface::Print("Unknown output format: %s\n\n", formatString.c_str());
+			Interface::Print(PitInventoryAction::usage);
+			return (0);
+		}
+	}
+
+	unsigned int threadCount = threadsArgument ? threadsArgument->GetValue() : thread::hardware_concurrency();
+
+	if (threadCount == 0)
+		threadCount = 1;
+
+	// Find files
+
+	string directory = directoryArgument->GetValue();
+
+	while (directory.size() > 1 && (directory[directory.size() - 1] == '/' || directory[directory.size() - 1] == '\\'))
+		directory.erase(directory.size() - 1);
+
+	vector<string> filenames;
+	findFiles(directory, filenames);
+
+	if (filenames.empty())
+	{
+		Interface::PrintError("No files found in directory \"%s\"\n", directory.c_str());
+		return (1);
+	}
+
+	sort(filenames.begin(), filenames.end());
+
+	FILE *outputFile = FileOpen(outputArgument->GetValue().c_str(), "wb");
+
+	if (!outputFile)
+	{
+		Interface::PrintError("Failed to open output file \"%s\"\n", outputArgument->GetValue().c_str());
+		return (1);
+	}
+
+	if (format == kOutputFormatCsv)
+	{
+		fputs("file,model,entry,identifier,partition_name,flash_filename,binary_type,device_type,attributes,update_attributes,"
+			"block_size_or_offset,block_count,layout\n", outputFile);
+	}
+
+	// Scan files
+
+	Interface::Print("Scanning %u files with %u threads...\n\n", (unsigned int)filenames.size(), threadCount);
+
+	InventoryContext context;
+	context.filenames = &filenames;
+	context.rootLength = directory.size() + 1;
+	context.format = format;
+	context.outputFile = outputFile;
+	context.outputFailed = false;
+	context.nextFileIndex = 0;
+
+	vector<thread> threads;
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		threads.push_back(thread(inventoryWorker, &context));
+
+	for (unsigned int i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	if (FileClose(outputFile) != 0)
+		context.outputFailed = true;
+
+	if (context.outputFailed)
+	{
+		Interface::PrintError("Failed to write to output file \"%s\"\n", outputArgument->GetValue().c_str());
+		return (1);
+	}
+
+	printStatistics(context.statistics);
+
+	return (0);
+}
@@ -0,0 +1,328 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <algorithm>
+#include <map>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Heimdall
+#include "Arguments.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "PortHealthAction.h"
+#include "ThroughputHistory.h"
+
+using namespace std;
+using namespace Heimdall;
+
+const char *PortHealthAction::usage = "Action: port-health\n\
+Arguments: --history <filename> [--sessions <count>] [--min-sessions <count>]\n\
+    [--stdout-errors]\n\
+Description: Reports the health of each USB port (i.e. bus and port path) in a\n\
+    throughput history recorded by the station action, from its most recent\n\
+    --sessions (default 20) sessions. A port is flagged as degraded if:\n\
+      slow      Its throughput is below 75% of that of the typical port, for\n\
+                the same device models.\n\
+      errors    More than 1% of its USB transfers failed or timed out.\n\
+      failures  More than 25% of its sessions, and at least 2, failed.\n\
+Note: Ports with fewer than --min-sessions (default 3) sessions aren't judged.\n\
+      Throughput can't be judged until a device model has been flashed on at\n\
+      least two ports.\n\
+Note: Devices attached through libusb versions that can't report port numbers\n\
+      are identified by bus and device address, which change whenever a device\n\
+      is reconnected.\n";
+
+enum
+{
+	kDefaultSessionCount = 20,
+	kDefaultMinSessionCount = 3
+};
+
+struct TransferTotals
+{
+	unsigned long long bytes;
+	unsigned long long milliseconds;
+
+	TransferTotals()
+	{
+		bytes = 0;
+		milliseconds = 0;
+	}
+};
+
+struct PortHealth
+{
+	unsigned int sessionCount;
+	unsigned int failedSessionCount;
+
+	unsigned int transferCount;
+	unsigned int retryCount;
+	unsigned int timeoutCount;
+	unsigned int errorCount;
+	map<int, unsigned int> errorCounts;
+
+	TransferTotals totals;
+	map<string, TransferTotals> modelTotals;
+
+	PortHealth()
+	{
+		sessionCount = 0;
+		failedSessionCount = 0;
+
+		transferCount = 0;
+		retryCount = 0;
+		timeoutCount = 0;
+		errorCount = 0;
+	}
+};
+
+static void addSession(PortHealth& portHealth, const ThroughputSession& session)
+{
+	portHealth.sessionCount++;
+
+	if (!session.success)
+		portHealth.failedSessionCount++;
+
+	const UsbStatistics& usbStatistics = session.usbStatistics;
+
+	portHealth.transferCount += usbStatistics.transferCount;
+	portHealth.retryCount += usbStatistics.retryCount + usbStatistics.filePartRetryCount;
+	portHealth.timeoutCount += usbStatistics.timeoutCount;
+
+	for (map<int, unsigned int>::const_iterator it = usbStatistics.errorCounts.begin(); it != usbStatistics.errorCounts.end(); it++)
+	{
+		portHealth.errorCount += it->second;
+		portHealth.errorCounts[it->first] += it->second;
+	}
+
+	TransferTotals& modelTotals = portHealth.modelTotals[session.model];
+
+	for (vector<ThroughputTransfer>::const_iterator it = session.transfers.begin(); it != session.transfers.end(); it++)
+	{
+		portHealth.totals.bytes += it->bytes;
+		portHealth.totals.milliseconds += it->milliseconds;
+
+		modelTotals.bytes += it->bytes;
+		modelTotals.milliseconds += it->milliseconds;
+	}
+}
+
+// The median of each port's throughput (in bytes per millisecond) for each model flashed on at least two ports.
+static map<string, double> getTypicalThroughputs(const map<string, PortHealth>& ports)
+{
+	map<string, vector<double> > modelThroughputs;
+
+	for (map<string, PortHealth>::const_iterator port = ports.begin(); port != ports.end(); port++)
+	{
+		for (map<string, TransferTotals>::const_iterator model = port->second.modelTotals.begin();
+			model != port->second.modelTotals.end(); model++)
+		{
+			if (model->second.milliseconds > 0)
+				modelThroughputs[model->first].push_back((double)model->second.bytes / model->second.milliseconds);
+		}
+	}
+
+	map<string, double> typicalThroughputs;
+
+	for (map<string, vector<double> >::iterator it = modelThroughputs.begin(); it != modelThroughputs.end(); it++)
+	{
+		if (it->second.size() < 2)
+			continue;
+
+		sort(it->second.begin(), it->second.end());
+		typicalThroughputs[it->first] = it->second[it->second.size() / 2];
+	}
+
+	return (typicalThroughputs);
+}
+
+// The port's throughput relative to the typical port's, for the same models. Returns false if it can't be judged.
+static bool getRelativeThroughput(const PortHealth& portHealth, const map<string, double>& typicalThroughputs, double& relativeThroughput)
+{
+	double expectedMilliseconds = 0.0;
+	unsigned long long milliseconds = 0;
+
+	for (map<string, TransferTotals>::const_iterator model = portHealth.modelTotals.begin(); model != portHealth.modelTotals.end();
+		model++)
+	{
+		map<string, double>::const_iterator typicalThroughput = typicalThroughputs.find(model->first);
+
+		if (typicalThroughput == typicalThroughputs.end() || model->second.milliseconds == 0)
+			continue;
+
+		expectedMilliseconds += model->second.bytes / typicalThroughput->second;
+		milliseconds += model->second.milliseconds;
+	}
+
+	if (milliseconds == 0)
+		return (false);
+
+	relativeThroughput = expectedMilliseconds / milliseconds;
+	return (true);
+}
+
+int PortHealthAction::Execute(int argc, char **argv)
+{
+	// Handle arguments
+
+	map<string, ArgumentType> argumentTypes;
+	argumentTypes["history"] = kArgumentTypeString;
+	argumentTypes["sessions"] = kArgumentTypeUnsignedInteger;
+	argumentTypes["min-sessions"] = kArgumentTypeUnsignedInteger;
+	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+
+	Arguments arguments(argumentTypes);
+
+	if (!arguments.ParseArguments(argc, argv, 2))
+	{
+		Interface::Print(PortHealthAction::usage);
+		return (0);
+	}
+
+	const StringArgument *historyArgument = static_cast<const StringArgument *>(arguments.GetArgument("history"));
+
+	if (!historyArgument)
+	{
+		Interface::Print("Throughput history was not specified.\n\n");
+		Interface::Print(PortHealthAction::usage);
+		return (0);
+	}
+
+	const UnsignedIntegerArgument *sessionsArgument = static_cast<const UnsignedIntegerArgument *>(arguments.GetArgument("sessions"));
+	const UnsignedIntegerArgument *minSessionsArgument = static_cast<const UnsignedIntegerArgument *>(arguments.GetArgument("min-sessions"));
+
+	unsigned int sessionCount = (sessionsArgument) ? sessionsArgument->GetValue() : (unsigned int)kDefaultSessionCount;
+	unsigned int minSessionCount = (minSessionsArgument) ? minSessionsArgument->GetValue() : (unsigned int)kDefaultMinSessionCount;
+
+	if (sessionCount == 0)
+	{
+		Interface::Print("--sessions must be at least 1.\n\n");
+		Interface::Print(PortHealthAction::usage);
+		return (0);
+	}
+
+	if (arguments.GetArgument("stdout-errors") != nullptr)
+		Interface::SetStdoutErrors(true);
+
+	ThroughputHistory throughputHistory(historyArgument->GetValue());
+
+	if (!throughputHistory.Load())
+		return (1);
+
+	// Gather each port's most recent sessions
+
+	const vector<ThroughputSession>& sessions = throughputHistory.GetSessions();
+	map<string, PortHealth> ports;
+
+	for (vector<ThroughputSession>::const_reverse_iterator it = sessions.rbegin(); it != sessions.rend(); it++)
+	{
+		PortHealth& portHealth = ports[it->port];
+
+		if (portHealth.sessionCount < sessionCount)
+			addSession(portHealth, *it);
+	}
+
+	if (ports.empty())
+	{
+		Interface::PrintError("The throughput history contains no sessions.\n");
+		return (1);
+	}
+
+	map<string, double> typicalThroughputs = getTypicalThroughputs(ports);
+
+	// Report
+
+	unsigned int degradedCount = 0;
+
+	Interface::Print("%-20s %8s %6s %9s %7s %8s %7s %7s %8s  %s\n", "Port", "Sessions", "Failed", "Transfers", "Errors", "Timeouts",
+		"Retries", "MiB/s", "Relative", "Status");
+
+	for (map<string, PortHealth>::const_iterator it = ports.begin(); it != ports.end(); it++)
+	{
+		const PortHealth& portHealth = it->second;
+
+		double mebibytesPerSecond = (portHealth.totals.milliseconds > 0)
+			? portHealth.totals.bytes * 1000.0 / portHealth.totals.milliseconds / 1048576.0 : 0.0;
+
+		double relativeThroughput;
+		bool throughputJudged = getRelativeThroughput(portHealth, typicalThroughputs, relativeThroughput);
+
+		char relative[16];
+
+		if (throughputJudged)
+			sprintf(relative, "%.2f", relativeThroughput);
+		else
+			sprintf(relative, "-");
+
+		string status;
+
+		if (portHealth.sessionCount < minSessionCount)
+		{
+			status = "too few sessions";
+		}
+		else
+		{
+			string reasons;
+
+			if (throughputJudged && relativeThroughput < 0.75)
+				reasons += ", slow";
+
+			if ((portHealth.errorCount + portHealth.timeoutCount) * 100ULL > portHealth.transferCount)
+				reasons += ", errors";
+
+			if (portHealth.failedSessionCount >= 2 && portHealth.failedSessionCount * 4 > portHealth.sessionCount)
+				reasons += ", failures";
+
+			if (reasons.empty())
+			{
+				status = "OK";
+			}
+			else
+			{
+				status = "DEGRADED: " + reasons.substr(2);
+				degradedCount++;
+			}
+		}
+
+		Interface::Print("%-20s %8u %6u %9u %7u %8u %7u %7.1f %8s  %s\n", it->first.c_str(), portHealth.sessionCount,
+			portHealth.failedSessionCount, portHealth.transferCount, portHealth.errorCount, portHealth.timeoutCount,
+			portHealth.retryCount, mebibytesPerSecond, relative, status.c_str());
+
+		if (!portHealth.errorCounts.empty())
+		{
+			Interface::Print("%-20s libusb errors:", "");
+
+			for (map<int, unsigned int>::const_iterator error = portHealth.errorCounts.begin(); error != portHealth.errorCounts.end();
+				error++)
+			{
+				Interface::Print(" %d x%u", error->first, error->second);
+			}
+
+			Interface::Print("\n");
+		}
+	}
+
+	Interface::Print("\n%u of %u ports degraded.\n", degradedCount, (unsigned int)ports.size());
+
+	return (0);
+}
@@ -26,6 +26,7 @@
 #include "BridgeManager.h"
 #include "Heimdall.h"
 #include "Interface.h"
+#include "PitCache.h"
 #include "PrintPitAction.h"
 
 using namespace std;
@@ -34,13 +35,16 @@ using namespace Heimdall;
 
 const char *PrintPitAction::usage = "Action: print-pit\n\
 Arguments: [--file <filename>] [--verbose] [--no-reboot] [--stdout-errors]\n\
-    [--usb-log-level <none/error/warning/debug>]\n\
+    [--usb-log-level <none/error/warning/debug>] [--pit-cache <directory>]\n\
 Description: Prints the contents of a PIT file in a human readable format. If\n\
     a filename is not provided then Heimdall retrieves the PIT file from the \n\
     connected device.\n\
 Note: --no-reboot causes the device to remain in download mode after the action\n\
       is completed. If you wish to perform another action whilst remaining in\n\
-      download mode, then the following action must specify the --resume flag.\n";
+      download mode, then the following action must specify the --resume flag.\n\
+Note: --pit-cache reuses the device's PIT file from the specified directory,\n\
+      rather than downloading all of it, when the PIT file's size and first\n\
+      part are unchanged. Devices are identified by their USB serial number.\n";
 
 int PrintPitAction::Execute(int argc, char **argv)
 {
@@ -53,6 +57,7 @@ int PrintPitAction::Execute(int argc, char **argv)
 	argumentTypes["verbose"] = kArgumentTypeFlag;
 	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
 	argumentTypes["usb-log-level"] = kArgumentTypeString;
+	argumentTypes["pit-cache"] = kArgumentTypeString;
 
 	Arguments arguments(argumentTypes);
 
@@ -107,17 +112,15 @@ int PrintPitAction::Execute(int argc, char **argv)
 		}
 	}
 
-	// Open file (if specified).
+	// Map file (if specified).
 
-	FILE *localPitFile = nullptr;
+	PitFileMapping localPitFileMapping;
 
 	if (fileArgument)
 	{
 		const char *filename = fileArgument->GetValue().c_str();
 
-		localPitFile = FileOpen(filename, "rb");
-
-		if (!localPitFile)
+		if (!localPitFileMapping.Open(filename))
 		{
 			Interface::PrintError("Failed to open file \"%s\"\n", filename);
 			return (1);
@@ -129,26 +132,19 @@ int PrintPitAction::Execute(int argc, char **argv)
 	Interface::PrintReleaseInfo();
 	Sleep(1000);
 
-	if (localPitFile)
+	if (localPitFileMapping.GetData())
 	{
-		// Print PIT from file; there's no need for a BridgeManager.
-
-		FileSeek(localPitFile, 0, SEEK_END);
-		unsigned int localPitFileSize = (unsigned int)FileTell(localPitFile);
-		FileRewind(localPitFile);
+		// Print PIT from file; there's no need for a BridgeManager. Entries are read straight from the mapped file.
 
-		// Load the local pit file into memory.
-		unsigned char *pitFileBuffer = new unsigned char[localPitFileSize];
-		(void)fread(pitFileBuffer, 1, localPitFileSize, localPitFile);
-		FileClose(localPitFile);
+		PitView pitView;
 
-		PitData *pitData = new PitData();
-		pitData->Unpack(pitFileBuffer);
-
-		delete [] pitFileBuffer;
+		if (!pitView.Open(localPitFileMapping.GetData(), localPitFileMapping.GetSize()))
+		{
+			Interface::PrintError("Failed to unpack PIT file!\n");
+			return (1);
+		}
 
-		Interface::PrintPit(pitData);
-		delete pitData;
+		Interface::PrintPit(&pitView);
 
 		return (0);
 	}
@@ -156,33 +152,48 @@ int PrintPitAction::Execute(int argc, char **argv)
 	{
 		// Print PIT from a device.
 
+		const StringArgument *pitCacheArgument = static_cast<const StringArgument *>(arguments.GetArgument("pit-cache"));
+		PitCache *pitCache = nullptr;
+
+		if (pitCacheArgument)
+		{
+			pitCache = new PitCache(pitCacheArgument->GetValue());
+
+			if (!pitCache->Initialise())
+			{
+				Interface::PrintError("Failed to create PIT cache directory \"%s\"\n", pitCacheArgument->GetValue().c_str());
+				delete pitCache;
+				return (1);
+			}
+		}
+
 		BridgeManager *bridgeManager = new BridgeManager(verbose);
 		bridgeManager->SetUsbLogLevel(usbLogLevel);
 
 		if (bridgeManager->Initialise(resume) != BridgeManager::kInitialiseSucceeded || !bridgeManager->BeginSession())
 		{
 			delete bridgeManager;
+			delete pitCache;
 			return (1);
 		}
 		
 		unsigned char *devicePit;
-		bool success = bridgeManager->DownloadPitFile(&devicePit) != 0;
+		int devicePitSize = bridgeManager->DownloadPitFile(&devicePit, pitCache);
+		bool success = devicePitSize != 0;
 
 		if (success)
 		{
-			PitData *pitData = new PitData();
+			PitView pitView;
 
-			if (pitData->Unpack(devicePit))
+			if (pitView.Open(devicePit, devicePitSize))
 			{
-				Interface::PrintPit(pitData);
+				Interface::PrintPit(&pitView);
 			}
 			else
 			{
 				Interface::PrintError("Failed to unpack device's PIT file!\n");
 				success = false;
 			}
-
-			delete pitData;
 		}
 			
 		delete [] devicePit;
@@ -191,6 +202,7 @@ int PrintPitAction::Execute(int argc, char **argv)
 			success = false;
 
 		delete bridgeManager;
+		delete pitCache;
 
 		return (success ? 0 : 1);
 	}
@@ -0,0 +1,263 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <chrono>
+#include <stdio.h>
+
+// Heimdall
+#include "Heimdall.h"
+#include "Interface.h"
+#include "Progress.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace Heimdall;
+
+// Progress is tracked per thread, so that sessions embedded on different threads report independently.
+static thread_local int format = Progress::kFormatText;
+static thread_local unsigned int interval = Progress::kDefaultInterval;
+static thread_local Progress::Listener *listener = nullptr;
+
+static thread_local string partitionName;
+static thread_local bool transferVerbose;
+static thread_local unsigned int transferTotalBytes;
+static thread_local unsigned int transferBytes;
+static thread_local unsigned int previousPercent;
+static thread_local chrono::steady_clock::time_point transferStartTime;
+static thread_local chrono::steady_clock::time_point previousEventTime;
+
+static void printJsonString(const char *value)
+{
+	string json;
+	Utility::AppendJsonString(json, value);
+
+	fputs(json.c_str(), stdout);
+}
+
+static void beginEvent(const char *event)
+{
+	printf("{\"event\":\"%s\"", event);
+
+	if (!partitionName.empty())
+	{
+		printf(",\"partition\":");
+		printJsonString(partitionName.c_str());
+	}
+}
+
+static void endEvent(void)
+{
+	printf("}\n");
+	fflush(stdout);
+}
+
+static void printTransferEvent(const char *event, chrono::steady_clock::time_point now)
+{
+	double seconds = chrono::duration<double>(now - transferStartTime).count();
+	unsigned long long bytesPerSecond = (seconds > 0.0) ? (unsigned long long)(transferBytes / seconds) : 0;
+
+	beginEvent(event);
+	printf(",\"bytes\":%u,\"totalBytes\":%u,\"percent\":%u,\"seconds\":%.3f,\"bytesPerSecond\":%llu", transferBytes, transferTotalBytes,
+		previousPercent, seconds, bytesPerSecond);
+	endEvent();
+}
+
+void Progress::AddArgumentTypes(map<string, ArgumentType>& argumentTypes)
+{
+	argumentTypes["progress"] = kArgumentTypeString;
+	argumentTypes["progress-interval"] = kArgumentTypeUnsignedInteger;
+}
+
+bool Progress::ApplyArguments(const Arguments& arguments)
+{
+	const StringArgument *progressArgument = static_cast<const StringArgument *>(arguments.GetArgument("progress"));
+	const UnsignedIntegerArgument *intervalArgument = static_cast<const UnsignedIntegerArgument *>(arguments.GetArgument("progress-interval"));
+
+	if (progressArgument)
+	{
+		const string& progressString = progressArgument->GetValue();
+
+		if (progressString.compare("text") == 0 || progressString.compare("TEXT") == 0)
+		{
+			SetFormat(kFormatText);
+		}
+		else if (progressString.compare("json") == 0 || progressString.compare("JSON") == 0)
+		{
+			SetFormat(kFormatJson);
+		}
+		else
+		{
+			Interface::Print("Unknown progress format: %s\n\n", progressString.c_str());
+			return (false);
+		}
+	}
+
+	if (intervalArgument)
+		SetInterval(intervalArgument->GetValue());
+
+	return (true);
+}
+
+void Progress::SetFormat(int format)
+{
+	::format = format;
+
+	if (format == kFormatJson)
+		Interface::SetOutputFiles(stderr, stderr);
+	else
+		Interface::SetOutputFiles(nullptr, nullptr);
+}
+
+int Progress::GetFormat(void)
+{
+	return (format);
+}
+
+void Progress::SetInterval(unsigned int interval)
+{
+	::interval = interval;
+}
+
+void Progress::SetListener(Listener *listener)
+{
+	::listener = listener;
+}
+
+Progress::Listener *Progress::GetListener(void)
+{
+	return (listener);
+}
+
+void Progress::Phase(const char *phase, const char *partitionName)
+{
+	::partitionName = partitionName ? partitionName : "";
+
+	if (listener)
+		listener->Phase(phase, partitionName);
+
+	if (format == kFormatJson)
+	{
+		beginEvent("phase");
+		printf(",\"phase\":\"%s\"", phase);
+		endEvent();
+	}
+}
+
+void Progress::BeginTransfer(unsigned int totalBytes, bool verbose)
+{
+	transferVerbose = verbose;
+	transferTotalBytes = totalBytes;
+	transferBytes = 0;
+	previousPercent = 0;
+	transferStartTime = chrono::steady_clock::now();
+	previousEventTime = transferStartTime;
+
+	if (listener)
+		listener->BeginTransfer(totalBytes);
+
+	if (format == kFormatJson)
+	{
+		beginEvent("transfer-begin");
+		printf(",\"totalBytes\":%u", totalBytes);
+		endEvent();
+	}
+	else if (format == kFormatText)
+	{
+		Interface::Print("0%%");
+	}
+}
+
+void Progress::Transfer(unsigned int bytesTransferred)
+{
+	transferBytes = (bytesTransferred > transferTotalBytes) ? transferTotalBytes : bytesTransferred;
+
+	unsigned int currentPercent = (transferTotalBytes > 0) ? (unsigned int)(100.0 * ((double)transferBytes / (double)transferTotalBytes)) : 100;
+
+	if (listener)
+		listener->Transfer(transferBytes, transferTotalBytes);
+
+	if (format == kFormatJson)
+	{
+		previousPercent = currentPercent;
+
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+		if (chrono::duration_cast<chrono::milliseconds>(now - previousEventTime).count() >= interval)
+		{
+			previousEventTime = now;
+			printTransferEvent("progress", now);
+		}
+	}
+	else if (format == kFormatText && currentPercent != previousPercent)
+	{
+		if (!transferVerbose)
+		{
+			if (previousPercent < 10)
+				Interface::Print("\b\b%d%%", currentPercent);
+			else
+				Interface::Print("\b\b\b%d%%", currentPercent);
+		}
+		else
+		{
+			Interface::Print("\n%d%%\n", currentPercent);
+		}
+
+		previousPercent = currentPercent;
+	}
+}
+
+void Progress::Retry(unsigned int attempt)
+{
+	if (listener)
+		listener->Retry(attempt);
+
+	if (format == kFormatJson)
+	{
+		beginEvent("retry");
+		printf(",\"attempt\":%u", attempt);
+		endEvent();
+	}
+}
+
+void Progress::EndTransfer(void)
+{
+	if (listener)
+		listener->EndTransfer();
+
+	if (format == kFormatJson)
+		printTransferEvent("transfer-end", chrono::steady_clock::now());
+	else if (format == kFormatText && !transferVerbose)
+		Interface::Print("\n");
+}
+
+void Progress::Error(const char *message)
+{
+	if (listener)
+		listener->Error(message);
+
+	if (format == kFormatJson)
+	{
+		beginEvent("error");
+		printf(",\"message\":");
+		printJsonString(message);
+		endEvent();
+	}
+}
@@ -0,0 +1,94 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+// C/C++ Standard Library
+#include <map>
+#include <string>
+
+// Heimdall
+#include "Arguments.h"
+
+namespace Heimdall
+{
+	// Reports the progress of a session, either as human-readable text or as JSON lines on stdout. In JSON mode all
+	// other output is moved to stderr, so that stdout contains nothing but events.
+	namespace Progress
+	{
+		enum
+		{
+			kFormatText = 0,
+			kFormatJson,
+			kFormatNone // Events are only delivered to the listener.
+		};
+
+		enum
+		{
+			kDefaultInterval = 250 // milliseconds
+		};
+
+		// Receives events in-process e.g. when Heimdall is embedded in another application. Events are delivered on the thread
+		// running the session, in addition to any text or JSON output.
+		class Listener
+		{
+			public:
+
+				virtual ~Listener()
+				{
+				}
+
+				virtual void Phase(const char *phase, const char *partitionName) = 0;
+
+				virtual void BeginTransfer(unsigned int totalBytes) = 0;
+				virtual void Transfer(unsigned int bytesTransferred, unsigned int totalBytes) = 0;
+				virtual void Retry(unsigned int attempt) = 0;
+				virtual void EndTransfer(void) = 0;
+
+				virtual void Error(const char *message) = 0;
+		};
+
+		void AddArgumentTypes(std::map<std::string, ArgumentType>& argumentTypes);
+		bool ApplyArguments(const Arguments& arguments); // Returns false if the arguments are invalid.
+
+		void SetFormat(int format);
+		int GetFormat(void);
+
+		// Progress events are emitted at most once per interval, the start and end of a transfer are always emitted.
+		void SetInterval(unsigned int interval);
+
+		// Applies to the calling thread only, as do the format and interval. Passing nullptr removes the listener.
+		void SetListener(Listener *listener);
+		Listener *GetListener(void);
+
+		// partitionName may be nullptr, if the phase doesn't concern a particular partition.
+		void Phase(const char *phase, const char *partitionName = nullptr);
+
+		void BeginTransfer(unsigned int totalBytes, bool verbose);
+		void Transfer(unsigned int bytesTransferred);
+		void Retry(unsigned int attempt);
+		void EndTransfer(void);
+
+		void Error(const char *message);
+	}
+}
+
+#endif
@@ -21,6 +21,9 @@
 #ifndef RECEIVEFILEPARTPACKET_H
 #define RECEIVEFILEPARTPACKET_H
 
+// C++ Standard Library
+#include <array>
+
 // Heimdall
 #include "InboundPacket.h"
 
@@ -35,8 +38,15 @@ namespace Heimdall
 				kDataSize = 500
 			};
 
+		private:
+
+			std::array<unsigned char, kDataSize> storage;
+
+		public:
+
 			ReceiveFilePartPacket() : InboundPacket(kDataSize, true)
 			{
+				data = storage.data();
 			}
 
 			bool Unpack(void)
@@ -21,6 +21,9 @@
 #ifndef RESPONSEPACKET_H
 #define RESPONSEPACKET_H
 
+// C++ Standard Library
+#include <array>
+
 // Heimdall
 #include "InboundPacket.h"
 
@@ -39,21 +42,28 @@ namespace Heimdall
 				kResponseTypeEndSession = 0x67
 			};
 
-		private:
-
-			unsigned int responseType;
-
 		protected:
 
 			enum
 			{
-				kDataSize = 4
+				kPacketSize = 8
 			};
 
+			typedef PacketField<kPacketSize, 0> ResponseTypeField;
+			typedef NextPacketField<ResponseTypeField> ValueField;
+
+		private:
+
+			std::array<unsigned char, kPacketSize> storage;
+
+			unsigned int responseType;
+
 		public:
 
-			ResponsePacket(int responseType) : InboundPacket(8)
+			ResponsePacket(int responseType) : InboundPacket(kPacketSize), storage()
 			{
+				data = storage.data();
+
 				this->responseType = responseType;
 			}
 
@@ -64,7 +74,7 @@ namespace Heimdall
 
 			virtual bool Unpack(void)
 			{
-				unsigned int receivedResponseType = UnpackInteger(0);
+				unsigned int receivedResponseType = UnpackField<ResponseTypeField>();
 				if (receivedResponseType != responseType)
 				{
 					responseType = receivedResponseType;
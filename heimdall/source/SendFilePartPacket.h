@@ -26,32 +26,60 @@
 #include <string.h>
 
 // Heimdall
-#include "Packet.h"
+#include "Heimdall.h"
+#include "OutboundPacket.h"
 
 namespace Heimdall
 {
 	class SendFilePartPacket : public OutboundPacket
 	{
+		private:
+
+			bool ownsData;
+
 		public:
 
-			SendFilePartPacket(FILE *file, unsigned int size) : OutboundPacket(size)
+			// Reads the part at offset from fileData if provided, otherwise from file. Parts lying wholly within fileData are sent
+			// in place rather than copied, fileData is never modified.
+			SendFilePartPacket(FILE *file, const unsigned char *fileData, unsigned int fileSize, unsigned int offset, unsigned int size)
+				: OutboundPacket(size)
 			{
-				memset(data, 0, size);
+				if (fileData && size <= fileSize && offset <= fileSize - size)
+				{
+					data = const_cast<unsigned char *>(fileData + offset);
+					ownsData = false;
+					return;
+				}
+
+				data = new unsigned char[size];
+				ownsData = true;
+
+				unsigned int bytesToRead = (offset < fileSize) ? fileSize - offset : 0;
+
+				if (bytesToRead > size)
+					bytesToRead = size;
 
-				unsigned int position = (unsigned int)FileTell(file);
+				size_t bytesRead;
 
-				FileSeek(file, 0, SEEK_END);
-				unsigned int fileSize = (unsigned int)FileTell(file);
-				FileSeek(file, position, SEEK_SET);
+				if (fileData)
+				{
+					memcpy(data, fileData + offset, bytesToRead);
+					bytesRead = bytesToRead;
+				}
+				else
+				{
+					FileSeek(file, offset, SEEK_SET);
+					bytesRead = fread(data, 1, bytesToRead, file);
+				}
 
-				// min(fileSize, size)
-				unsigned int bytesToRead = (fileSize < size) ? fileSize - position : size;
-				(void)fread(data, 1, bytesToRead, file);
+				// Only the padding following the file's data needs clearing.
+				memset(data + bytesRead, 0, size - bytesRead);
 			}
 
-			SendFilePartPacket(unsigned char *buffer, unsigned int size) : OutboundPacket(size)
+			~SendFilePartPacket()
 			{
-				memcpy(data, buffer, size);
+				if (ownsData)
+					delete [] data;
 			}
 
 			void Pack(void)
@@ -48,7 +48,7 @@ namespace Heimdall
 				if (!ResponsePacket::Unpack())
 					return (false);
 
-				partIndex = UnpackInteger(ResponsePacket::kDataSize);
+				partIndex = UnpackField<ValueField>();
 				
 				return (true);
 			}
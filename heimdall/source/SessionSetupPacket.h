@@ -46,10 +46,7 @@ namespace Heimdall
 
 		protected:
 
-			enum
-			{
-				kDataSize = ControlPacket::kDataSize + 4
-			};
+			typedef NextPacketField<ControlPacket::ControlTypeField> RequestField;
 
 		public:
 
@@ -67,7 +64,7 @@ namespace Heimdall
 			{
 				ControlPacket::Pack();
 
-				PackInteger(ControlPacket::kDataSize, request);
+				PackField<RequestField>(request);
 			}
 	};
 }
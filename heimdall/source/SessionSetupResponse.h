@@ -48,7 +48,7 @@ namespace Heimdall
 				if (!ResponsePacket::Unpack())
 					return (false);
 
-				result = UnpackInteger(ResponsePacket::kDataSize);
+				result = UnpackField<ValueField>();
 
 				return (true);
 			}
@@ -39,6 +39,9 @@ namespace Heimdall
 
 		private:
 
+			typedef NextPacketField<ControlPacket::ControlTypeField> RequestField;
+			typedef NextPacketField<RequestField> Unknown3ParameterField;
+
 			unsigned int request;
 			unsigned int unknown3Parameter;
 
@@ -65,8 +68,8 @@ namespace Heimdall
 			{
 				ControlPacket::Pack();
 
-				PackInteger(ControlPacket::kDataSize, request);
-				PackInteger(ControlPacket::kDataSize + 4, unknown3Parameter);
+				PackField<RequestField>(request);
+				PackField<Unknown3ParameterField>(unknown3Parameter);
 			}
 	};
 }
@@ -48,7 +48,7 @@ namespace Heimdall
 				if (!ResponsePacket::Unpack())
 					return (false);
 
-				unknown = UnpackInteger(ResponsePacket::kDataSize);
+				unknown = UnpackField<ValueField>();
 
 				return (true);
 			}
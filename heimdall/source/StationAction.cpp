@@ -0,0 +1,943 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <signal.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <utility>
+#include <vector>
+
+// libpit
+#include "libpit.h"
+
+// Heimdall
+#include "Arguments.h"
+#include "BatchSession.h"
+#include "BridgeManager.h"
+#include "FlashAction.h"
+#include "Heimdall.h"
+#include "ImageStore.h"
+#include "Interface.h"
+#include "PitCache.h"
+#include "Progress.h"
+#include "StationAction.h"
+#include "ThroughputHistory.h"
+#include "TransferProfiles.h"
+#include "TransferScheduler.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace libpit;
+using namespace Heimdall;
+
+const char *StationAction::usage = "Action: station\n\
+Arguments: --manifest <filename> [--max-devices <count>]\n\
+    [--hub-bandwidth <MiB/s>] [--stall-timeout <seconds>]\n\
+    [--results <filename>] [--history <filename>] [--verbose]\n\
+    [--stdout-errors]\n\
+    [--usb-log-level <none/error/warning/debug>] [--pit-cache <directory>]\n\
+    [--transfer-profiles <filename>]\n\
+Description: Runs until interrupted, flashing every supported device that's\n\
+    connected in download mode as described by a manifest. Each device is\n\
+    flashed in its own session, at most --max-devices (default 4) at once.\n\
+    The manifest's files are opened once and shared by every session.\n\
+    Manifest lines:\n\
+      flash <partition name/identifier> <filename>\n\
+      pit <filename>\n\
+      pit-policy <device/verify/repartition>\n\
+      reboot <yes/no>\n\
+      tflash\n\
+Note: pit-policy device (the default without a PIT) flashes according to the\n\
+      device's PIT. verify (the default with a PIT) only flashes devices whose\n\
+      PIT matches the manifest's PIT, and repartition replaces the device's\n\
+      PIT with it. Devices are rebooted once flashed, unless reboot is no,\n\
+      whereas devices that fail are left in download mode.\n\
+Note: Blank lines and lines beginning with # are ignored. Arguments containing\n\
+      spaces may be enclosed in double quotes.\n\
+Note: The manifest's files mustn't be modified whilst the station runs. The\n\
+      station stops if one is, but a file that's truncated or rewritten in\n\
+      place may still abort the sessions flashing it. Replace a file by\n\
+      renaming a new one over it, then restart the station.\n\
+Note: Each device is flashed once. A device that's still connected afterwards,\n\
+      e.g. because it failed or wasn't rebooted, is flashed again only once\n\
+      it's been disconnected and reconnected.\n\
+Note: --hub-bandwidth limits the combined throughput of the transfers through\n\
+      each USB hub, including root hubs. A file transfer that would exceed the\n\
+      limit of any hub between the device and the host waits until enough\n\
+      bandwidth is free. Each transfer is expected to use the throughput its\n\
+      device achieved when tuned, or 16 MiB/s for devices without a transfer\n\
+      profile. A hub with no active transfers always admits one.\n\
+Note: Once a session has begun, if its device doesn't respond for\n\
+      --stall-timeout seconds (default 60, 0 disables) after it was due to\n\
+      respond, the session is abandoned and the device released within a\n\
+      few seconds. What the session was doing is recorded in the device's\n\
+      result. Time spent waiting for hub bandwidth doesn't count.\n\
+Note: --results appends a JSON line to the file for each device flashed. Output\n\
+      from each session is prefixed by the device's bus and port numbers.\n\
+Note: --history appends each session's duration, USB error statistics and the\n\
+      size and duration of each of its file transfers to a throughput\n\
+      history, from which the estimate action predicts flash times and the\n\
+      port-health action identifies degraded ports and cables.\n\
+Note: --transfer-profiles applies the file transfer parameters measured by the\n\
+      tune action, if the file contains a profile for the device.\n";
+
+enum
+{
+	kDefaultMaxDevices = 4,
+	kDefaultStallTimeout = 60, // seconds
+	kDevicePollInterval = 1000 // milliseconds
+};
+
+enum
+{
+	kPitPolicyDefault = 0,
+	kPitPolicyDevice,
+	kPitPolicyVerify,
+	kPitPolicyRepartition
+};
+
+struct StationManifest
+{
+	vector<FlashAction::PartitionFile> partitionFiles;
+	shared_ptr<const Image> pitImage;
+	PitData *pitData;
+
+	int pitPolicy;
+	bool reboot;
+	bool tflash;
+
+	StationManifest()
+	{
+		pitData = nullptr;
+
+		pitPolicy = kPitPolicyDefault;
+		reboot = true;
+		tflash = false;
+	}
+
+	~StationManifest()
+	{
+		delete pitData;
+	}
+};
+
+struct StationContext
+{
+	const StationManifest *manifest;
+	const PitCache *pitCache;
+	const TransferProfiles *transferProfiles;
+	TransferScheduler *transferScheduler;
+	const ThroughputHistory *throughputHistory;
+
+	BridgeManager::UsbLogLevel usbLogLevel;
+	bool verbose;
+	bool watched; // Sessions are aborted if their device stalls.
+
+	// Guards stdout, stderr, resultsFile, the throughput history and the counts.
+	mutex outputMutex;
+
+	FILE *resultsFile;
+	unsigned int succeededCount;
+	unsigned int failedCount;
+};
+
+// Flashes one device on its own thread. Receives the session's progress, and its output, which is forwarded a line at a
+// time so that concurrent sessions' lines aren't interleaved.
+struct StationWorker : public Progress::Listener
+{
+	StationContext *context;
+
+	DeviceLocation location;
+	string name;
+
+	thread workerThread;
+	atomic<bool> finished;
+
+	// Guards bridgeManager and everything below it, which the watchdog reads whilst the session is under way.
+	mutex sessionMutex;
+
+	BridgeManager *bridgeManager; // nullptr unless the session has begun.
+	string phase;
+	string partitionName;
+	string stallRecord; // The watchdog's snapshot of a session that stalled, as JSON.
+
+	string outputLine;
+	string errorLine;
+
+	string model;
+	string serialNumber;
+	string firstError;
+
+	chrono::steady_clock::time_point transferStartTime;
+	string transferPartitionName;
+	vector<ThroughputTransfer> transfers;
+	UsbStatistics usbStatistics;
+
+	atomic<unsigned int> transferBytes;
+	atomic<unsigned long long> totalBytes;
+
+	StationWorker(StationContext *context, const DeviceLocation& location, const string& name)
+	{
+		this->context = context;
+		this->location = location;
+		this->name = name;
+
+		finished = false;
+
+		bridgeManager = nullptr;
+
+		transferBytes = 0;
+		totalBytes = 0;
+	}
+
+	void Phase(const char *phase, const char *partitionName)
+	{
+		lock_guard<mutex> lock(sessionMutex);
+
+		this->phase = phase;
+		this->partitionName = (partitionName) ? partitionName : "";
+	}
+
+	void BeginTransfer(unsigned int)
+	{
+		transferBytes = 0;
+
+		// Only this thread modifies partitionName.
+		transferPartitionName = partitionName;
+		transferStartTime = chrono::steady_clock::now();
+	}
+
+	void Transfer(unsigned int bytesTransferred, unsigned int)
+	{
+		transferBytes = bytesTransferred;
+	}
+
+	void Retry(unsigned int)
+	{
+	}
+
+	void EndTransfer(void)
+	{
+		ThroughputTransfer transfer;
+		transfer.partitionName = transferPartitionName;
+		transfer.bytes = transferBytes.exchange(0);
+		transfer.milliseconds = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - transferStartTime).count();
+
+		transfers.push_back(transfer);
+		totalBytes += transfer.bytes;
+	}
+
+	void Error(const char *message)
+	{
+		// Later errors tend to be consequences of the first e.g. "Flash aborted!".
+		if (firstError.empty())
+			firstError = message;
+	}
+};
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handleInterrupt(int)
+{
+	interrupted = 1;
+}
+
+static string getDeviceName(const DeviceLocation& location)
+{
+	char number[16];
+
+	if (location.portNumbers.empty())
+	{
+		sprintf(number, "%d:%d", location.busNumber, location.deviceAddress);
+		return (number);
+	}
+
+	// Matches the device's name under /sys/bus/usb/devices on Linux e.g. 1-2.4
+	sprintf(number, "%d", location.busNumber);
+	string name = number;
+
+	for (unsigned int i = 0; i < location.portNumbers.size(); i++)
+	{
+		sprintf(number, "%c%u", (i == 0) ? '-' : '.', location.portNumbers[i]);
+		name += number;
+	}
+
+	return (name);
+}
+
+// Returns the first of the manifest's files to have been modified since it was opened, or nullptr if there are none.
+static const Image *findModifiedImage(const StationManifest& manifest)
+{
+	if (manifest.pitImage && !manifest.pitImage->IsUnchanged())
+		return (manifest.pitImage.get());
+
+	for (vector<FlashAction::PartitionFile>::const_iterator it = manifest.partitionFiles.begin(); it != manifest.partitionFiles.end(); it++)
+	{
+		if (it->image && !it->image->IsUnchanged())
+			return (it->image.get());
+	}
+
+	return (nullptr);
+}
+
+static bool loadManifest(const char *filename, ImageStore& imageStore, StationManifest& manifest)
+{
+	ifstream manifestFile(filename);
+
+	if (!manifestFile)
+	{
+		Interface::PrintError("Failed to open manifest file \"%s\"\n", filename);
+		return (false);
+	}
+
+	string line;
+	unsigned int lineNumber = 0;
+	vector<string> words;
+
+	while (getline(manifestFile, line))
+	{
+		lineNumber++;
+
+		// Tolerate manifests saved with Windows line endings.
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+
+		if (!BatchSession::SplitCommand(line, words))
+		{
+			Interface::PrintError("Invalid manifest line %u.\n", lineNumber);
+			return (false);
+		}
+
+		if (words.empty() || words[0][0] == '#')
+			continue;
+
+		const string& keyword = words[0];
+
+		if (keyword == "flash" && words.size() == 3)
+		{
+			shared_ptr<const Image> image = imageStore.Open(words[2]);
+
+			if (!image)
+			{
+				Interface::PrintError("Failed to open file \"%s\" (manifest line %u)\n", words[2].c_str(), lineNumber);
+				return (false);
+			}
+
+			manifest.partitionFiles.push_back(FlashAction::PartitionFile(words[1], image));
+		}
+		else if (keyword == "pit" && words.size() == 2 && !manifest.pitImage)
+		{
+			manifest.pitImage = imageStore.Open(words[1]);
+
+			if (!manifest.pitImage)
+			{
+				Interface::PrintError("Failed to open PIT file \"%s\" (manifest line %u)\n", words[1].c_str(), lineNumber);
+				return (false);
+			}
+
+			manifest.pitData = new PitData();
+
+			if (!manifest.pitData->Unpack(manifest.pitImage->GetData(), manifest.pitImage->GetSize()))
+			{
+				Interface::PrintError("Failed to unpack PIT file \"%s\" (manifest line %u)\n", words[1].c_str(), lineNumber);
+				return (false);
+			}
+		}
+		else if (keyword == "pit-policy" && words.size() == 2 && manifest.pitPolicy == kPitPolicyDefault)
+		{
+			if (words[1] == "device")
+			{
+				manifest.pitPolicy = kPitPolicyDevice;
+			}
+			else if (words[1] == "verify")
+			{
+				manifest.pitPolicy = kPitPolicyVerify;
+			}
+			else if (words[1] == "repartition")
+			{
+				manifest.pitPolicy = kPitPolicyRepartition;
+			}
+			else
+			{
+				Interface::PrintError("Unknown PIT policy \"%s\" (manifest line %u)\n", words[1].c_str(), lineNumber);
+				return (false);
+			}
+		}
+		else if (keyword == "reboot" && words.size() == 2 && (words[1] == "yes" || words[1] == "no"))
+		{
+			manifest.reboot = words[1] == "yes";
+		}
+		else if (keyword == "tflash" && words.size() == 1)
+		{
+			manifest.tflash = true;
+		}
+		else
+		{
+			Interface::PrintError("Invalid manifest line %u.\n", lineNumber);
+			return (false);
+		}
+	}
+
+	if (manifest.pitPolicy == kPitPolicyDefault)
+		manifest.pitPolicy = (manifest.pitData) ? kPitPolicyVerify : kPitPolicyDevice;
+
+	if (manifest.pitPolicy == kPitPolicyDevice && manifest.pitData)
+	{
+		Interface::PrintError("The manifest's PIT is only used by the verify and repartition PIT policies.\n");
+		return (false);
+	}
+
+	if (manifest.pitPolicy != kPitPolicyDevice && !manifest.pitData)
+	{
+		Interface::PrintError("The %s PIT policy requires a PIT file.\n", (manifest.pitPolicy == kPitPolicyVerify) ? "verify" : "repartition");
+		return (false);
+	}
+
+	if (manifest.partitionFiles.empty() && manifest.pitPolicy != kPitPolicyRepartition)
+	{
+		Interface::PrintError("No partitions were specified to flash.\n");
+		return (false);
+	}
+
+	return (true);
+}
+
+static void printWorkerLine(StationWorker *worker, const string& line, bool error)
+{
+	// Heimdall separates its output with blank lines, which are meaningless once sessions are interleaved.
+	if (line.empty())
+		return;
+
+	lock_guard<mutex> lock(worker->context->outputMutex);
+
+	FILE *file = error ? stderr : stdout;
+
+	fprintf(file, "[%s] %s\n", worker->name.c_str(), line.c_str());
+	fflush(file);
+}
+
+static void workerOutput(const char *text, bool error, void *userData)
+{
+	StationWorker *worker = static_cast<StationWorker *>(userData);
+	string& line = (error) ? worker->errorLine : worker->outputLine;
+
+	line += text;
+
+	string::size_type end;
+
+	while ((end = line.find_first_of("\r\n")) != string::npos)
+	{
+		printWorkerLine(worker, line.substr(0, end), error);
+		line.erase(0, end + 1);
+	}
+}
+
+static void writeResult(StationWorker *worker, bool success, double seconds)
+{
+	StationContext *context = worker->context;
+	char numbers[160];
+
+	string record = "{\"device\":";
+	Utility::AppendJsonString(record, worker->name);
+
+	sprintf(numbers, ",\"time\":%lld,\"bus\":%d,\"address\":%d,\"vendorId\":%d,\"productId\":%d,\"serialNumber\":",
+		(long long)time(nullptr), worker->location.busNumber, worker->location.deviceAddress, worker->location.vendorId,
+		worker->location.productId);
+	record += numbers;
+
+	Utility::AppendJsonString(record, worker->serialNumber);
+
+	sprintf(numbers, ",\"result\":\"%s\",\"bytes\":%llu,\"seconds\":%.1f", (success) ? "success" : "failure",
+		(unsigned long long)worker->totalBytes, seconds);
+	record += numbers;
+
+	if (!success)
+	{
+		record += ",\"error\":";
+		Utility::AppendJsonString(record, worker->firstError);
+	}
+
+	if (!worker->stallRecord.empty())
+	{
+		record += ",\"stall\":";
+		record += worker->stallRecord;
+	}
+
+	record += "}\n";
+
+	lock_guard<mutex> lock(context->outputMutex);
+
+	if (context->throughputHistory)
+	{
+		ThroughputSession session;
+		session.time = time(nullptr);
+		session.model = worker->model;
+
+		// Ports that can't even begin a session are the likeliest to be faulty. The device's release isn't known until then.
+		if (session.model.empty())
+		{
+			sprintf(numbers, "%04x:%04x", worker->location.vendorId & 0xFFFF, worker->location.productId & 0xFFFF);
+			session.model = numbers;
+		}
+		session.port = worker->name;
+		session.serialNumber = worker->serialNumber;
+		session.success = success;
+		session.milliseconds = (unsigned int)(seconds * 1000.0);
+		session.transfers = worker->transfers;
+		session.usbStatistics = worker->usbStatistics;
+
+		if (!context->throughputHistory->Append(session))
+			fprintf(stderr, "[%s] WARNING: Failed to append to throughput history.\n", worker->name.c_str());
+	}
+
+	if (success)
+		context->succeededCount++;
+	else
+		context->failedCount++;
+
+	fprintf(stdout, "[%s] %s in %.1f seconds (%u succeeded, %u failed)\n", worker->name.c_str(), (success) ? "Succeeded" : "FAILED",
+		seconds, context->succeededCount, context->failedCount);
+	fflush(stdout);
+
+	if (context->resultsFile)
+	{
+		fputs(record.c_str(), context->resultsFile);
+		fflush(context->resultsFile);
+	}
+}
+
+static void stationWorker(StationWorker *worker)
+{
+	StationContext *context = worker->context;
+	const StationManifest *manifest = context->manifest;
+
+	Progress::SetFormat(Progress::kFormatNone);
+	Progress::SetListener(worker);
+	Interface::SetOutputFunction(workerOutput, worker);
+
+	chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+	bool success = false;
+
+	BridgeManager *bridgeManager = new BridgeManager(context->verbose);
+	bridgeManager->SetUsbLogLevel(context->usbLogLevel);
+	bridgeManager->SetTransferProfiles(context->transferProfiles);
+	bridgeManager->SetTransferScheduler(context->transferScheduler);
+	bridgeManager->SetDeviceLocation(worker->location.busNumber, worker->location.deviceAddress);
+
+	if (context->watched)
+		bridgeManager->EnableAbort();
+
+	if (bridgeManager->Initialise(false) == BridgeManager::kInitialiseSucceeded && bridgeManager->BeginSession())
+	{
+		worker->model = bridgeManager->GetTransferProfileKey();
+		worker->serialNumber = bridgeManager->GetSerialNumber();
+
+		{
+			// The device may take a while to respond to the beginning of a session, so it's only watched from here on.
+			lock_guard<mutex> lock(worker->sessionMutex);
+			worker->bridgeManager = bridgeManager;
+		}
+
+		const PitData *localPitData = (manifest->pitPolicy != kPitPolicyDevice) ? manifest->pitData : nullptr;
+		bool repartition = manifest->pitPolicy == kPitPolicyRepartition;
+
+		success = FlashAction::Flash(bridgeManager, manifest->partitionFiles, localPitData, repartition, manifest->tflash, nullptr,
+			context->pitCache);
+
+		// A device that stalled can't be relied upon to end the session, it's simply released.
+		if (bridgeManager->IsAborted() || !bridgeManager->EndSession(success && manifest->reboot))
+			success = false;
+
+		lock_guard<mutex> lock(worker->sessionMutex);
+		worker->bridgeManager = nullptr;
+	}
+
+	worker->usbStatistics = bridgeManager->GetUsbStatistics();
+	delete bridgeManager;
+
+	// Flush anything that wasn't terminated by a new line.
+	workerOutput("\n", false, worker);
+	workerOutput("\n", true, worker);
+
+	Interface::SetOutputFunction(nullptr, nullptr);
+	Progress::SetListener(nullptr);
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+	if (!worker->stallRecord.empty())
+		worker->firstError = "Device stopped responding";
+	else if (!success && worker->firstError.empty())
+		worker->firstError = "Session failed";
+
+	writeResult(worker, success, seconds);
+
+	worker->finished = true;
+}
+
+// Aborts the worker's session if the device hasn't responded within stallTimeout seconds, recording what it was doing.
+static void checkForStall(StationWorker *worker, unsigned int stallTimeout)
+{
+	lock_guard<mutex> lock(worker->sessionMutex);
+
+	if (!worker->bridgeManager || worker->bridgeManager->IsAborted())
+		return;
+
+	TransferDiagnostics diagnostics = worker->bridgeManager->GetTransferDiagnostics();
+
+	if (diagnostics.waitingForBandwidth)
+		return;
+
+	// A device isn't silent until a receive has waited for as long as it was allowed to.
+	chrono::steady_clock::time_point dueTime = (diagnostics.receiveDeadline > diagnostics.lastResponseTime)
+		? diagnostics.receiveDeadline : diagnostics.lastResponseTime;
+
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	double silentSeconds = chrono::duration<double>(now - dueTime).count();
+
+	if (silentSeconds < stallTimeout)
+		return;
+
+	worker->bridgeManager->Abort();
+
+	char numbers[256];
+
+	string record = "{\"phase\":";
+	Utility::AppendJsonString(record, worker->phase);
+	record += ",\"partition\":";
+	Utility::AppendJsonString(record, worker->partitionName);
+
+	sprintf(numbers, ",\"sequence\":%d,\"part\":%d,\"transferBytes\":%u,\"totalBytes\":%llu,\"lastSendResult\":%d,"
+		"\"lastReceiveResult\":%d,\"secondsSinceResponse\":%.1f}", diagnostics.sequenceIndex, diagnostics.filePartIndex,
+		(unsigned int)worker->transferBytes, (unsigned long long)worker->totalBytes, diagnostics.lastSendResult,
+		diagnostics.lastReceiveResult, chrono::duration<double>(now - diagnostics.lastResponseTime).count());
+	record += numbers;
+
+	worker->stallRecord = record;
+
+	printWorkerLine(worker, "ERROR: Device stopped responding, abandoning session: " + record, true);
+}
+
+static void checkForStalls(const vector<StationWorker *>& workers, unsigned int stallTimeout)
+{
+	if (stallTimeout == 0)
+		return;
+
+	for (vector<StationWorker *>::const_iterator it = workers.begin(); it != workers.end(); it++)
+		checkForStall(*it, stallTimeout);
+}
+
+// Joins and deletes finished workers, returning the number still active.
+static unsigned int reapWorkers(vector<StationWorker *>& workers)
+{
+	for (vector<StationWorker *>::iterator it = workers.begin(); it != workers.end();)
+	{
+		if ((*it)->finished)
+		{
+			(*it)->workerThread.join();
+			delete *it;
+			it = workers.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+
+	return (workers.size());
+}
+
+int StationAction::Execute(int argc, char **argv)
+{
+	// Handle arguments
+
+	map<string, ArgumentType> argumentTypes;
+	argumentTypes["manifest"] = kArgumentTypeString;
+	argumentTypes["max-devices"] = kArgumentTypeUnsignedInteger;
+	argumentTypes["hub-bandwidth"] = kArgumentTypeUnsignedInteger;
+	argumentTypes["stall-timeout"] = kArgumentTypeUnsignedInteger;
+	argumentTypes["results"] = kArgumentTypeString;
+	argumentTypes["history"] = kArgumentTypeString;
+	argumentTypes["verbose"] = kArgumentTypeFlag;
+	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+	argumentTypes["usb-log-level"] = kArgumentTypeString;
+	argumentTypes["pit-cache"] = kArgumentTypeString;
+	argumentTypes["transfer-profiles"] = kArgumentTypeString;
+
+	Arguments arguments(argumentTypes);
+
+	if (!arguments.ParseArguments(argc, argv, 2))
+	{
+		Interface::Print(StationAction::usage);
+		return (0);
+	}
+
+	const StringArgument *manifestArgument = static_cast<const StringArgument *>(arguments.GetArgument("manifest"));
+
+	if (!manifestArgument)
+	{
+		Interface::Print("Manifest file was not specified.\n\n");
+		Interface::Print(StationAction::usage);
+		return (0);
+	}
+
+	const UnsignedIntegerArgument *maxDevicesArgument = static_cast<const UnsignedIntegerArgument *>(arguments.GetArgument("max-devices"));
+	unsigned int maxDevices = (maxDevicesArgument) ? maxDevicesArgument->GetValue() : (unsigned int)kDefaultMaxDevices;
+
+	if (maxDevices == 0)
+	{
+		Interface::Print("--max-devices must be at least 1.\n\n");
+		Interface::Print(StationAction::usage);
+		return (0);
+	}
+
+	const UnsignedIntegerArgument *hubBandwidthArgument = static_cast<const UnsignedIntegerArgument *>(arguments.GetArgument("hub-bandwidth"));
+
+	if (hubBandwidthArgument && hubBandwidthArgument->GetValue() == 0)
+	{
+		Interface::Print("--hub-bandwidth must be at least 1.\n\n");
+		Interface::Print(StationAction::usage);
+		return (0);
+	}
+
+	const UnsignedIntegerArgument *stallTimeoutArgument = static_cast<const UnsignedIntegerArgument *>(arguments.GetArgument("stall-timeout"));
+	unsigned int stallTimeout = (stallTimeoutArgument) ? stallTimeoutArgument->GetValue() : (unsigned int)kDefaultStallTimeout;
+
+	bool verbose = arguments.GetArgument("verbose") != nullptr;
+
+	if (arguments.GetArgument("stdout-errors") != nullptr)
+		Interface::SetStdoutErrors(true);
+
+	const StringArgument *usbLogLevelArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-log-level"));
+
+	BridgeManager::UsbLogLevel usbLogLevel = BridgeManager::UsbLogLevel::Default;
+
+	if (usbLogLevelArgument)
+	{
+		const string& usbLogLevelString = usbLogLevelArgument->GetValue();
+
+		if (usbLogLevelString.compare("none") == 0 || usbLogLevelString.compare("NONE") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::None;
+		}
+		else if (usbLogLevelString.compare("error") == 0 || usbLogLevelString.compare("ERROR") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Error;
+		}
+		else if (usbLogLevelString.compare("warning") == 0 || usbLogLevelString.compare("WARNING") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Warning;
+		}
+		else if (usbLogLevelString.compare("info") == 0 || usbLogLevelString.compare("INFO") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Info;
+		}
+		else if (usbLogLevelString.compare("debug") == 0 || usbLogLevelString.compare("DEBUG") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Debug;
+		}
+		else
+		{
+			Interface::Print("Unknown USB log level: %s\n\n", usbLogLevelString.c_str());
+			Interface::Print(StationAction::usage);
+			return (0);
+		}
+	}
+
+	// Load manifest
+
+	ImageStore imageStore;
+	StationManifest manifest;
+
+	if (!loadManifest(manifestArgument->GetValue().c_str(), imageStore, manifest))
+		return (1);
+
+	const StringArgument *pitCacheArgument = static_cast<const StringArgument *>(arguments.GetArgument("pit-cache"));
+	PitCache *pitCache = nullptr;
+
+	if (pitCacheArgument)
+	{
+		pitCache = new PitCache(pitCacheArgument->GetValue());
+
+		if (!pitCache->Initialise())
+		{
+			Interface::PrintError("Failed to create PIT cache directory \"%s\"\n", pitCacheArgument->GetValue().c_str());
+			delete pitCache;
+			return (1);
+		}
+	}
+
+	const StringArgument *transferProfilesArgument = static_cast<const StringArgument *>(arguments.GetArgument("transfer-profiles"));
+	TransferProfiles transferProfiles((transferProfilesArgument) ? transferProfilesArgument->GetValue() : "");
+
+	if (transferProfilesArgument && !transferProfiles.Load())
+	{
+		delete pitCache;
+		return (1);
+	}
+
+	const StringArgument *resultsArgument = static_cast<const StringArgument *>(arguments.GetArgument("results"));
+	FILE *resultsFile = nullptr;
+
+	if (resultsArgument)
+	{
+		resultsFile = FileOpen(resultsArgument->GetValue().c_str(), "a");
+
+		if (!resultsFile)
+		{
+			Interface::PrintError("Failed to open results file \"%s\"\n", resultsArgument->GetValue().c_str());
+			delete pitCache;
+			return (1);
+		}
+	}
+
+	const StringArgument *historyArgument = static_cast<const StringArgument *>(arguments.GetArgument("history"));
+	ThroughputHistory throughputHistory((historyArgument) ? historyArgument->GetValue() : "");
+
+	TransferScheduler *transferScheduler = nullptr;
+
+	if (hubBandwidthArgument)
+		transferScheduler = new TransferScheduler(hubBandwidthArgument->GetValue() * 1048576ULL);
+
+	StationContext context;
+	context.manifest = &manifest;
+	context.pitCache = pitCache;
+	context.transferProfiles = (transferProfilesArgument) ? &transferProfiles : nullptr;
+	context.transferScheduler = transferScheduler;
+	context.throughputHistory = (historyArgument) ? &throughputHistory : nullptr;
+	context.usbLogLevel = usbLogLevel;
+	context.verbose = verbose;
+	context.watched = stallTimeout > 0;
+	context.resultsFile = resultsFile;
+	context.succeededCount = 0;
+	context.failedCount = 0;
+
+	signal(SIGINT, handleInterrupt);
+	signal(SIGTERM, handleInterrupt);
+
+	Interface::PrintReleaseInfo();
+	Interface::Print("Waiting for devices, at most %u at once. Interrupt to stop.\n\n", maxDevices);
+
+	// Run the station
+
+	vector<StationWorker *> workers;
+
+	// Devices that have been (or are being) flashed, until they're disconnected.
+	set< pair<int, int> > handledDevices;
+	vector<DeviceLocation> devices;
+
+	bool success = true;
+
+	while (!interrupted)
+	{
+		unsigned int activeCount = reapWorkers(workers);
+
+		checkForStalls(workers, stallTimeout);
+
+		if (!BridgeManager::EnumerateDevices(devices))
+		{
+			lock_guard<mutex> lock(context.outputMutex);
+			Interface::PrintError("Failed to list USB devices!\n");
+			success = false;
+			break;
+		}
+
+		// Sessions would flash a mixture of the old and new file.
+		const Image *modifiedImage = findModifiedImage(manifest);
+
+		if (modifiedImage)
+		{
+			lock_guard<mutex> lock(context.outputMutex);
+			Interface::PrintError("\"%s\" has been modified since the station started!\n", modifiedImage->GetFilename().c_str());
+			success = false;
+			break;
+		}
+
+		set< pair<int, int> > connectedDevices;
+
+		for (vector<DeviceLocation>::const_iterator it = devices.begin(); it != devices.end(); it++)
+		{
+			pair<int, int> key(it->busNumber, it->deviceAddress);
+			connectedDevices.insert(key);
+
+			// Devices beyond the limit are left connected, they'll be found again once a worker is free.
+			if (handledDevices.count(key) > 0 || activeCount >= maxDevices)
+				continue;
+
+			handledDevices.insert(key);
+
+			StationWorker *worker = new StationWorker(&context, *it, getDeviceName(*it));
+
+			{
+				lock_guard<mutex> lock(context.outputMutex);
+				Interface::Print("[%s] Device connected\n", worker->name.c_str());
+			}
+
+			worker->workerThread = thread(stationWorker, worker);
+			workers.push_back(worker);
+			activeCount++;
+		}
+
+		for (set< pair<int, int> >::iterator it = handledDevices.begin(); it != handledDevices.end();)
+		{
+			if (connectedDevices.count(*it) == 0)
+				it = handledDevices.erase(it);
+			else
+				it++;
+		}
+
+		Sleep(kDevicePollInterval);
+	}
+
+	// Sessions are never abandoned part way through flashing, unless their device stalls.
+	if (!workers.empty())
+	{
+		lock_guard<mutex> lock(context.outputMutex);
+		Interface::Print("Waiting for %u devices to finish...\n", (unsigned int)workers.size());
+	}
+
+	while (reapWorkers(workers) > 0)
+	{
+		checkForStalls(workers, stallTimeout);
+
+		Sleep(kDevicePollInterval);
+	}
+
+	Interface::Print("\n%u devices succeeded, %u failed.\n", context.succeededCount, context.failedCount);
+
+	if (resultsFile && FileClose(resultsFile) != 0)
+	{
+		Interface::PrintError("Failed to write results file.\n");
+		success = false;
+	}
+
+	delete transferScheduler;
+	delete pitCache;
+
+	return ((success && context.failedCount == 0) ? 0 : 1);
+}
@@ -0,0 +1,308 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifdef _WIN32
+#include <Windows.h>
+#undef GetBinaryType
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// C/C++ Standard Library
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// libusb
+#include <libusb.h>
+
+// Heimdall
+#include "Heimdall.h"
+#include "Interface.h"
+#include "ThroughputHistory.h"
+
+using namespace std;
+using namespace Heimdall;
+
+// Parses space separated error:count pairs.
+static bool parseErrorCounts(const char *text, map<int, unsigned int>& errorCounts)
+{
+	for (;;)
+	{
+		while (*text == ' ')
+			text++;
+
+		if (*text == '\0')
+			return (true);
+
+		char *end;
+		long error = strtol(text, &end, 10);
+
+		if (end == text || *end != ':')
+			return (false);
+
+		text = end + 1;
+		unsigned long count = strtoul(text, &end, 10);
+
+		if (end == text || (*end != ' ' && *end != '\0'))
+			return (false);
+
+		errorCounts[error] = count;
+		text = end;
+	}
+}
+
+ThroughputHistory::ThroughputHistory(const string& filename)
+{
+	this->filename = filename;
+}
+
+bool ThroughputHistory::Load(void)
+{
+	sessions.clear();
+
+	FILE *file = FileOpen(filename.c_str(), "r");
+
+	if (!file)
+	{
+		if (errno == ENOENT)
+			return (true);
+
+		Interface::PrintError("Failed to open throughput history \"%s\"\n", filename.c_str());
+		return (false);
+	}
+
+	char line[512];
+	unsigned int invalidLineCount = 0;
+
+	while (fgets(line, sizeof(line), file))
+	{
+		size_t length = strlen(line);
+
+		while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+			line[--length] = '\0';
+
+		if (line[0] == '#' || line[0] == '\0')
+			continue;
+
+		char model[32];
+		char port[32];
+		char serialNumber[128];
+		unsigned int success;
+		int partitionNameOffset;
+
+		int errorCountsOffset;
+
+		ThroughputSession session;
+		ThroughputTransfer transfer;
+		UsbStatistics usbStatistics;
+
+		if (sscanf(line, "session %lld %u %u %31s %31s %127s", &session.time, &success, &session.milliseconds, model, port,
+			serialNumber) == 6)
+		{
+			session.usbStatistics.transferCount = 0;
+			session.usbStatistics.retryCount = 0;
+			session.usbStatistics.filePartRetryCount = 0;
+			session.usbStatistics.timeoutCount = 0;
+
+			session.model = model;
+			session.port = port;
+			session.serialNumber = (strcmp(serialNumber, "-") != 0) ? serialNumber : "";
+			session.success = success != 0;
+
+			sessions.push_back(session);
+		}
+		else if (!sessions.empty() && sscanf(line, "transfer %llu %u %n", &transfer.bytes, &transfer.milliseconds,
+			&partitionNameOffset) == 2 && line[partitionNameOffset] != '\0')
+		{
+			transfer.partitionName = line + partitionNameOffset;
+			sessions.back().transfers.push_back(transfer);
+		}
+		else if (!sessions.empty() && sscanf(line, "usb %u %u %u %u%n", &usbStatistics.transferCount, &usbStatistics.retryCount,
+			&usbStatistics.filePartRetryCount, &usbStatistics.timeoutCount, &errorCountsOffset) == 4
+			&& parseErrorCounts(line + errorCountsOffset, usbStatistics.errorCounts))
+		{
+			// Older histories also counted timeouts amongst the errors.
+			usbStatistics.errorCounts.erase(LIBUSB_ERROR_TIMEOUT);
+			sessions.back().usbStatistics = usbStatistics;
+		}
+		else
+		{
+			// Processes append to the history concurrently, so a line may have been mangled rather than the whole file.
+			invalidLineCount++;
+		}
+	}
+
+	FileClose(file);
+
+	if (invalidLineCount > 0)
+		Interface::PrintWarning("Skipped %u invalid lines of throughput history \"%s\"\n", invalidLineCount, filename.c_str());
+
+	return (true);
+}
+
+bool ThroughputHistory::Append(const ThroughputSession& session) const
+{
+	char numbers[64];
+
+	sprintf(numbers, "session %lld %u %u ", session.time, (session.success) ? 1 : 0, session.milliseconds);
+
+	string records = numbers;
+	records += session.model + " " + session.port + " " + ((!session.serialNumber.empty()) ? session.serialNumber : "-") + "\n";
+
+	for (vector<ThroughputTransfer>::const_iterator it = session.transfers.begin(); it != session.transfers.end(); it++)
+	{
+		sprintf(numbers, "transfer %llu %u ", it->bytes, it->milliseconds);
+		records += numbers + it->partitionName + "\n";
+	}
+
+	const UsbStatistics& usbStatistics = session.usbStatistics;
+
+	sprintf(numbers, "usb %u %u %u %u", usbStatistics.transferCount, usbStatistics.retryCount, usbStatistics.filePartRetryCount,
+		usbStatistics.timeoutCount);
+	records += numbers;
+
+	for (map<int, unsigned int>::const_iterator it = usbStatistics.errorCounts.begin(); it != usbStatistics.errorCounts.end(); it++)
+	{
+		sprintf(numbers, " %d:%u", it->first, it->second);
+		records += numbers;
+	}
+
+	records += "\n";
+
+	// Written with a single append, so that sessions appended by other processes aren't interleaved with this one. A buffered
+	// stream may split the records across several writes.
+#ifdef _WIN32
+
+	HANDLE fileHandle = CreateFileA(filename.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return (false);
+
+	DWORD bytesWritten = 0;
+	bool success = WriteFile(fileHandle, records.data(), (DWORD)records.size(), &bytesWritten, nullptr) && bytesWritten == records.size();
+
+	if (!CloseHandle(fileHandle))
+		success = false;
+
+#else
+
+	int fileDescriptor;
+
+	do
+	{
+		fileDescriptor = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	} while (fileDescriptor < 0 && errno == EINTR);
+
+	if (fileDescriptor < 0)
+		return (false);
+
+	ssize_t bytesWritten;
+
+	do
+	{
+		bytesWritten = write(fileDescriptor, records.data(), records.size());
+	} while (bytesWritten < 0 && errno == EINTR);
+
+	bool success = bytesWritten >= 0 && (size_t)bytesWritten == records.size();
+
+	if (close(fileDescriptor) != 0)
+		success = false;
+
+#endif
+
+	return (success);
+}
+
+unsigned int ThroughputHistory::GetBytesPerSecond(const string& model, const string& partitionName, double& bytesPerSecond) const
+{
+	unsigned long long bytes = 0;
+	unsigned long long milliseconds = 0;
+	unsigned int sampleCount = 0;
+
+	for (vector<ThroughputSession>::const_reverse_iterator session = sessions.rbegin(); session != sessions.rend()
+		&& sampleCount < kSampleCount; session++)
+	{
+		if (!MatchesModel(session->model, model))
+			continue;
+
+		for (vector<ThroughputTransfer>::const_iterator transfer = session->transfers.begin(); transfer != session->transfers.end()
+			&& sampleCount < kSampleCount; transfer++)
+		{
+			if ((partitionName.empty() || transfer->partitionName == partitionName) && transfer->milliseconds > 0)
+			{
+				bytes += transfer->bytes;
+				milliseconds += transfer->milliseconds;
+				sampleCount++;
+			}
+		}
+	}
+
+	if (sampleCount == 0)
+		return ((!partitionName.empty()) ? GetBytesPerSecond(model, "", bytesPerSecond) : 0);
+
+	bytesPerSecond = bytes * 1000.0 / milliseconds;
+
+	return (sampleCount);
+}
+
+unsigned int ThroughputHistory::GetOverheadSeconds(const string& model, double& seconds) const
+{
+	vector<unsigned int> overheads;
+
+	for (vector<ThroughputSession>::const_reverse_iterator session = sessions.rbegin(); session != sessions.rend()
+		&& overheads.size() < kSampleCount; session++)
+	{
+		if (!session->success || !MatchesModel(session->model, model))
+			continue;
+
+		unsigned int transferMilliseconds = 0;
+
+		for (vector<ThroughputTransfer>::const_iterator transfer = session->transfers.begin(); transfer != session->transfers.end();
+			transfer++)
+		{
+			transferMilliseconds += transfer->milliseconds;
+		}
+
+		overheads.push_back((session->milliseconds > transferMilliseconds) ? session->milliseconds - transferMilliseconds : 0);
+	}
+
+	if (overheads.empty())
+		return (0);
+
+	// The median, as the occasional device that's slow to connect shouldn't skew every estimate.
+	sort(overheads.begin(), overheads.end());
+	seconds = overheads[overheads.size() / 2] / 1000.0;
+
+	return (overheads.size());
+}
+
+bool ThroughputHistory::MatchesModel(const string& key, const string& model)
+{
+	if (key.size() < model.size() || key.compare(0, model.size(), model) != 0)
+		return (false);
+
+	return (key.size() == model.size() || key[model.size()] == ':');
+}
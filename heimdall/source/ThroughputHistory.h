@@ -0,0 +1,99 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef THROUGHPUTHISTORY_H
+#define THROUGHPUTHISTORY_H
+
+// C/C++ Standard Library
+#include <string>
+#include <vector>
+
+// Heimdall
+#include "BridgeManager.h"
+#include "Heimdall.h"
+
+namespace Heimdall
+{
+	struct ThroughputTransfer
+	{
+		std::string partitionName;
+		unsigned long long bytes;
+		unsigned int milliseconds;
+	};
+
+	struct ThroughputSession
+	{
+		long long time; // Seconds since the epoch, when the session ended.
+		std::string model; // A transfer profile key i.e. vendor:product:release, or vendor:product if the session never began.
+		std::string port;
+		std::string serialNumber;
+
+		bool success;
+		unsigned int milliseconds; // From connecting to the device until the session ended.
+
+		std::vector<ThroughputTransfer> transfers;
+		UsbStatistics usbStatistics;
+	};
+
+	// Flat file of the metrics of past sessions, i.e. their throughput and USB errors, which is only ever appended to so that
+	// it may be shared by several processes.
+	class ThroughputHistory
+	{
+		public:
+
+			enum
+			{
+				kSampleCount = 20 // Estimates are based on at most this many of the most recent samples.
+			};
+
+		private:
+
+			std::string filename;
+			std::vector<ThroughputSession> sessions;
+
+		public:
+
+			ThroughputHistory(const std::string& filename);
+
+			// A missing file is treated as containing no sessions.
+			bool Load(void);
+			bool Append(const ThroughputSession& session) const;
+
+			// In the order they were appended.
+			const std::vector<ThroughputSession>& GetSessions(void) const
+			{
+				return (sessions);
+			}
+
+			// model may omit the release (i.e. vendor:product) to match every release. When partitionName is empty, or there are no
+			// transfers to a partition of that name, every partition's transfers are sampled. Returns the number of transfers
+			// sampled, if any.
+			unsigned int GetBytesPerSecond(const std::string& model, const std::string& partitionName, double& bytesPerSecond) const;
+
+			// Time spent by successful sessions other than transferring files e.g. connecting and ending the session. Returns
+			// the number of sessions sampled, if any.
+			unsigned int GetOverheadSeconds(const std::string& model, double& seconds) const;
+
+			// Keys are lower-case, as is model expected to be.
+			static bool MatchesModel(const std::string& key, const std::string& model);
+	};
+}
+
+#endif
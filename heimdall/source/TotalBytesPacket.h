@@ -30,6 +30,8 @@ namespace Heimdall
 	{
 		private:
 
+			typedef NextPacketField<SessionSetupPacket::RequestField> TotalBytesField;
+
 			unsigned int totalBytes;
 
 		public:
@@ -48,7 +50,7 @@ namespace Heimdall
 			{
 				SessionSetupPacket::Pack();
 
-				PackInteger(SessionSetupPacket::kDataSize, totalBytes);
+				PackField<TotalBytesField>(totalBytes);
 			}
 	};
 }
@@ -0,0 +1,135 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <cerrno>
+#include <cstdio>
+
+// Heimdall
+#include "Heimdall.h"
+#include "Interface.h"
+#include "TransferProfiles.h"
+
+using namespace std;
+using namespace Heimdall;
+
+TransferProfiles::TransferProfiles(const string& filename)
+{
+	this->filename = filename;
+}
+
+bool TransferProfiles::Load(void)
+{
+	profiles.clear();
+
+	FILE *file = FileOpen(filename.c_str(), "r");
+
+	if (!file)
+	{
+		if (errno == ENOENT)
+			return (true);
+
+		Interface::PrintError("Failed to open transfer profiles \"%s\"\n", filename.c_str());
+		return (false);
+	}
+
+	char line[256];
+	unsigned int lineNumber = 0;
+	bool success = true;
+
+	while (fgets(line, sizeof(line), file))
+	{
+		lineNumber++;
+
+		if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+			continue;
+
+		char key[32];
+		TransferProfile profile;
+
+		if (sscanf(line, "%31s %u %u %u", key, &profile.filePartSize, &profile.sequenceMaxLength, &profile.bytesPerSecond) != 4
+			|| profile.filePartSize == 0 || profile.sequenceMaxLength == 0)
+		{
+			Interface::PrintError("Invalid transfer profile on line %u of \"%s\"\n", lineNumber, filename.c_str());
+			success = false;
+			break;
+		}
+
+		profiles[key] = profile;
+	}
+
+	FileClose(file);
+
+	return (success);
+}
+
+bool TransferProfiles::Save(void) const
+{
+	string temporaryFilename = filename + ".tmp";
+
+	// Write then rename, so that an interrupted write never loses the existing profiles.
+	FILE *file = FileOpen(temporaryFilename.c_str(), "w");
+
+	if (!file)
+		return (false);
+
+	bool success = fprintf(file, "# vendor:product:release file-part-size sequence-length bytes-per-second\n") > 0;
+
+	for (map<string, TransferProfile>::const_iterator it = profiles.begin(); success && it != profiles.end(); it++)
+	{
+		success = fprintf(file, "%s %u %u %u\n", it->first.c_str(), it->second.filePartSize, it->second.sequenceMaxLength,
+			it->second.bytesPerSecond) > 0;
+	}
+
+	if (FileClose(file) != 0)
+		success = false;
+
+	if (success)
+	{
+#ifdef _WIN32
+		remove(filename.c_str());
+#endif
+		success = rename(temporaryFilename.c_str(), filename.c_str()) == 0;
+	}
+
+	if (!success)
+		remove(temporaryFilename.c_str());
+
+	return (success);
+}
+
+const TransferProfile *TransferProfiles::Find(const string& key) const
+{
+	map<string, TransferProfile>::const_iterator it = profiles.find(key);
+	return ((it != profiles.end()) ? &it->second : nullptr);
+}
+
+void TransferProfiles::Set(const string& key, const TransferProfile& profile)
+{
+	profiles[key] = profile;
+}
+
+string TransferProfiles::GetKey(unsigned int vendorId, unsigned int productId, unsigned int deviceRelease)
+{
+	char key[16];
+	sprintf(key, "%04x:%04x:%04x", vendorId & 0xFFFF, productId & 0xFFFF, deviceRelease & 0xFFFF);
+
+	return (key);
+}
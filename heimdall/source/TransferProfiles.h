@@ -0,0 +1,64 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef TRANSFERPROFILES_H
+#define TRANSFERPROFILES_H
+
+// C/C++ Standard Library
+#include <map>
+#include <string>
+
+// Heimdall
+#include "Heimdall.h"
+
+namespace Heimdall
+{
+	struct TransferProfile
+	{
+		unsigned int filePartSize;
+		unsigned int sequenceMaxLength;
+		unsigned int bytesPerSecond; // Throughput measured when the profile was tuned.
+	};
+
+	// File of tuned file transfer parameters, keyed by USB vendor ID, product ID and device release (i.e. bootloader).
+	class TransferProfiles
+	{
+		private:
+
+			std::string filename;
+			std::map<std::string, TransferProfile> profiles;
+
+		public:
+
+			TransferProfiles(const std::string& filename);
+
+			// A missing file is treated as containing no profiles.
+			bool Load(void);
+			bool Save(void) const;
+
+			// Returns nullptr if there's no profile for the key.
+			const TransferProfile *Find(const std::string& key) const;
+			void Set(const std::string& key, const TransferProfile& profile);
+
+			static std::string GetKey(unsigned int vendorId, unsigned int productId, unsigned int deviceRelease);
+	};
+}
+
+#endif
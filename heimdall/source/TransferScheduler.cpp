@@ -0,0 +1,161 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <stdio.h>
+
+// Heimdall
+#include "Interface.h"
+#include "TransferScheduler.h"
+
+using namespace std;
+using namespace Heimdall;
+
+TransferScheduler::Slot::Slot(TransferScheduler *transferScheduler, int busNumber, const vector<unsigned char>& portNumbers,
+	unsigned int bytesPerSecond)
+{
+	this->transferScheduler = transferScheduler;
+	this->bytesPerSecond = bytesPerSecond;
+
+	if (transferScheduler)
+	{
+		hubs = GetHubs(busNumber, portNumbers);
+		transferScheduler->Acquire(hubs, bytesPerSecond);
+	}
+}
+
+TransferScheduler::Slot::~Slot()
+{
+	if (transferScheduler)
+		transferScheduler->Release(hubs, bytesPerSecond);
+}
+
+TransferScheduler::TransferScheduler(unsigned long long hubBytesPerSecond)
+{
+	this->hubBytesPerSecond = hubBytesPerSecond;
+}
+
+bool TransferScheduler::CanAdmit(const Request *request) const
+{
+	// Requests that share a hub are admitted in order, so a demanding transfer isn't starved by a stream of lesser ones.
+	for (list<const Request *>::const_iterator it = waiting.begin(); it != waiting.end() && *it != request; it++)
+	{
+		for (vector<string>::const_iterator hub = request->hubs->begin(); hub != request->hubs->end(); hub++)
+		{
+			for (vector<string>::const_iterator otherHub = (*it)->hubs->begin(); otherHub != (*it)->hubs->end(); otherHub++)
+			{
+				if (*hub == *otherHub)
+					return (false);
+			}
+		}
+	}
+
+	for (vector<string>::const_iterator hub = request->hubs->begin(); hub != request->hubs->end(); hub++)
+	{
+		map<string, HubUsage>::const_iterator usage = hubUsage.find(*hub);
+
+		if (usage != hubUsage.end() && usage->second.bytesPerSecond + request->bytesPerSecond > hubBytesPerSecond)
+			return (false);
+	}
+
+	return (true);
+}
+
+void TransferScheduler::Acquire(const vector<string>& hubs, unsigned int bytesPerSecond)
+{
+	Request request;
+	request.hubs = &hubs;
+	request.bytesPerSecond = bytesPerSecond;
+
+	unique_lock<std::mutex> lock(mutex);
+
+	waiting.push_back(&request);
+
+	if (!CanAdmit(&request))
+	{
+		lock.unlock();
+		Interface::Print("Waiting for USB bandwidth...\n");
+		lock.lock();
+
+		while (!CanAdmit(&request))
+			admitted.wait(lock);
+	}
+
+	waiting.remove(&request);
+
+	for (vector<string>::const_iterator hub = hubs.begin(); hub != hubs.end(); hub++)
+	{
+		map<string, HubUsage>::iterator usage = hubUsage.find(*hub);
+
+		if (usage == hubUsage.end())
+		{
+			HubUsage newUsage;
+			newUsage.transferCount = 1;
+			newUsage.bytesPerSecond = bytesPerSecond;
+
+			hubUsage[*hub] = newUsage;
+		}
+		else
+		{
+			usage->second.transferCount++;
+			usage->second.bytesPerSecond += bytesPerSecond;
+		}
+	}
+
+	// Requests queued behind this one may now be admissible.
+	admitted.notify_all();
+}
+
+void TransferScheduler::Release(const vector<string>& hubs, unsigned int bytesPerSecond)
+{
+	lock_guard<std::mutex> lock(mutex);
+
+	for (vector<string>::const_iterator hub = hubs.begin(); hub != hubs.end(); hub++)
+	{
+		map<string, HubUsage>::iterator usage = hubUsage.find(*hub);
+
+		if (--usage->second.transferCount == 0)
+			hubUsage.erase(usage);
+		else
+			usage->second.bytesPerSecond -= bytesPerSecond;
+	}
+
+	admitted.notify_all();
+}
+
+vector<string> TransferScheduler::GetHubs(int busNumber, const vector<unsigned char>& portNumbers)
+{
+	char number[16];
+	vector<string> hubs;
+
+	sprintf(number, "%d", busNumber);
+	string hub = number;
+	hubs.push_back(hub);
+
+	// The last port number is the device's own port, on its nearest hub.
+	for (unsigned int i = 0; i + 1 < portNumbers.size(); i++)
+	{
+		sprintf(number, "%c%u", (i == 0) ? '-' : '.', portNumbers[i]);
+		hub += number;
+		hubs.push_back(hub);
+	}
+
+	return (hubs);
+}
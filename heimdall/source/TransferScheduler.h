@@ -0,0 +1,106 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef TRANSFERSCHEDULER_H
+#define TRANSFERSCHEDULER_H
+
+// C/C++ Standard Library
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Heimdall
+#include "Heimdall.h"
+
+namespace Heimdall
+{
+	// Shares the bandwidth of each USB hub between the file transfers of concurrent sessions. Every hub between a device and the
+	// host, including the root hub, has the same budget. A transfer waits until its expected throughput fits within the budget
+	// of each of its hubs, so that a saturated upstream link doesn't make transfers already under way time out. A hub with
+	// no active transfers always admits one, however demanding. Transfers sharing a hub are admitted in the order they asked.
+	class TransferScheduler
+	{
+		public:
+
+			enum
+			{
+				kDefaultDeviceBytesPerSecond = 16 * 1048576 // Assumed when a device has no tuned transfer profile.
+			};
+
+			// Holds a transfer's share of its hubs' bandwidth for its lifetime.
+			class Slot
+			{
+				private:
+
+					TransferScheduler *transferScheduler;
+					std::vector<std::string> hubs;
+					unsigned int bytesPerSecond;
+
+					Slot(const Slot&);
+					Slot& operator=(const Slot&);
+
+				public:
+
+					// Blocks until the transfer is admitted. transferScheduler may be nullptr, in which case nothing is waited for.
+					Slot(TransferScheduler *transferScheduler, int busNumber, const std::vector<unsigned char>& portNumbers,
+						unsigned int bytesPerSecond);
+					~Slot();
+			};
+
+		private:
+
+			struct HubUsage
+			{
+				unsigned int transferCount;
+				unsigned long long bytesPerSecond;
+			};
+
+			struct Request
+			{
+				const std::vector<std::string> *hubs;
+				unsigned int bytesPerSecond;
+			};
+
+			unsigned long long hubBytesPerSecond;
+
+			std::mutex mutex;
+			std::condition_variable admitted;
+
+			std::list<const Request *> waiting;
+			std::map<std::string, HubUsage> hubUsage; // Absent for hubs with no active transfers.
+
+			bool CanAdmit(const Request *request) const;
+
+			void Acquire(const std::vector<std::string>& hubs, unsigned int bytesPerSecond);
+			void Release(const std::vector<std::string>& hubs, unsigned int bytesPerSecond);
+
+		public:
+
+			TransferScheduler(unsigned long long hubBytesPerSecond);
+
+			// Names the hubs between a device and the host e.g. "1" for the root hub of bus 1, then "1-2" for the hub on its port 2.
+			static std::vector<std::string> GetHubs(int busNumber, const std::vector<unsigned char>& portNumbers);
+	};
+}
+
+#endif
@@ -0,0 +1,421 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// libpit
+#include "libpit.h"
+
+// Heimdall
+#include "Arguments.h"
+#include "BridgeManager.h"
+#include "EndModemFileTransferPacket.h"
+#include "EndPhoneFileTransferPacket.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "SessionSetupResponse.h"
+#include "TotalBytesPacket.h"
+#include "TransferProfiles.h"
+#include "TuneAction.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace libpit;
+using namespace Heimdall;
+
+const char *TuneAction::usage = "Action: tune\n\
+Arguments: --partition <partition name> --file <filename>\n\
+    --transfer-profiles <filename> [--part-sizes <size,...>]\n\
+    [--sequence-lengths <length,...>] [--verbose] [--no-reboot] [--resume]\n\
+    [--stdout-errors] [--usb-log-level <none/error/warning/debug>]\n\
+Description: Measures upload throughput with different file part sizes and\n\
+    sequence lengths, by repeatedly flashing the specified file to the\n\
+    specified partition. Sequence lengths are measured first, then part sizes\n\
+    with the fastest sequence length. The fastest parameters are saved to the\n\
+    transfer profiles file for the device's model and bootloader, and are\n\
+    applied by actions given the same --transfer-profiles file.\n\
+    Part sizes default to 131072,262144,524288,1048576 bytes and sequence\n\
+    lengths to 4,8,15,30 parts.\n\
+Note: --no-reboot causes the device to remain in download mode after the action\n\
+      is completed. If you wish to perform another action whilst remaining in\n\
+      download mode, then the following action must specify the --resume flag.\n\
+WARNING: The partition is overwritten once for every measurement, so the file\n\
+         should be the image the partition is meant to contain.\n";
+
+static bool parseList(const string& listString, vector<unsigned int>& values)
+{
+	size_t start = 0;
+
+	while (start <= listString.length())
+	{
+		size_t end = listString.find(',', start);
+
+		if (end == string::npos)
+			end = listString.length();
+
+		unsigned int value;
+
+		if (Utility::ParseUnsignedInt(value, listString.substr(start, end - start).c_str()) != kNumberParsingStatusSuccess || value == 0)
+			return (false);
+
+		values.push_back(value);
+		start = end + 1;
+	}
+
+	return (true);
+}
+
+static bool sendTotalBytes(BridgeManager *bridgeManager, unsigned int totalBytes)
+{
+	TotalBytesPacket totalBytesPacket(totalBytes);
+
+	if (!bridgeManager->SendPacket(&totalBytesPacket))
+	{
+		Interface::PrintError("Failed to send total bytes packet!\n");
+		return (false);
+	}
+
+	SessionSetupResponse totalBytesResponse;
+
+	if (!bridgeManager->ReceivePacket(&totalBytesResponse))
+	{
+		Interface::PrintError("Failed to receive session total bytes response!\n");
+		return (false);
+	}
+
+	if (totalBytesResponse.GetResult() != 0)
+	{
+		Interface::PrintError("Unexpected session total bytes response!\nExpected: 0\nReceived:%d\n", totalBytesResponse.GetResult());
+		return (false);
+	}
+
+	return (true);
+}
+
+static const PitEntry *findPitEntry(BridgeManager *bridgeManager, const char *partitionName, PitData& pitData)
+{
+	unsigned char *pitFileBuffer;
+	int pitFileSize = bridgeManager->DownloadPitFile(&pitFileBuffer);
+
+	if (pitFileSize == 0)
+		return (nullptr);
+
+	bool unpacked = pitData.Unpack(pitFileBuffer, pitFileSize);
+	delete [] pitFileBuffer;
+
+	if (!unpacked)
+	{
+		Interface::PrintError("Failed to unpack device's PIT file!\n");
+		return (nullptr);
+	}
+
+	const PitEntry *pitEntry = pitData.FindEntry(partitionName);
+
+	if (!pitEntry)
+		Interface::PrintError("Partition \"%s\" does not exist in the device's PIT.\n", partitionName);
+
+	return (pitEntry);
+}
+
+static bool measure(BridgeManager *bridgeManager, const PitEntry *pitEntry, FILE *file, unsigned int fileSize, unsigned int filePartSize,
+	unsigned int sequenceMaxLength, double& bytesPerSecond)
+{
+	if (!bridgeManager->SetFileTransferParameters(filePartSize, sequenceMaxLength))
+		return (false);
+
+	Interface::Print("Uploading %s with %u byte file parts, %u parts per sequence\n", pitEntry->GetPartitionName(), filePartSize,
+		sequenceMaxLength);
+
+	FileRewind(file);
+
+	chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+	bool success;
+
+	if (pitEntry->GetBinaryType() == PitEntry::kBinaryTypeCommunicationProcessor) // Modem
+	{
+		success = bridgeManager->SendFile(file, EndModemFileTransferPacket::kDestinationModem, pitEntry->GetDeviceType());
+	}
+	else // pitEntry->GetBinaryType() == PitEntry::kBinaryTypeApplicationProcessor
+	{
+		success = bridgeManager->SendFile(file, EndPhoneFileTransferPacket::kDestinationPhone, pitEntry->GetDeviceType(),
+			pitEntry->GetIdentifier());
+	}
+
+	if (!success)
+	{
+		Interface::PrintError("%s upload failed!\n\n", pitEntry->GetPartitionName());
+		return (false);
+	}
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+	bytesPerSecond = (seconds > 0.0) ? fileSize / seconds : 0.0;
+
+	Interface::Print("%s upload successful, %.2f MiB/s\n\n", pitEntry->GetPartitionName(), bytesPerSecond / 1048576.0);
+	return (true);
+}
+
+static bool tune(BridgeManager *bridgeManager, const char *partitionName, FILE *file, unsigned int fileSize, vector<unsigned int> filePartSizes,
+	const vector<unsigned int>& sequenceLengths, TransferProfile& bestProfile)
+{
+	PitData pitData;
+	const PitEntry *pitEntry = findPitEntry(bridgeManager, partitionName, pitData);
+
+	if (!pitEntry)
+		return (false);
+
+	// Sequence lengths are measured with the session's part size, so it's never measured twice.
+	unsigned int sessionFilePartSize = bridgeManager->GetFileTransferPacketSize();
+
+	if (!bridgeManager->IsFilePartSizeSupported())
+	{
+		Interface::PrintWarning("The device doesn't support changing the file part size, only sequence lengths will be measured.\n\n");
+		filePartSizes.clear();
+	}
+
+	for (vector<unsigned int>::iterator it = filePartSizes.begin(); it != filePartSizes.end();)
+	{
+		if (*it == sessionFilePartSize)
+			it = filePartSizes.erase(it);
+		else
+			it++;
+	}
+
+	unsigned long long totalBytes = (unsigned long long)fileSize * (sequenceLengths.size() + filePartSizes.size());
+
+	if (totalBytes > 0xFFFFFFFFULL)
+	{
+		Interface::PrintError("The file is too large to be uploaded %u times in one session.\n",
+			(unsigned int)(sequenceLengths.size() + filePartSizes.size()));
+		return (false);
+	}
+
+	if (!sendTotalBytes(bridgeManager, (unsigned int)totalBytes))
+		return (false);
+
+	double bestBytesPerSecond = 0.0;
+	bestProfile.filePartSize = sessionFilePartSize;
+	bestProfile.sequenceMaxLength = sequenceLengths.front();
+
+	for (vector<unsigned int>::const_iterator it = sequenceLengths.begin(); it != sequenceLengths.end(); it++)
+	{
+		double bytesPerSecond;
+
+		if (!measure(bridgeManager, pitEntry, file, fileSize, sessionFilePartSize, *it, bytesPerSecond))
+			return (false);
+
+		if (bytesPerSecond > bestBytesPerSecond)
+		{
+			bestBytesPerSecond = bytesPerSecond;
+			bestProfile.sequenceMaxLength = *it;
+		}
+	}
+
+	for (vector<unsigned int>::const_iterator it = filePartSizes.begin(); it != filePartSizes.end(); it++)
+	{
+		double bytesPerSecond;
+
+		if (!measure(bridgeManager, pitEntry, file, fileSize, *it, bestProfile.sequenceMaxLength, bytesPerSecond))
+			return (false);
+
+		if (bytesPerSecond > bestBytesPerSecond)
+		{
+			bestBytesPerSecond = bytesPerSecond;
+			bestProfile.filePartSize = *it;
+		}
+	}
+
+	bestProfile.bytesPerSecond = (unsigned int)bestBytesPerSecond;
+	return (true);
+}
+
+int TuneAction::Execute(int argc, char **argv)
+{
+	// Handle arguments
+
+	map<string, ArgumentType> argumentTypes;
+	argumentTypes["partition"] = kArgumentTypeString;
+	argumentTypes["file"] = kArgumentTypeString;
+	argumentTypes["transfer-profiles"] = kArgumentTypeString;
+	argumentTypes["part-sizes"] = kArgumentTypeString;
+	argumentTypes["sequence-lengths"] = kArgumentTypeString;
+	argumentTypes["no-reboot"] = kArgumentTypeFlag;
+	argumentTypes["resume"] = kArgumentTypeFlag;
+	argumentTypes["verbose"] = kArgumentTypeFlag;
+	argumentTypes["stdout-errors"] = kArgumentTypeFlag;
+	argumentTypes["usb-log-level"] = kArgumentTypeString;
+
+	Arguments arguments(argumentTypes);
+
+	if (!arguments.ParseArguments(argc, argv, 2))
+	{
+		Interface::Print(TuneAction::usage);
+		return (0);
+	}
+
+	const StringArgument *partitionArgument = static_cast<const StringArgument *>(arguments.GetArgument("partition"));
+	const StringArgument *fileArgument = static_cast<const StringArgument *>(arguments.GetArgument("file"));
+	const StringArgument *transferProfilesArgument = static_cast<const StringArgument *>(arguments.GetArgument("transfer-profiles"));
+
+	if (!partitionArgument || !fileArgument || !transferProfilesArgument)
+	{
+		Interface::Print("A partition, file and transfer profiles file must be specified.\n\n");
+		Interface::Print(TuneAction::usage);
+		return (0);
+	}
+
+	const StringArgument *partSizesArgument = static_cast<const StringArgument *>(arguments.GetArgument("part-sizes"));
+	const StringArgument *sequenceLengthsArgument = static_cast<const StringArgument *>(arguments.GetArgument("sequence-lengths"));
+
+	vector<unsigned int> filePartSizes;
+	vector<unsigned int> sequenceLengths;
+
+	if (!parseList((partSizesArgument) ? partSizesArgument->GetValue() : "131072,262144,524288,1048576", filePartSizes)
+		|| !parseList((sequenceLengthsArgument) ? sequenceLengthsArgument->GetValue() : "4,8,15,30", sequenceLengths))
+	{
+		Interface::Print("Part sizes and sequence lengths must be comma separated positive integers.\n\n");
+		Interface::Print(TuneAction::usage);
+		return (0);
+	}
+
+	bool reboot = arguments.GetArgument("no-reboot") == nullptr;
+	bool resume = arguments.GetArgument("resume") != nullptr;
+	bool verbose = arguments.GetArgument("verbose") != nullptr;
+
+	if (arguments.GetArgument("stdout-errors") != nullptr)
+		Interface::SetStdoutErrors(true);
+
+	const StringArgument *usbLogLevelArgument = static_cast<const StringArgument *>(arguments.GetArgument("usb-log-level"));
+
+	BridgeManager::UsbLogLevel usbLogLevel = BridgeManager::UsbLogLevel::Default;
+
+	if (usbLogLevelArgument)
+	{
+		const string& usbLogLevelString = usbLogLevelArgument->GetValue();
+
+		if (usbLogLevelString.compare("none") == 0 || usbLogLevelString.compare("NONE") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::None;
+		}
+		else if (usbLogLevelString.compare("error") == 0 || usbLogLevelString.compare("ERROR") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Error;
+		}
+		else if (usbLogLevelString.compare("warning") == 0 || usbLogLevelString.compare("WARNING") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Warning;
+		}
+		else if (usbLogLevelString.compare("info") == 0 || usbLogLevelString.compare("INFO") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Info;
+		}
+		else if (usbLogLevelString.compare("debug") == 0 || usbLogLevelString.compare("DEBUG") == 0)
+		{
+			usbLogLevel = BridgeManager::UsbLogLevel::Debug;
+		}
+		else
+		{
+			Interface::Print("Unknown USB log level: %s\n\n", usbLogLevelString.c_str());
+			Interface::Print(TuneAction::usage);
+			return (0);
+		}
+	}
+
+	TransferProfiles transferProfiles(transferProfilesArgument->GetValue());
+
+	if (!transferProfiles.Load())
+		return (1);
+
+	// Open file
+
+	const char *filename = fileArgument->GetValue().c_str();
+	FILE *file = FileOpen(filename, "rb");
+
+	if (!file)
+	{
+		Interface::PrintError("Failed to open file \"%s\"\n", filename);
+		return (1);
+	}
+
+	FileSeek(file, 0, SEEK_END);
+	long long fileSize = FileTell(file);
+	FileRewind(file);
+
+	if (fileSize <= 0 || fileSize > 0xFFFFFFFFLL)
+	{
+		Interface::PrintError("File \"%s\" is empty or too large.\n", filename);
+		FileClose(file);
+		return (1);
+	}
+
+	// Info
+
+	Interface::PrintReleaseInfo();
+	Sleep(1000);
+
+	// Perform measurements
+
+	BridgeManager *bridgeManager = new BridgeManager(verbose);
+	bridgeManager->SetUsbLogLevel(usbLogLevel);
+
+	if (bridgeManager->Initialise(resume) != BridgeManager::kInitialiseSucceeded || !bridgeManager->BeginSession())
+	{
+		FileClose(file);
+		delete bridgeManager;
+
+		return (1);
+	}
+
+	TransferProfile bestProfile;
+	bool success = tune(bridgeManager, partitionArgument->GetValue().c_str(), file, (unsigned int)fileSize, filePartSizes, sequenceLengths,
+		bestProfile);
+
+	if (success)
+	{
+		string key = bridgeManager->GetTransferProfileKey();
+
+		Interface::Print("Fastest for %s: %u byte file parts, %u parts per sequence, %.2f MiB/s\n", key.c_str(), bestProfile.filePartSize,
+			bestProfile.sequenceMaxLength, bestProfile.bytesPerSecond / 1048576.0);
+
+		transferProfiles.Set(key, bestProfile);
+
+		if (transferProfiles.Save())
+		{
+			Interface::Print("Transfer profile saved to \"%s\"\n\n", transferProfilesArgument->GetValue().c_str());
+		}
+		else
+		{
+			Interface::PrintError("Failed to save transfer profiles to \"%s\"\n", transferProfilesArgument->GetValue().c_str());
+			success = false;
+		}
+	}
+
+	if (!bridgeManager->EndSession(reboot))
+		success = false;
+
+	delete bridgeManager;
+
+	FileClose(file);
+
+	return (success ? 0 : 1);
+}
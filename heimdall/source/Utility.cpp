@@ -21,7 +21,9 @@
 // C/C++ Standard Library
 #include <cerrno>
 #include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string>
 
 // Heimdall
 #include "Heimdall.h"
@@ -80,3 +82,99 @@ NumberParsingStatus Utility::ParseUnsignedInt(unsigned int &uintValue, const cha
 	uintValue = ulongValue;
 	return (kNumberParsingStatusSuccess);
 }
+
+// Returns the length of the valid UTF-8 sequence starting at value[index], or 0 if there isn't one.
+static unsigned int getUtf8SequenceLength(const std::string& value, size_t index)
+{
+	unsigned char lead = value[index];
+	unsigned int length;
+
+	// The bounds of the second byte exclude overlong encodings, surrogates and code points beyond U+10FFFF.
+	unsigned char secondMin = 0x80;
+	unsigned char secondMax = 0xBF;
+
+	if (lead >= 0xC2 && lead <= 0xDF)
+	{
+		length = 2;
+	}
+	else if (lead >= 0xE0 && lead <= 0xEF)
+	{
+		length = 3;
+
+		if (lead == 0xE0)
+			secondMin = 0xA0;
+		else if (lead == 0xED)
+			secondMax = 0x9F;
+	}
+	else if (lead >= 0xF0 && lead <= 0xF4)
+	{
+		length = 4;
+
+		if (lead == 0xF0)
+			secondMin = 0x90;
+		else if (lead == 0xF4)
+			secondMax = 0x8F;
+	}
+	else
+	{
+		return (0);
+	}
+
+	if (index + length > value.size())
+		return (0);
+
+	for (unsigned int i = 1; i < length; i++)
+	{
+		unsigned char continuation = value[index + i];
+
+		if (continuation < ((i == 1) ? secondMin : 0x80) || continuation > ((i == 1) ? secondMax : 0xBF))
+			return (0);
+	}
+
+	return (length);
+}
+
+void Utility::AppendJsonString(std::string& json, const std::string& value)
+{
+	char escape[8];
+
+	json += '"';
+
+	for (size_t i = 0; i < value.size(); i++)
+	{
+		unsigned char character = value[i];
+
+		if (character == '"' || character == '\\')
+		{
+			json += '\\';
+			json += character;
+		}
+		else if (character < 0x20 || character == 0x7F)
+		{
+			sprintf(escape, "\\u%04x", character);
+			json += escape;
+		}
+		else if (character < 0x80)
+		{
+			json += character;
+		}
+		else
+		{
+			// Text is passed through as UTF-8, but a byte that isn't part of a valid sequence is escaped as Latin-1.
+			unsigned int sequenceLength = getUtf8SequenceLength(value, i);
+
+			if (sequenceLength > 0)
+			{
+				json.append(value, i, sequenceLength);
+				i += sequenceLength - 1;
+			}
+			else
+			{
+				sprintf(escape, "\\u%04x", character);
+				json += escape;
+			}
+		}
+	}
+
+	json += '"';
+}
@@ -21,6 +21,9 @@
 #ifndef UTILITY_H
 #define UTILITY_H
 
+// C/C++ Standard Library
+#include <string>
+
 namespace Heimdall
 {
 	typedef enum
@@ -34,6 +37,10 @@ namespace Heimdall
 	{
 		NumberParsingStatus ParseInt(int &intValue, const char *string, int base = 0);
 		NumberParsingStatus ParseUnsignedInt(unsigned int &uintValue, const char *string, int base = 0);
+
+		// Appends value as a quoted JSON string. Valid UTF-8 is passed through, whereas control characters, DEL and bytes that
+		// aren't part of a valid UTF-8 sequence are escaped, the latter as Latin-1.
+		void AppendJsonString(std::string& json, const std::string& value);
 	}
 }
 
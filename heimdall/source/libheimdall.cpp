@@ -0,0 +1,622 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+// C/C++ Standard Library
+#include <algorithm>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// libpit
+#include "libpit.h"
+
+// Heimdall
+#include "BridgeManager.h"
+#include "FlashAction.h"
+#include "Heimdall.h"
+#include "ImageStore.h"
+#include "Interface.h"
+#include "libheimdall.h"
+#include "Progress.h"
+
+using namespace std;
+using namespace libpit;
+using namespace Heimdall;
+
+enum
+{
+	kSourceBufferSize = 262144
+};
+
+// Shared by every session, so that a file flashed to several devices at once is only read once.
+static ImageStore imageStore;
+
+struct heimdall_session : public Progress::Listener
+{
+	BridgeManager *bridgeManager;
+	bool verbose;
+
+	heimdall_log_callback logCallback;
+	void *logUserData;
+
+	heimdall_progress_callback progressCallback;
+	void *progressUserData;
+
+	string lastError;
+
+	string phase;
+	string partitionName;
+
+	// The device's PIT, downloaded on demand.
+	vector<unsigned char> pitBuffer;
+	PitData *pitData;
+
+	heimdall_session()
+	{
+		bridgeManager = nullptr;
+		verbose = false;
+
+		logCallback = nullptr;
+		logUserData = nullptr;
+
+		progressCallback = nullptr;
+		progressUserData = nullptr;
+
+		pitData = nullptr;
+	}
+
+	~heimdall_session()
+	{
+		delete pitData;
+		delete bridgeManager;
+	}
+
+	void ClearPit(void)
+	{
+		pitBuffer.clear();
+
+		delete pitData;
+		pitData = nullptr;
+	}
+
+	void Phase(const char *phase, const char *partitionName)
+	{
+		this->phase = phase;
+		this->partitionName = partitionName ? partitionName : "";
+
+		if (progressCallback)
+			progressCallback(phase, partitionName, 0, 0, progressUserData);
+	}
+
+	void BeginTransfer(unsigned int totalBytes)
+	{
+		if (progressCallback)
+			progressCallback(phase.c_str(), partitionName.empty() ? nullptr : partitionName.c_str(), 0, totalBytes, progressUserData);
+	}
+
+	void Transfer(unsigned int bytesTransferred, unsigned int totalBytes)
+	{
+		if (progressCallback)
+		{
+			progressCallback(phase.c_str(), partitionName.empty() ? nullptr : partitionName.c_str(), bytesTransferred, totalBytes,
+				progressUserData);
+		}
+	}
+
+	void Retry(unsigned int)
+	{
+	}
+
+	void EndTransfer(void)
+	{
+	}
+
+	void Error(const char *message)
+	{
+		lastError = message;
+
+		while (!lastError.empty() && (lastError.back() == '\n' || lastError.back() == '\r'))
+			lastError.pop_back();
+	}
+};
+
+static void sessionOutput(const char *text, bool error, void *userData)
+{
+	heimdall_session *session = static_cast<heimdall_session *>(userData);
+
+	if (session->logCallback)
+		session->logCallback(text, error ? 1 : 0, session->logUserData);
+}
+
+static void discardOutput(const char *, bool, void *)
+{
+}
+
+// Directs Heimdall's output on the calling thread for the lifetime of a call into the library. The host's own output function, if
+// it embeds Heimdall on the same thread, is restored afterwards.
+class OutputScope
+{
+	private:
+
+		Interface::OutputFunction previousOutputFunction;
+		void *previousUserData;
+
+	public:
+
+		OutputScope(Interface::OutputFunction outputFunction, void *userData)
+		{
+			Interface::GetOutputFunction(previousOutputFunction, previousUserData);
+			Interface::SetOutputFunction(outputFunction, userData);
+		}
+
+		~OutputScope()
+		{
+			Interface::SetOutputFunction(previousOutputFunction, previousUserData);
+		}
+};
+
+// Directs Heimdall's output and progress on the calling thread to a session, for the lifetime of a call into the session.
+class SessionScope
+{
+	private:
+
+		OutputScope outputScope;
+
+		Progress::Listener *previousListener;
+		int previousFormat;
+
+	public:
+
+		SessionScope(heimdall_session *session) : outputScope(sessionOutput, session)
+		{
+			previousListener = Progress::GetListener();
+			previousFormat = Progress::GetFormat();
+
+			session->lastError.clear();
+
+			Progress::SetFormat(Progress::kFormatNone);
+			Progress::SetListener(session);
+		}
+
+		~SessionScope()
+		{
+			Progress::SetListener(previousListener);
+			Progress::SetFormat(previousFormat);
+		}
+};
+
+static int downloadPit(heimdall_session *session)
+{
+	if (session->pitData)
+		return (HEIMDALL_SUCCESS);
+
+	unsigned char *pitFileBuffer;
+	int pitFileSize = session->bridgeManager->DownloadPitFile(&pitFileBuffer);
+
+	if (pitFileSize == 0)
+		return (HEIMDALL_ERROR_PIT);
+
+	PitData *pitData = new PitData();
+
+	if (!pitData->Unpack(pitFileBuffer, pitFileSize))
+	{
+		Interface::PrintError("Failed to unpack device's PIT file!\n");
+
+		delete [] pitFileBuffer;
+		delete pitData;
+		return (HEIMDALL_ERROR_PIT);
+	}
+
+	session->pitBuffer.assign(pitFileBuffer, pitFileBuffer + pitFileSize);
+	session->pitData = pitData;
+
+	delete [] pitFileBuffer;
+
+	return (HEIMDALL_SUCCESS);
+}
+
+static bool openSource(const heimdall_flash_source *source, vector<FlashAction::PartitionFile>& partitionFiles)
+{
+	if (source->filename)
+	{
+		shared_ptr<const Image> image = imageStore.Open(source->filename);
+
+		if (!image)
+		{
+			Interface::PrintError("Failed to open file \"%s\"\n", source->filename);
+			return (false);
+		}
+
+		partitionFiles.push_back(FlashAction::PartitionFile(source->partition, image));
+		return (true);
+	}
+
+	if (source->data)
+	{
+		if (source->size > 0xFFFFFFFF)
+		{
+			Interface::PrintError("Data for partition %s is too large\n", source->partition);
+			return (false);
+		}
+
+		// Sent in place, so the caller's buffer is shared by any other sessions it's passed to.
+		shared_ptr<const Image> image = make_shared<const Image>(static_cast<const unsigned char *>(source->data),
+			(unsigned int)source->size);
+
+		partitionFiles.push_back(FlashAction::PartitionFile(source->partition, image));
+		return (true);
+	}
+
+	// Callback data is buffered in a temporary file, as its size must be known before the transfer begins.
+	FILE *file = tmpfile();
+
+	if (!file)
+	{
+		Interface::PrintError("Failed to create a temporary file for partition %s\n", source->partition);
+		return (false);
+	}
+
+	vector<unsigned char> buffer(kSourceBufferSize);
+
+	while (true)
+	{
+		long dataRead = source->read_callback(buffer.data(), buffer.size(), source->user_data);
+
+		if (dataRead == 0)
+			break;
+
+		if (dataRead < 0 || (size_t)dataRead > buffer.size())
+		{
+			Interface::PrintError("Failed to read data for partition %s\n", source->partition);
+
+			FileClose(file);
+			return (false);
+		}
+
+		if (fwrite(buffer.data(), 1, dataRead, file) != (size_t)dataRead)
+		{
+			Interface::PrintError("Failed to buffer data for partition %s\n", source->partition);
+
+			FileClose(file);
+			return (false);
+		}
+	}
+
+	FileRewind(file);
+
+	partitionFiles.push_back(FlashAction::PartitionFile(source->partition, file));
+	return (true);
+}
+
+static void closeSources(vector<FlashAction::PartitionFile>& partitionFiles)
+{
+	for (FlashAction::PartitionFile& partitionFile : partitionFiles)
+	{
+		if (partitionFile.file)
+			FileClose(partitionFile.file);
+	}
+
+	partitionFiles.clear();
+}
+
+const char *heimdall_error_string(int error)
+{
+	switch (error)
+	{
+		case HEIMDALL_SUCCESS:
+			return ("Success");
+
+		case HEIMDALL_ERROR_INVALID_ARGUMENT:
+			return ("Invalid argument");
+
+		case HEIMDALL_ERROR_INVALID_STATE:
+			return ("Invalid session state");
+
+		case HEIMDALL_ERROR_USB:
+			return ("USB error");
+
+		case HEIMDALL_ERROR_DEVICE_NOT_FOUND:
+			return ("Device not found");
+
+		case HEIMDALL_ERROR_CONNECTION:
+			return ("Failed to communicate with the device");
+
+		case HEIMDALL_ERROR_PIT:
+			return ("Failed to retrieve the device's PIT");
+
+		case HEIMDALL_ERROR_BUFFER_TOO_SMALL:
+			return ("Buffer too small");
+
+		case HEIMDALL_ERROR_SOURCE:
+			return ("Failed to read flash source");
+
+		case HEIMDALL_ERROR_FLASH:
+			return ("Flash failed");
+
+		default:
+			return ("Unknown error");
+	}
+}
+
+int heimdall_enumerate_devices(heimdall_device_info *devices, size_t capacity, size_t *count)
+{
+	if (!count || (capacity > 0 && !devices))
+		return (HEIMDALL_ERROR_INVALID_ARGUMENT);
+
+	*count = 0;
+
+	// There's no session to log to, failures are reported by the result alone.
+	OutputScope scope(discardOutput, nullptr);
+
+	vector<DeviceLocation> deviceLocations;
+
+	if (!BridgeManager::EnumerateDevices(deviceLocations))
+		return (HEIMDALL_ERROR_USB);
+
+	for (vector<DeviceLocation>::const_iterator it = deviceLocations.begin(); it != deviceLocations.end(); it++)
+	{
+		if (*count < capacity)
+		{
+			heimdall_device_info *device = &devices[*count];
+
+			device->vendor_id = it->vendorId;
+			device->product_id = it->productId;
+			device->bus_number = it->busNumber;
+			device->device_address = it->deviceAddress;
+
+			device->port_number_count = (it->portNumbers.size() < HEIMDALL_MAX_PORT_NUMBERS) ? (int)it->portNumbers.size()
+				: (int)HEIMDALL_MAX_PORT_NUMBERS;
+			copy(it->portNumbers.begin(), it->portNumbers.begin() + device->port_number_count, device->port_numbers);
+		}
+
+		(*count)++;
+	}
+
+	return (HEIMDALL_SUCCESS);
+}
+
+int heimdall_session_create(heimdall_session **session)
+{
+	if (!session)
+		return (HEIMDALL_ERROR_INVALID_ARGUMENT);
+
+	*session = new heimdall_session();
+
+	return (HEIMDALL_SUCCESS);
+}
+
+void heimdall_session_destroy(heimdall_session *session)
+{
+	if (!session)
+		return;
+
+	if (session->bridgeManager)
+		heimdall_session_end(session, 0);
+
+	delete session;
+}
+
+int heimdall_session_set_log_callback(heimdall_session *session, heimdall_log_callback callback, void *user_data)
+{
+	if (!session)
+		return (HEIMDALL_ERROR_INVALID_ARGUMENT);
+
+	session->logCallback = callback;
+	session->logUserData = user_data;
+
+	return (HEIMDALL_SUCCESS);
+}
+
+int heimdall_session_set_progress_callback(heimdall_session *session, heimdall_progress_callback callback, void *user_data)
+{
+	if (!session)
+		return (HEIMDALL_ERROR_INVALID_ARGUMENT);
+
+	session->progressCallback = callback;
+	session->progressUserData = user_data;
+
+	return (HEIMDALL_SUCCESS);
+}
+
+int heimdall_session_set_verbose(heimdall_session *session, int verbose)
+{
+	if (!session)
+		return (HEIMDALL_ERROR_INVALID_ARGUMENT);
+
+	session->verbose = verbose != 0;
+
+	return (HEIMDALL_SUCCESS);
+}
+
+int heimdall_session_begin(heimdall_session *session, const heimdall_device_info *device, int resume)
+{
+	if (!session)
+		return (HEIMDALL_ERROR_INVALID_ARGUMENT);
+
+	if (session->bridgeManager)
+		return (HEIMDALL_ERROR_INVALID_STATE);
+
+	SessionScope scope(session);
+
+	BridgeManager *bridgeManager = new BridgeManager(session->verbose);
+
+	if (device)
+		bridgeManager->SetDeviceLocation(device->bus_number, device->device_address);
+
+	int result = bridgeManager->Initialise(resume != 0);
+
+	if (result != BridgeManager::kInitialiseSucceeded)
+	{
+		delete bridgeManager;
+		return ((result == BridgeManager::kInitialiseDeviceNotDetected) ? HEIMDALL_ERROR_DEVICE_NOT_FOUND : HEIMDALL_ERROR_CONNECTION);
+	}
+
+	if (!bridgeManager->BeginSession())
+	{
+		delete bridgeManager;
+		return (HEIMDALL_ERROR_CONNECTION);
+	}
+
+	session->bridgeManager = bridgeManager;
+
+	return (HEIMDALL_SUCCESS);
+}
+
+int heimdall_session_end(heimdall_session *session, int reboot)
+{
+	if (!session)
+		return (HEIMDALL_ERROR_INVALID_ARGUMENT);
+
+	if (!session->bridgeManager)
+		return (HEIMDALL_ERROR_INVALID_STATE);
+
+	SessionScope scope(session);
+
+	bool ended = session->bridgeManager->EndSession(reboot != 0);
+
+	delete session->bridgeManager;
+	session->bridgeManager = nullptr;
+
+	session->ClearPit();
+
+	return (ended ? HEIMDALL_SUCCESS : HEIMDALL_ERROR_CONNECTION);
+}
+
+const char *heimdall_session_get_last_error(const heimdall_session *session)
+{
+	return (session ? session->lastError.c_str() : "");
+}
+
+const char *heimdall_session_get_serial_number(const heimdall_session *session)
+{
+	return (session && session->bridgeManager ? session->bridgeManager->GetSerialNumber().c_str() : "");
+}
+
+int heimdall_session_download_pit(heimdall_session *session, unsigned char *buffer, size_t capacity, size_t *size)
+{
+	if (!session || !size)
+		return (HEIMDALL_ERROR_INVALID_ARGUMENT);
+
+	if (!session->bridgeManager)
+		return (HEIMDALL_ERROR_INVALID_STATE);
+
+	SessionScope scope(session);
+
+	int result = downloadPit(session);
+
+	if (result != HEIMDALL_SUCCESS)
+		return (result);
+
+	*size = session->pitBuffer.size();
+
+	if (!buffer)
+		return (HEIMDALL_SUCCESS);
+
+	if (capacity < session->pitBuffer.size())
+		return (HEIMDALL_ERROR_BUFFER_TOO_SMALL);
+
+	memcpy(buffer, session->pitBuffer.data(), session->pitBuffer.size());
+
+	return (HEIMDALL_SUCCESS);
+}
+
+int heimdall_session_flash(heimdall_session *session, const heimdall_flash_source *sources, size_t source_count,
+	const unsigned char *pit_data, size_t pit_size, int repartition)
+{
+	if (!session || (source_count > 0 && !sources) || (pit_size > 0 && !pit_data))
+		return (HEIMDALL_ERROR_INVALID_ARGUMENT);
+
+	for (size_t i = 0; i < source_count; i++)
+	{
+		if (!sources[i].partition || (!sources[i].filename && !sources[i].data && !sources[i].read_callback))
+			return (HEIMDALL_ERROR_INVALID_ARGUMENT);
+	}
+
+	if (!session->bridgeManager)
+		return (HEIMDALL_ERROR_INVALID_STATE);
+
+	SessionScope scope(session);
+
+	if (source_count == 0 && !repartition)
+	{
+		Interface::PrintError("No partitions were specified to flash.\n");
+		return (HEIMDALL_ERROR_INVALID_ARGUMENT);
+	}
+
+	if (repartition && !pit_data)
+	{
+		Interface::PrintError("If you wish to repartition then a PIT file must be specified.\n");
+		return (HEIMDALL_ERROR_INVALID_ARGUMENT);
+	}
+
+	PitData *localPitData = nullptr;
+
+	if (pit_data)
+	{
+		localPitData = new PitData();
+
+		if (!localPitData->Unpack(pit_data, (unsigned int)pit_size))
+		{
+			Interface::PrintError("Failed to unpack PIT file.\n");
+
+			delete localPitData;
+			return (HEIMDALL_ERROR_INVALID_ARGUMENT);
+		}
+	}
+
+	// The device's PIT is kept for later calls, rather than downloaded again by every flash.
+	if (!repartition)
+	{
+		int result = downloadPit(session);
+
+		if (result != HEIMDALL_SUCCESS)
+		{
+			delete localPitData;
+			return (result);
+		}
+	}
+
+	vector<FlashAction::PartitionFile> partitionFiles;
+
+	for (size_t i = 0; i < source_count; i++)
+	{
+		if (!openSource(&sources[i], partitionFiles))
+		{
+			closeSources(partitionFiles);
+
+			delete localPitData;
+			return (HEIMDALL_ERROR_SOURCE);
+		}
+	}
+
+	bool success = FlashAction::Flash(session->bridgeManager, partitionFiles, localPitData, repartition != 0, false,
+		repartition ? nullptr : session->pitData, nullptr);
+
+	closeSources(partitionFiles);
+
+	delete localPitData;
+
+	if (repartition)
+		session->ClearPit();
+
+	return (success ? HEIMDALL_SUCCESS : HEIMDALL_ERROR_FLASH);
+}
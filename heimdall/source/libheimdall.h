@@ -0,0 +1,147 @@
+/* Copyright (c) 2010-2017 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef LIBHEIMDALL_H
+#define LIBHEIMDALL_H
+
+// C Standard Library
+#include <stddef.h>
+
+#if defined(LIBHEIMDALL_SHARED) && defined(_WIN32)
+#ifdef LIBHEIMDALL_EXPORTS
+#define HEIMDALL_API __declspec(dllexport)
+#else
+#define HEIMDALL_API __declspec(dllimport)
+#endif
+#elif defined(LIBHEIMDALL_SHARED) && defined(__GNUC__)
+#define HEIMDALL_API __attribute__((visibility("default")))
+#else
+#define HEIMDALL_API
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// C interface to Heimdall, for applications that drive devices in-process rather than through the heimdall executable.
+//
+// Every function returns HEIMDALL_SUCCESS or one of the negative error codes below. A session's functions may be called from any
+// thread, but only from one thread at a time. Separate sessions may be used concurrently from separate threads.
+
+enum
+{
+	HEIMDALL_SUCCESS = 0,
+	HEIMDALL_ERROR_INVALID_ARGUMENT = -1,
+	HEIMDALL_ERROR_INVALID_STATE = -2, // e.g. flashing before a session has begun.
+	HEIMDALL_ERROR_USB = -3,
+	HEIMDALL_ERROR_DEVICE_NOT_FOUND = -4,
+	HEIMDALL_ERROR_CONNECTION = -5, // Failed to connect to the device, or to begin or end the session.
+	HEIMDALL_ERROR_PIT = -6, // The PIT couldn't be downloaded or unpacked.
+	HEIMDALL_ERROR_BUFFER_TOO_SMALL = -7,
+	HEIMDALL_ERROR_SOURCE = -8, // A caller's flash source couldn't be read.
+	HEIMDALL_ERROR_FLASH = -9
+};
+
+enum
+{
+	HEIMDALL_MAX_PORT_NUMBERS = 7
+};
+
+typedef struct heimdall_device_info
+{
+	unsigned short vendor_id;
+	unsigned short product_id;
+
+	unsigned char bus_number;
+	unsigned char device_address;
+
+	// The path of hub ports from the root hub, empty if libusb can't report it.
+	unsigned char port_numbers[HEIMDALL_MAX_PORT_NUMBERS];
+	int port_number_count;
+} heimdall_device_info;
+
+typedef struct heimdall_session heimdall_session;
+
+// text is a complete fragment of Heimdall's human-readable output. error is non-zero for error and warning output.
+typedef void (*heimdall_log_callback)(const char *text, int error, void *user_data);
+
+// partition is NULL if the phase doesn't concern a particular partition. Bytes are only non-zero during a transfer.
+typedef void (*heimdall_progress_callback)(const char *phase, const char *partition, unsigned int bytes_transferred,
+	unsigned int total_bytes, void *user_data);
+
+// Fills buffer with up to size bytes. Returns the number of bytes read, 0 at the end of the data or a negative value on failure.
+typedef long (*heimdall_read_callback)(void *buffer, size_t size, void *user_data);
+
+typedef struct heimdall_flash_source
+{
+	const char *partition; // A partition name or identifier.
+
+	// The first of filename, data or read_callback that's provided is used. A file is read once and shared by every session
+	// flashing it at the same time. data is sent in place, so it's likewise shared if passed to several sessions, and must remain
+	// valid until the flash completes. Data from read_callback is buffered by each session.
+	const char *filename;
+
+	const void *data;
+	size_t size;
+
+	heimdall_read_callback read_callback;
+	void *user_data;
+} heimdall_flash_source;
+
+HEIMDALL_API const char *heimdall_error_string(int error);
+
+// Lists connected devices in download mode. *count receives the number of devices found, which may exceed capacity, in which case
+// only the first capacity devices are stored. devices may be NULL if capacity is 0. Nothing is logged.
+HEIMDALL_API int heimdall_enumerate_devices(heimdall_device_info *devices, size_t capacity, size_t *count);
+
+HEIMDALL_API int heimdall_session_create(heimdall_session **session);
+HEIMDALL_API void heimdall_session_destroy(heimdall_session *session); // Ends the session without rebooting, if it has begun.
+
+// Must be set before the session begins to apply to it. Without a log callback, output is discarded.
+HEIMDALL_API int heimdall_session_set_log_callback(heimdall_session *session, heimdall_log_callback callback, void *user_data);
+HEIMDALL_API int heimdall_session_set_progress_callback(heimdall_session *session, heimdall_progress_callback callback,
+	void *user_data);
+HEIMDALL_API int heimdall_session_set_verbose(heimdall_session *session, int verbose);
+
+// Connects to device, or the first device found if device is NULL. resume continues a session begun by an earlier connection.
+HEIMDALL_API int heimdall_session_begin(heimdall_session *session, const heimdall_device_info *device, int resume);
+HEIMDALL_API int heimdall_session_end(heimdall_session *session, int reboot);
+
+// Describes the most recent failure of any of the session's functions, empty if it reported no message.
+HEIMDALL_API const char *heimdall_session_get_last_error(const heimdall_session *session);
+
+// Empty if the device doesn't report a serial number or the session hasn't begun.
+HEIMDALL_API const char *heimdall_session_get_serial_number(const heimdall_session *session);
+
+// Copies the device's PIT into buffer. *size receives the PIT's size, buffer may be NULL to query it. The PIT is only
+// downloaded once per session, until the device is repartitioned.
+HEIMDALL_API int heimdall_session_download_pit(heimdall_session *session, unsigned char *buffer, size_t capacity, size_t *size);
+
+// Flashes each source to its partition. pit_data is required when repartitioning, otherwise it's optional and if given must
+// match the device's PIT.
+HEIMDALL_API int heimdall_session_flash(heimdall_session *session, const heimdall_flash_source *sources, size_t source_count,
+	const unsigned char *pit_data, size_t pit_size, int repartition);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -18,6 +18,19 @@
  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  THE SOFTWARE.*/
 
+#ifdef WIN32
+#include <Windows.h>
+#undef GetBinaryType
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// C/C++ Standard Library
+#include <algorithm>
+
 // libpit
 #include "libpit.h"
 
@@ -38,12 +51,67 @@ PitEntry::PitEntry()
 	memset(partitionName, 0, PitEntry::kPartitionNameMaxLength);
 	memset(flashFilename, 0, PitEntry::kFlashFilenameMaxLength);
 	memset(fotaFilename, 0, PitEntry::kFotaFilenameMaxLength);
+
+	pitData = nullptr;
+}
+
+PitEntry::PitEntry(const PitEntry& pitEntry)
+{
+	// Copies aren't owned by the PitData of the original.
+	pitData = nullptr;
+
+	*this = pitEntry;
 }
 
 PitEntry::~PitEntry()
 {
 }
 
+PitEntry& PitEntry::operator=(const PitEntry& pitEntry)
+{
+	binaryType = pitEntry.binaryType;
+	deviceType = pitEntry.deviceType;
+	identifier = pitEntry.identifier;
+	attributes = pitEntry.attributes;
+	updateAttributes = pitEntry.updateAttributes;
+	blockSizeOrOffset = pitEntry.blockSizeOrOffset;
+	blockCount = pitEntry.blockCount;
+	fileOffset = pitEntry.fileOffset;
+	fileSize = pitEntry.fileSize;
+
+	memcpy(partitionName, pitEntry.partitionName, PitEntry::kPartitionNameMaxLength);
+	memcpy(flashFilename, pitEntry.flashFilename, PitEntry::kFlashFilenameMaxLength);
+	memcpy(fotaFilename, pitEntry.fotaFilename, PitEntry::kFotaFilenameMaxLength);
+
+	// Assignment keeps the existing owner, whose indexes may now be stale.
+	if (pitData)
+		pitData->RebuildIndexes();
+
+	return (*this);
+}
+
+void PitEntry::SetIdentifier(unsigned int identifier)
+{
+	this->identifier = identifier;
+
+	if (pitData)
+		pitData->RebuildIndexes();
+}
+
+void PitEntry::SetPartitionName(const char *partitionName)
+{
+	// This isn't strictly necessary but ensures no junk is left in our PIT file.
+	memset(this->partitionName, 0, kPartitionNameMaxLength);
+
+	if (strlen(partitionName) < kPartitionNameMaxLength)
+		strcpy(this->partitionName, partitionName);
+	else
+		memcpy(this->partitionName, partitionName, kPartitionNameMaxLength - 1);
+
+	if (pitData)
+		pitData->RebuildIndexes();
+}
+
 bool PitEntry::Matches(const PitEntry *otherPitEntry) const
 {
 	if (binaryType == otherPitEntry->binaryType && deviceType == otherPitEntry->deviceType && identifier == otherPitEntry->identifier
@@ -79,10 +147,45 @@ PitData::PitData()
 	unknown8 = 0;
 }
 
+PitData::PitData(const PitData& pitData)
+{
+	*this = pitData;
+}
+
 PitData::~PitData()
 {
+}
+
+PitData& PitData::operator=(const PitData& pitData)
+{
+	if (this == &pitData)
+		return (*this);
+
+	entryCount = pitData.entryCount;
+
+	unknown1 = pitData.unknown1;
+	unknown2 = pitData.unknown2;
+
+	unknown3 = pitData.unknown3;
+	unknown4 = pitData.unknown4;
+
+	unknown5 = pitData.unknown5;
+	unknown6 = pitData.unknown6;
+
+	unknown7 = pitData.unknown7;
+	unknown8 = pitData.unknown8;
+
+	// Assigning over owned entries would reindex once per entry. Copies are constructed unowned, so clearing first means
+	// they're claimed and indexed once.
+	entries.clear();
+	entries = pitData.entries;
+
 	for (unsigned int i = 0; i < entries.size(); i++)
-		delete entries[i];
+		entries[i].pitData = this;
+
+	RebuildIndexes();
+
+	return (*this);
 }
 
 bool PitData::Unpack(const unsigned char *data)
@@ -90,12 +193,10 @@ bool PitData::Unpack(const unsigned char *data)
 	if (PitData::UnpackInteger(data, 0) != PitData::kFileIdentifier)
 		return (false);
 
-	// Remove existing entries
-	for (unsigned int i = 0; i < entries.size(); i++)
-		delete entries[i];
-
 	entryCount = PitData::UnpackInteger(data, 4);
 
+	// Remove existing entries. All entries are then unpacked into a single contiguous allocation.
+	entries.clear();
 	entries.resize(entryCount);
 
 	unknown1 = PitData::UnpackInteger(data, 8);
@@ -117,43 +218,59 @@ bool PitData::Unpack(const unsigned char *data)
 	{
 		entryOffset = PitData::kHeaderDataSize + i * PitEntry::kDataSize;
 
-		entries[i] = new PitEntry();
+		PitEntry& entry = entries[i];
 
 		integerValue = PitData::UnpackInteger(data, entryOffset);
-		entries[i]->SetBinaryType(integerValue);
+		entry.SetBinaryType(integerValue);
 
 		integerValue = PitData::UnpackInteger(data, entryOffset + 4);
-		entries[i]->SetDeviceType(integerValue);
+		entry.SetDeviceType(integerValue);
 
 		integerValue = PitData::UnpackInteger(data, entryOffset + 8);
-		entries[i]->SetIdentifier(integerValue);
+		entry.SetIdentifier(integerValue);
 
 		integerValue = PitData::UnpackInteger(data, entryOffset + 12);
-		entries[i]->SetAttributes(integerValue);
+		entry.SetAttributes(integerValue);
 
 		integerValue = PitData::UnpackInteger(data, entryOffset + 16);
-		entries[i]->SetUpdateAttributes(integerValue);
+		entry.SetUpdateAttributes(integerValue);
 
 		integerValue = PitData::UnpackInteger(data, entryOffset + 20);
-		entries[i]->SetBlockSizeOrOffset(integerValue);
+		entry.SetBlockSizeOrOffset(integerValue);
 
 		integerValue = PitData::UnpackInteger(data, entryOffset + 24);
-		entries[i]->SetBlockCount(integerValue);
+		entry.SetBlockCount(integerValue);
 
 		integerValue = PitData::UnpackInteger(data, entryOffset + 28);
-		entries[i]->SetFileOffset(integerValue);
+		entry.SetFileOffset(integerValue);
 
 		integerValue = PitData::UnpackInteger(data, entryOffset + 32);
-		entries[i]->SetFileSize(integerValue);
+		entry.SetFileSize(integerValue);
 
-		entries[i]->SetPartitionName((const char *)data + entryOffset + 36);
-		entries[i]->SetFlashFilename((const char *)data + entryOffset + 36 + PitEntry::kPartitionNameMaxLength);
-		entries[i]->SetFotaFilename((const char *)data + entryOffset + 36 + PitEntry::kPartitionNameMaxLength + PitEntry::kFlashFilenameMaxLength);
+		PitData::UnpackString(entry.partitionName, data, entryOffset + 36, PitEntry::kPartitionNameMaxLength);
+		PitData::UnpackString(entry.flashFilename, data, entryOffset + 36 + PitEntry::kPartitionNameMaxLength, PitEntry::kFlashFilenameMaxLength);
+		PitData::UnpackString(entry.fotaFilename, data, entryOffset + 36 + PitEntry::kPartitionNameMaxLength + PitEntry::kFlashFilenameMaxLength,
+			PitEntry::kFotaFilenameMaxLength);
+
+		entry.pitData = this;
 	}
 
+	RebuildIndexes();
+
 	return (true);
 }
 
+bool PitData::Unpack(const unsigned char *data, unsigned int size)
+{
+	// Once the header and size are validated, unpacking can't read past the end of data.
+	PitView pitView;
+
+	if (!pitView.Open(data, size))
+		return (false);
+
+	return (Unpack(data));
+}
+
 void PitData::Pack(unsigned char *data) const
 {
 	PitData::PackInteger(data, 0, PitData::kFileIdentifier);
@@ -178,24 +295,24 @@ void PitData::Pack(unsigned char *data) const
 	{
 		entryOffset = PitData::kHeaderDataSize + i * PitEntry::kDataSize;
 
-		PitData::PackInteger(data, entryOffset, entries[i]->GetBinaryType());
+		PitData::PackInteger(data, entryOffset, entries[i].GetBinaryType());
 
-		PitData::PackInteger(data, entryOffset + 4, entries[i]->GetDeviceType());
-		PitData::PackInteger(data, entryOffset + 8, entries[i]->GetIdentifier());
-		PitData::PackInteger(data, entryOffset + 12, entries[i]->GetAttributes());
+		PitData::PackInteger(data, entryOffset + 4, entries[i].GetDeviceType());
+		PitData::PackInteger(data, entryOffset + 8, entries[i].GetIdentifier());
+		PitData::PackInteger(data, entryOffset + 12, entries[i].GetAttributes());
 
-		PitData::PackInteger(data, entryOffset + 16, entries[i]->GetUpdateAttributes());
+		PitData::PackInteger(data, entryOffset + 16, entries[i].GetUpdateAttributes());
 
-		PitData::PackInteger(data, entryOffset + 20, entries[i]->GetBlockSizeOrOffset());
-		PitData::PackInteger(data, entryOffset + 24, entries[i]->GetBlockCount());
+		PitData::PackInteger(data, entryOffset + 20, entries[i].GetBlockSizeOrOffset());
+		PitData::PackInteger(data, entryOffset + 24, entries[i].GetBlockCount());
 
-		PitData::PackInteger(data, entryOffset + 28, entries[i]->GetFileOffset());
-		PitData::PackInteger(data, entryOffset + 32, entries[i]->GetFileSize());
+		PitData::PackInteger(data, entryOffset + 28, entries[i].GetFileOffset());
+		PitData::PackInteger(data, entryOffset + 32, entries[i].GetFileSize());
 
-		memcpy(data + entryOffset + 36, entries[i]->GetPartitionName(), PitEntry::kPartitionNameMaxLength);
-		memcpy(data + entryOffset + 36 + PitEntry::kPartitionNameMaxLength, entries[i]->GetFlashFilename(), PitEntry::kFlashFilenameMaxLength);
+		memcpy(data + entryOffset + 36, entries[i].GetPartitionName(), PitEntry::kPartitionNameMaxLength);
+		memcpy(data + entryOffset + 36 + PitEntry::kPartitionNameMaxLength, entries[i].GetFlashFilename(), PitEntry::kFlashFilenameMaxLength);
 		memcpy(data + entryOffset + 36 + PitEntry::kPartitionNameMaxLength + PitEntry::kFlashFilenameMaxLength,
-			entries[i]->GetFotaFilename(), PitEntry::kFotaFilenameMaxLength);
+			entries[i].GetFotaFilename(), PitEntry::kFotaFilenameMaxLength);
 	}
 }
 
@@ -207,7 +324,7 @@ bool PitData::Matches(const PitData *otherPitData) const
 	{
 		for (unsigned int i = 0; i < entryCount; i++)
 		{
-			if (!entries[i]->Matches(otherPitData->entries[i]))
+			if (!entries[i].Matches(&otherPitData->entries[i]))
 				return (false);
 		}
 
@@ -235,62 +352,513 @@ void PitData::Clear(void)
 	unknown7 = 0;
 	unknown8 = 0;
 
-	for (unsigned int i = 0; i < entries.size(); i++)
-		delete entries[i];
-
 	entries.clear();
+
+	partitionNameIndex.clear();
+	identifierIndex.clear();
 }
 
 PitEntry *PitData::GetEntry(unsigned int index)
 {
-	return (entries[index]);
+	return (&entries[index]);
 }
 
 const PitEntry *PitData::GetEntry(unsigned int index) const
 {
-	return (entries[index]);
+	return (&entries[index]);
 }
 
 PitEntry *PitData::FindEntry(const char *partitionName)
 {
+	return (const_cast<PitEntry *>(static_cast<const PitData *>(this)->FindEntry(partitionName)));
+}
+
+const PitEntry *PitData::FindEntry(const char *partitionName) const
+{
+	// Index 0 orders before any other entry with the same name.
+	std::vector<PartitionNameIndexEntry>::const_iterator it = std::lower_bound(partitionNameIndex.begin(), partitionNameIndex.end(),
+		PartitionNameIndexEntry(partitionName, 0), PartitionNameOrder());
+
+	return (it != partitionNameIndex.end() && strcmp(it->first, partitionName) == 0 ? &entries[it->second] : nullptr);
+}
+
+PitEntry *PitData::FindEntry(unsigned int partitionIdentifier)
+{
+	return (const_cast<PitEntry *>(static_cast<const PitData *>(this)->FindEntry(partitionIdentifier)));
+}
+
+const PitEntry *PitData::FindEntry(unsigned int partitionIdentifier) const
+{
+	std::vector<IdentifierIndexEntry>::const_iterator it = std::lower_bound(identifierIndex.begin(), identifierIndex.end(),
+		IdentifierIndexEntry(partitionIdentifier, 0));
+
+	return (it != identifierIndex.end() && it->first == partitionIdentifier ? &entries[it->second] : nullptr);
+}
+
+void PitData::RebuildIndexes(void)
+{
+	// Clearing keeps the capacity, so unpacking into the same PitData again doesn't reallocate the indexes.
+	partitionNameIndex.clear();
+	identifierIndex.clear();
+
+	partitionNameIndex.reserve(entries.size());
+	identifierIndex.reserve(entries.size());
+
 	for (unsigned int i = 0; i < entries.size(); i++)
 	{
-		if (entries[i]->IsFlashable() && strcmp(entries[i]->GetPartitionName(), partitionName) == 0)
-			return (entries[i]);
+		if (entries[i].IsFlashable())
+		{
+			partitionNameIndex.push_back(PartitionNameIndexEntry(entries[i].GetPartitionName(), i));
+			identifierIndex.push_back(IdentifierIndexEntry(entries[i].GetIdentifier(), i));
+		}
 	}
 
-	return (nullptr);
+	std::sort(partitionNameIndex.begin(), partitionNameIndex.end(), PartitionNameOrder());
+	std::sort(identifierIndex.begin(), identifierIndex.end());
 }
 
-const PitEntry *PitData::FindEntry(const char *partitionName) const
+
+
+struct IdentifierOrder
 {
-	for (unsigned int i = 0; i < entries.size(); i++)
+	const PitData *pitData;
+
+	IdentifierOrder(const PitData *pitData)
 	{
-		if (entries[i]->IsFlashable() && strcmp(entries[i]->GetPartitionName(), partitionName) == 0)
-			return (entries[i]);
+		this->pitData = pitData;
 	}
 
-	return (nullptr);
+	bool operator()(unsigned int index, unsigned int otherIndex) const
+	{
+		unsigned int identifier = pitData->GetEntry(index)->GetIdentifier();
+		unsigned int otherIdentifier = pitData->GetEntry(otherIndex)->GetIdentifier();
+
+		// Entries sharing an identifier keep their order, so that they're paired up in order.
+		return (identifier < otherIdentifier || (identifier == otherIdentifier && index < otherIndex));
+	}
+};
+
+static void sortByIdentifier(const PitData *pitData, std::vector<unsigned int>& indices)
+{
+	indices.resize(pitData->GetEntryCount());
+
+	for (unsigned int i = 0; i < indices.size(); i++)
+		indices[i] = i;
+
+	std::sort(indices.begin(), indices.end(), IdentifierOrder(pitData));
 }
 
-PitEntry *PitData::FindEntry(unsigned int partitionIdentifier)
+struct EntryNameOrder
 {
-	for (unsigned int i = 0; i < entries.size(); i++)
+	const PitData *pitData;
+
+	EntryNameOrder(const PitData *pitData)
+	{
+		this->pitData = pitData;
+	}
+
+	bool operator()(unsigned int index, unsigned int otherIndex) const
+	{
+		int comparison = strcmp(pitData->GetEntry(index)->GetPartitionName(), pitData->GetEntry(otherIndex)->GetPartitionName());
+		return (comparison < 0 || (comparison == 0 && index < otherIndex));
+	}
+};
+
+// Returns which of the pairs, ordered by their index in the first PIT, make up the longest run also in order in the other
+// PIT. Those are taken to have stayed put, and the rest to have moved.
+static std::vector<bool> findUnmovedPairs(const std::vector<std::pair<unsigned int, unsigned int> >& pairs)
+{
+	// Patience sorting: runEnds[k] is the pair ending the best known run of length k + 1.
+	std::vector<unsigned int> runEnds;
+	std::vector<int> predecessors(pairs.size(), -1);
+
+	for (unsigned int i = 0; i < pairs.size(); i++)
 	{
-		if (entries[i]->IsFlashable() && entries[i]->GetIdentifier() == partitionIdentifier)
-			return (entries[i]);
+		unsigned int low = 0;
+		unsigned int high = runEnds.size();
+
+		while (low < high)
+		{
+			unsigned int middle = (low + high) / 2;
+
+			if (pairs[runEnds[middle]].second < pairs[i].second)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+
+		if (low > 0)
+			predecessors[i] = runEnds[low - 1];
+
+		if (low == runEnds.size())
+			runEnds.push_back(i);
+		else
+			runEnds[low] = i;
 	}
 
-	return (nullptr);
+	std::vector<bool> unmoved(pairs.size(), false);
+
+	for (int i = runEnds.empty() ? -1 : (int)runEnds.back(); i >= 0; i = predecessors[i])
+		unmoved[i] = true;
+
+	return (unmoved);
 }
 
-const PitEntry *PitData::FindEntry(unsigned int partitionIdentifier) const
+PitDiff::PitDiff()
 {
-	for (unsigned int i = 0; i < entries.size(); i++)
+	changedHeaderFields = 0;
+}
+
+unsigned int PitDiff::CompareEntries(const PitEntry *entry, const PitEntry *otherEntry)
+{
+	unsigned int changedFields = 0;
+
+	if (entry->GetIdentifier() != otherEntry->GetIdentifier())
+		changedFields |= PitEntryDifference::kFieldIdentifier;
+
+	if (entry->GetBinaryType() != otherEntry->GetBinaryType())
+		changedFields |= PitEntryDifference::kFieldBinaryType;
+
+	if (entry->GetDeviceType() != otherEntry->GetDeviceType())
+		changedFields |= PitEntryDifference::kFieldDeviceType;
+
+	if (entry->GetAttributes() != otherEntry->GetAttributes())
+		changedFields |= PitEntryDifference::kFieldAttributes;
+
+	if (entry->GetUpdateAttributes() != otherEntry->GetUpdateAttributes())
+		changedFields |= PitEntryDifference::kFieldUpdateAttributes;
+
+	if (entry->GetBlockSizeOrOffset() != otherEntry->GetBlockSizeOrOffset())
+		changedFields |= PitEntryDifference::kFieldBlockSizeOrOffset;
+
+	if (entry->GetBlockCount() != otherEntry->GetBlockCount())
+		changedFields |= PitEntryDifference::kFieldBlockCount;
+
+	if (entry->GetFileOffset() != otherEntry->GetFileOffset())
+		changedFields |= PitEntryDifference::kFieldFileOffset;
+
+	if (entry->GetFileSize() != otherEntry->GetFileSize())
+		changedFields |= PitEntryDifference::kFieldFileSize;
+
+	if (strcmp(entry->GetPartitionName(), otherEntry->GetPartitionName()) != 0)
+		changedFields |= PitEntryDifference::kFieldPartitionName;
+
+	if (strcmp(entry->GetFlashFilename(), otherEntry->GetFlashFilename()) != 0)
+		changedFields |= PitEntryDifference::kFieldFlashFilename;
+
+	if (strcmp(entry->GetFotaFilename(), otherEntry->GetFotaFilename()) != 0)
+		changedFields |= PitEntryDifference::kFieldFotaFilename;
+
+	return (changedFields);
+}
+
+void PitDiff::Compare(const PitData *pitData, const PitData *otherPitData)
+{
+	changedHeaderFields = 0;
+	entryDifferences.clear();
+
+	if (pitData->GetEntryCount() != otherPitData->GetEntryCount())
+		changedHeaderFields |= PitDiff::kHeaderFieldEntryCount;
+
+	if (pitData->GetUnknown1() != otherPitData->GetUnknown1())
+		changedHeaderFields |= PitDiff::kHeaderFieldUnknown1;
+
+	if (pitData->GetUnknown2() != otherPitData->GetUnknown2())
+		changedHeaderFields |= PitDiff::kHeaderFieldUnknown2;
+
+	if (pitData->GetUnknown3() != otherPitData->GetUnknown3())
+		changedHeaderFields |= PitDiff::kHeaderFieldUnknown3;
+
+	if (pitData->GetUnknown4() != otherPitData->GetUnknown4())
+		changedHeaderFields |= PitDiff::kHeaderFieldUnknown4;
+
+	if (pitData->GetUnknown5() != otherPitData->GetUnknown5())
+		changedHeaderFields |= PitDiff::kHeaderFieldUnknown5;
+
+	if (pitData->GetUnknown6() != otherPitData->GetUnknown6())
+		changedHeaderFields |= PitDiff::kHeaderFieldUnknown6;
+
+	if (pitData->GetUnknown7() != otherPitData->GetUnknown7())
+		changedHeaderFields |= PitDiff::kHeaderFieldUnknown7;
+
+	if (pitData->GetUnknown8() != otherPitData->GetUnknown8())
+		changedHeaderFields |= PitDiff::kHeaderFieldUnknown8;
+
+	std::vector<unsigned int> indices;
+	std::vector<unsigned int> otherIndices;
+
+	sortByIdentifier(pitData, indices);
+	sortByIdentifier(otherPitData, otherIndices);
+
+	// Pair entries by identifier, merging the two identifier-ordered sequences in a single pass.
+	std::vector<std::pair<unsigned int, unsigned int> > pairs;
+	std::vector<unsigned int> unpairedIndices;
+	std::vector<unsigned int> unpairedOtherIndices;
+
+	unsigned int i = 0;
+	unsigned int j = 0;
+
+	while (i < indices.size() && j < otherIndices.size())
+	{
+		unsigned int identifier = pitData->GetEntry(indices[i])->GetIdentifier();
+		unsigned int otherIdentifier = otherPitData->GetEntry(otherIndices[j])->GetIdentifier();
+
+		if (identifier < otherIdentifier)
+			unpairedIndices.push_back(indices[i++]);
+		else if (otherIdentifier < identifier)
+			unpairedOtherIndices.push_back(otherIndices[j++]);
+		else
+			pairs.push_back(std::make_pair(indices[i++], otherIndices[j++]));
+	}
+
+	unpairedIndices.insert(unpairedIndices.end(), indices.begin() + i, indices.end());
+	unpairedOtherIndices.insert(unpairedOtherIndices.end(), otherIndices.begin() + j, otherIndices.end());
+
+	// Pair what's left by partition name, in the same way. Entries without a name can't be paired.
+	std::sort(unpairedIndices.begin(), unpairedIndices.end(), EntryNameOrder(pitData));
+	std::sort(unpairedOtherIndices.begin(), unpairedOtherIndices.end(), EntryNameOrder(otherPitData));
+
+	std::vector<unsigned int> removedIndices;
+	std::vector<unsigned int> addedIndices;
+
+	i = 0;
+	j = 0;
+
+	while (i < unpairedIndices.size() && j < unpairedOtherIndices.size())
+	{
+		const char *partitionName = pitData->GetEntry(unpairedIndices[i])->GetPartitionName();
+		const char *otherPartitionName = otherPitData->GetEntry(unpairedOtherIndices[j])->GetPartitionName();
+
+		int comparison = strcmp(partitionName, otherPartitionName);
+
+		if (comparison < 0 || partitionName[0] == '\0')
+			removedIndices.push_back(unpairedIndices[i++]);
+		else if (comparison > 0)
+			addedIndices.push_back(unpairedOtherIndices[j++]);
+		else
+			pairs.push_back(std::make_pair(unpairedIndices[i++], unpairedOtherIndices[j++]));
+	}
+
+	removedIndices.insert(removedIndices.end(), unpairedIndices.begin() + i, unpairedIndices.end());
+	addedIndices.insert(addedIndices.end(), unpairedOtherIndices.begin() + j, unpairedOtherIndices.end());
+
+	std::sort(pairs.begin(), pairs.end());
+	std::sort(removedIndices.begin(), removedIndices.end());
+	std::sort(addedIndices.begin(), addedIndices.end());
+
+	std::vector<bool> unmovedPairs = findUnmovedPairs(pairs);
+
+	// Report changed and removed entries in this PIT's order, then added entries in the other PIT's order.
+	i = 0;
+	j = 0;
+
+	while (i < pairs.size() || j < removedIndices.size())
+	{
+		if (j < removedIndices.size() && (i == pairs.size() || removedIndices[j] < pairs[i].first))
+		{
+			entryDifferences.push_back(PitEntryDifference(PitEntryDifference::kTypeRemoved, 0, removedIndices[j],
+				pitData->GetEntry(removedIndices[j]), 0, nullptr));
+			j++;
+		}
+		else
+		{
+			const PitEntry *entry = pitData->GetEntry(pairs[i].first);
+			const PitEntry *otherEntry = otherPitData->GetEntry(pairs[i].second);
+
+			unsigned int changedFields = CompareEntries(entry, otherEntry);
+
+			if (!unmovedPairs[i])
+				changedFields |= PitEntryDifference::kFieldIndex;
+
+			if (changedFields != 0)
+			{
+				entryDifferences.push_back(PitEntryDifference(PitEntryDifference::kTypeChanged, changedFields, pairs[i].first, entry,
+					pairs[i].second, otherEntry));
+			}
+
+			i++;
+		}
+	}
+
+	for (i = 0; i < addedIndices.size(); i++)
+	{
+		entryDifferences.push_back(PitEntryDifference(PitEntryDifference::kTypeAdded, 0, 0, nullptr, addedIndices[i],
+			otherPitData->GetEntry(addedIndices[i])));
+	}
+}
+
+
+
+PitView::PitView()
+{
+	data = nullptr;
+	entryCount = 0;
+}
+
+bool PitView::Open(const unsigned char *data, unsigned int size)
+{
+	this->data = nullptr;
+	entryCount = 0;
+
+	if (!data || size < PitData::kHeaderDataSize || (unsigned int)PitData::UnpackInteger(data, 0) != PitData::kFileIdentifier)
+		return (false);
+
+	unsigned int declaredEntryCount = PitData::UnpackInteger(data, 4);
+
+	if (declaredEntryCount > (size - PitData::kHeaderDataSize) / PitEntry::kDataSize)
+		return (false);
+
+	this->data = data;
+	entryCount = declaredEntryCount;
+
+	return (true);
+}
+
+bool PitView::FindEntry(const char *partitionName, PitEntryView& entry) const
+{
+	// PitEntry truncates names to kPartitionNameMaxLength - 1 characters, so match those the same way. Longer names can't match.
+	if (strlen(partitionName) >= PitEntry::kPartitionNameMaxLength)
+		return (false);
+
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		PitEntryView candidate = GetEntry(i);
+
+		if (candidate.IsFlashable() && strncmp(candidate.GetPartitionName(), partitionName, PitEntry::kPartitionNameMaxLength - 1) == 0)
+		{
+			entry = candidate;
+			return (true);
+		}
+	}
+
+	return (false);
+}
+
+bool PitView::FindEntry(unsigned int partitionIdentifier, PitEntryView& entry) const
+{
+	for (unsigned int i = 0; i < entryCount; i++)
 	{
-		if (entries[i]->IsFlashable() && entries[i]->GetIdentifier() == partitionIdentifier)
-			return (entries[i]);
+		PitEntryView candidate = GetEntry(i);
+
+		if (candidate.IsFlashable() && candidate.GetIdentifier() == partitionIdentifier)
+		{
+			entry = candidate;
+			return (true);
+		}
+	}
+
+	return (false);
+}
+
+
+
+PitFileMapping::PitFileMapping()
+{
+	data = nullptr;
+	size = 0;
+
+#ifdef WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = nullptr;
+#endif
+}
+
+PitFileMapping::~PitFileMapping()
+{
+	Close();
+}
+
+bool PitFileMapping::Open(const char *filename)
+{
+	Close();
+
+#ifdef WIN32
+
+	fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return (false);
+
+	LARGE_INTEGER fileSize;
+
+	// Empty files can't be mapped, and PIT files are nowhere near 4 GiB.
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0 || fileSize.QuadPart > 0xFFFFFFFF)
+	{
+		Close();
+		return (false);
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (!mappingHandle)
+	{
+		Close();
+		return (false);
 	}
 
-	return (nullptr);
+	data = (const unsigned char *)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+	if (!data)
+	{
+		Close();
+		return (false);
+	}
+
+	size = (unsigned int)fileSize.QuadPart;
+
+#else
+
+	int fileDescriptor = open(filename, O_RDONLY);
+
+	if (fileDescriptor < 0)
+		return (false);
+
+	struct stat fileStatus;
+
+	// Empty files can't be mapped, and PIT files are nowhere near 4 GiB.
+	if (fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size <= 0 || (unsigned long long)fileStatus.st_size > 0xFFFFFFFFULL)
+	{
+		close(fileDescriptor);
+		return (false);
+	}
+
+	void *mapping = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);
+
+	if (mapping == MAP_FAILED)
+		return (false);
+
+	data = (const unsigned char *)mapping;
+	size = (unsigned int)fileStatus.st_size;
+
+#endif
+
+	return (true);
+}
+
+void PitFileMapping::Close(void)
+{
+#ifdef WIN32
+
+	if (data)
+		UnmapViewOfFile(data);
+
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = nullptr;
+
+#else
+
+	if (data)
+		munmap((void *)data, size);
+
+#endif
+
+	data = nullptr;
+	size = 0;
 }
@@ -36,12 +36,17 @@
 // C/C++ Standard Library
 #include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace libpit
 {
+	class PitData;
+
 	class PitEntry
 	{
+		friend class PitData;
+
 		public:
 
 			enum
@@ -97,11 +102,16 @@ namespace libpit
 			char flashFilename[kFlashFilenameMaxLength]; // USB flash filename
 			char fotaFilename[kFotaFilenameMaxLength]; // Firmware over the air
 
+			PitData *pitData; // Owner, notified when indexed fields change.
+
 		public:
 
 			PitEntry();
+			PitEntry(const PitEntry& pitEntry);
 			~PitEntry();
 
+			PitEntry& operator=(const PitEntry& pitEntry);
+
 			bool Matches(const PitEntry *otherPitEntry) const;
 
 			bool IsFlashable(void) const
@@ -134,10 +144,7 @@ namespace libpit
 				return identifier;
 			}
 
-			void SetIdentifier(unsigned int identifier)
-			{
-				this->identifier = identifier;
-			}
+			void SetIdentifier(unsigned int identifier);
 
 			unsigned int GetAttributes(void) const
 			{
@@ -205,16 +212,7 @@ namespace libpit
 				return partitionName;
 			}
 
-			void SetPartitionName(const char *partitionName)
-			{
-				// This isn't strictly necessary but ensures no junk is left in our PIT file.
-				memset(this->partitionName, 0, kPartitionNameMaxLength);
-
-				if (strlen(partitionName) < kPartitionNameMaxLength)
-					strcpy(this->partitionName, partitionName);
-				else
-					memcpy(this->partitionName, partitionName, kPartitionNameMaxLength - 1);
-			}
+			void SetPartitionName(const char *partitionName);
 
 			const char *GetFlashFilename(void) const
 			{
@@ -226,7 +224,7 @@ namespace libpit
 				// This isn't strictly necessary but ensures no junk is left in our PIT file.
 				memset(this->flashFilename, 0, kFlashFilenameMaxLength);
 
-				if (strlen(partitionName) < kFlashFilenameMaxLength)
+				if (strlen(flashFilename) < kFlashFilenameMaxLength)
 					strcpy(this->flashFilename, flashFilename);
 				else
 					memcpy(this->flashFilename, flashFilename, kFlashFilenameMaxLength - 1);
@@ -242,7 +240,7 @@ namespace libpit
 				// This isn't strictly necessary but ensures no junk is left in our PIT file.
 				memset(this->fotaFilename, 0, kFotaFilenameMaxLength);
 
-				if (strlen(partitionName) < kFotaFilenameMaxLength)
+				if (strlen(fotaFilename) < kFotaFilenameMaxLength)
 					strcpy(this->fotaFilename, fotaFilename);
 				else
 					memcpy(this->fotaFilename, fotaFilename, kFotaFilenameMaxLength - 1);
@@ -251,6 +249,10 @@ namespace libpit
 
 	class PitData
 	{
+		friend class PitEntry;
+		friend class PitEntryView;
+		friend class PitView;
+
 		public:
 
 			enum
@@ -276,7 +278,26 @@ namespace libpit
 			unsigned short unknown8; // 0x1A
 
 			// Entries start at 0x1C
-			std::vector<PitEntry *> entries;
+			std::vector<PitEntry> entries;
+
+			typedef std::pair<const char *, unsigned int> PartitionNameIndexEntry;
+			typedef std::pair<unsigned int, unsigned int> IdentifierIndexEntry;
+
+			struct PartitionNameOrder
+			{
+				bool operator()(const PartitionNameIndexEntry& indexEntry, const PartitionNameIndexEntry& otherIndexEntry) const
+				{
+					int comparison = strcmp(indexEntry.first, otherIndexEntry.first);
+					return (comparison < 0 || (comparison == 0 && indexEntry.second < otherIndexEntry.second));
+				}
+			};
+
+			// Indexes of flashable entries, sorted by key then entry index, so the first of any duplicates is found first. Names
+			// point into the entries themselves. Sorted vectors cost a single allocation each, unlike hash tables.
+			std::vector<PartitionNameIndexEntry> partitionNameIndex;
+			std::vector<IdentifierIndexEntry> identifierIndex;
+
+			void RebuildIndexes(void);
 
 			static int UnpackInteger(const unsigned char *data, unsigned int offset)
 			{
@@ -302,6 +323,16 @@ namespace libpit
 				return (value);
 			}
 
+			// Names are fixed size fields which needn't be terminated. Like the PitEntry setters, keep at most maxLength - 1 characters.
+			static void UnpackString(char *value, const unsigned char *data, unsigned int offset, unsigned int maxLength)
+			{
+				const void *terminator = memchr(data + offset, '\0', maxLength - 1);
+				unsigned int length = terminator ? (unsigned int)((const unsigned char *)terminator - (data + offset)) : maxLength - 1;
+
+				memset(value, 0, maxLength);
+				memcpy(value, data + offset, length);
+			}
+
 			static void PackInteger(unsigned char *data, unsigned int offset, unsigned int value)
 			{
 #ifdef WORDS_BIGENDIAN
@@ -333,9 +364,14 @@ namespace libpit
 		public:
 
 			PitData();
+			PitData(const PitData& pitData);
 			~PitData();
 
+			PitData& operator=(const PitData& pitData);
+
+			// Trusts the entry count in the header, only use this with data known to be complete.
 			bool Unpack(const unsigned char *data);
+			bool Unpack(const unsigned char *data, unsigned int size);
 			void Pack(unsigned char *data) const;
 
 			bool Matches(const PitData *otherPitData) const;
@@ -412,6 +448,341 @@ namespace libpit
 				return unknown8;
 			}
 	};
+
+	class PitEntryDifference
+	{
+		public:
+
+			enum
+			{
+				kTypeAdded = 0, // Only in the other PIT
+				kTypeRemoved, // Only in this PIT
+				kTypeChanged
+			};
+
+			enum
+			{
+				kFieldIndex = 1, // The entry moved relative to the other paired entries.
+				kFieldBinaryType = 1 << 1,
+				kFieldDeviceType = 1 << 2,
+				kFieldAttributes = 1 << 3,
+				kFieldUpdateAttributes = 1 << 4,
+				kFieldBlockSizeOrOffset = 1 << 5,
+				kFieldBlockCount = 1 << 6,
+				kFieldFileOffset = 1 << 7,
+				kFieldFileSize = 1 << 8,
+				kFieldPartitionName = 1 << 9,
+				kFieldFlashFilename = 1 << 10,
+				kFieldFotaFilename = 1 << 11,
+				kFieldIdentifier = 1 << 12
+			};
+
+		private:
+
+			unsigned int type;
+			unsigned int changedFields;
+
+			unsigned int index;
+			unsigned int otherIndex;
+
+			const PitEntry *entry;
+			const PitEntry *otherEntry;
+
+		public:
+
+			PitEntryDifference(unsigned int type, unsigned int changedFields, unsigned int index, const PitEntry *entry,
+				unsigned int otherIndex, const PitEntry *otherEntry)
+			{
+				this->type = type;
+				this->changedFields = changedFields;
+				this->index = index;
+				this->entry = entry;
+				this->otherIndex = otherIndex;
+				this->otherEntry = otherEntry;
+			}
+
+			unsigned int GetType(void) const
+			{
+				return type;
+			}
+
+			unsigned int GetChangedFields(void) const
+			{
+				return changedFields;
+			}
+
+			// Only valid unless the entry was added.
+			unsigned int GetIndex(void) const
+			{
+				return index;
+			}
+
+			const PitEntry *GetEntry(void) const
+			{
+				return entry;
+			}
+
+			// Only valid unless the entry was removed.
+			unsigned int GetOtherIndex(void) const
+			{
+				return otherIndex;
+			}
+
+			const PitEntry *GetOtherEntry(void) const
+			{
+				return otherEntry;
+			}
+	};
+
+	// Structured comparison of two PITs. Entries are paired by identifier, then any left over by partition name, so an entry
+	// that moved, was resized or was renumbered is reported as a change rather than as a removal and an addition. An entry has
+	// only moved if its order relative to the other paired entries changed, so inserting one entry doesn't flag those after it.
+	// Entries point into the compared PITs.
+	class PitDiff
+	{
+		public:
+
+			enum
+			{
+				kHeaderFieldEntryCount = 1,
+				kHeaderFieldUnknown1 = 1 << 1,
+				kHeaderFieldUnknown2 = 1 << 2,
+				kHeaderFieldUnknown3 = 1 << 3,
+				kHeaderFieldUnknown4 = 1 << 4,
+				kHeaderFieldUnknown5 = 1 << 5,
+				kHeaderFieldUnknown6 = 1 << 6,
+				kHeaderFieldUnknown7 = 1 << 7,
+				kHeaderFieldUnknown8 = 1 << 8
+			};
+
+		private:
+
+			unsigned int changedHeaderFields;
+			std::vector<PitEntryDifference> entryDifferences;
+
+			static unsigned int CompareEntries(const PitEntry *entry, const PitEntry *otherEntry);
+
+		public:
+
+			PitDiff();
+
+			void Compare(const PitData *pitData, const PitData *otherPitData);
+
+			bool IsEmpty(void) const
+			{
+				return (changedHeaderFields == 0 && entryDifferences.empty());
+			}
+
+			unsigned int GetChangedHeaderFields(void) const
+			{
+				return changedHeaderFields;
+			}
+
+			unsigned int GetEntryDifferenceCount(void) const
+			{
+				return (entryDifferences.size());
+			}
+
+			const PitEntryDifference *GetEntryDifference(unsigned int index) const
+			{
+				return (&entryDifferences[index]);
+			}
+	};
+
+	// Read-only view of a packed PIT entry. Fields are decoded on access. Names point straight into the packed data and
+	// are only null-terminated if the PIT file terminates them, so never read more than their maximum length.
+	class PitEntryView
+	{
+		private:
+
+			const unsigned char *data;
+
+		public:
+
+			PitEntryView()
+			{
+				data = nullptr;
+			}
+
+			PitEntryView(const unsigned char *data)
+			{
+				this->data = data;
+			}
+
+			bool IsFlashable(void) const
+			{
+				return data[36] != '\0';
+			}
+
+			unsigned int GetBinaryType(void) const
+			{
+				return PitData::UnpackInteger(data, 0);
+			}
+
+			unsigned int GetDeviceType(void) const
+			{
+				return PitData::UnpackInteger(data, 4);
+			}
+
+			unsigned int GetIdentifier(void) const
+			{
+				return PitData::UnpackInteger(data, 8);
+			}
+
+			unsigned int GetAttributes(void) const
+			{
+				return PitData::UnpackInteger(data, 12);
+			}
+
+			unsigned int GetUpdateAttributes(void) const
+			{
+				return PitData::UnpackInteger(data, 16);
+			}
+
+			unsigned int GetBlockSizeOrOffset(void) const
+			{
+				return PitData::UnpackInteger(data, 20);
+			}
+
+			unsigned int GetBlockCount(void) const
+			{
+				return PitData::UnpackInteger(data, 24);
+			}
+
+			unsigned int GetFileOffset(void) const
+			{
+				return PitData::UnpackInteger(data, 28);
+			}
+
+			unsigned int GetFileSize(void) const
+			{
+				return PitData::UnpackInteger(data, 32);
+			}
+
+			const char *GetPartitionName(void) const
+			{
+				return (const char *)data + 36;
+			}
+
+			const char *GetFlashFilename(void) const
+			{
+				return (const char *)data + 36 + PitEntry::kPartitionNameMaxLength;
+			}
+
+			const char *GetFotaFilename(void) const
+			{
+				return (const char *)data + 36 + PitEntry::kPartitionNameMaxLength + PitEntry::kFlashFilenameMaxLength;
+			}
+	};
+
+	// Read-only view of a packed PIT file. Nothing is copied, so the data must outlive the view.
+	class PitView
+	{
+		private:
+
+			const unsigned char *data;
+			unsigned int entryCount;
+
+		public:
+
+			PitView();
+
+			// Validates the header and that the data holds every entry the header declares.
+			bool Open(const unsigned char *data, unsigned int size);
+
+			bool FindEntry(const char *partitionName, PitEntryView& entry) const;
+			bool FindEntry(unsigned int partitionIdentifier, PitEntryView& entry) const;
+
+			PitEntryView GetEntry(unsigned int index) const
+			{
+				return PitEntryView(data + PitData::kHeaderDataSize + index * PitEntry::kDataSize);
+			}
+
+			unsigned int GetEntryCount(void) const
+			{
+				return entryCount;
+			}
+
+			unsigned int GetDataSize(void) const
+			{
+				return PitData::kHeaderDataSize + entryCount * PitEntry::kDataSize;
+			}
+
+			unsigned int GetUnknown1(void) const
+			{
+				return PitData::UnpackInteger(data, 8);
+			}
+
+			unsigned int GetUnknown2(void) const
+			{
+				return PitData::UnpackInteger(data, 12);
+			}
+
+			unsigned short GetUnknown3(void) const
+			{
+				return PitData::UnpackShort(data, 16);
+			}
+
+			unsigned short GetUnknown4(void) const
+			{
+				return PitData::UnpackShort(data, 18);
+			}
+
+			unsigned short GetUnknown5(void) const
+			{
+				return PitData::UnpackShort(data, 20);
+			}
+
+			unsigned short GetUnknown6(void) const
+			{
+				return PitData::UnpackShort(data, 22);
+			}
+
+			unsigned short GetUnknown7(void) const
+			{
+				return PitData::UnpackShort(data, 24);
+			}
+
+			unsigned short GetUnknown8(void) const
+			{
+				return PitData::UnpackShort(data, 26);
+			}
+	};
+
+	// Maps a PIT file read-only into memory, for use with PitView.
+	class PitFileMapping
+	{
+		private:
+
+			const unsigned char *data;
+			unsigned int size;
+
+#ifdef WIN32
+			void *fileHandle;
+			void *mappingHandle;
+#endif
+
+			PitFileMapping(const PitFileMapping&);
+			PitFileMapping& operator=(const PitFileMapping&);
+
+		public:
+
+			PitFileMapping();
+			~PitFileMapping();
+
+			bool Open(const char *filename);
+			void Close(void);
+
+			const unsigned char *GetData(void) const
+			{
+				return data;
+			}
+
+			unsigned int GetSize(void) const
+			{
+				return size;
+			}
+	};
 }
 
 #endif